@@ -0,0 +1,553 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include "mesh.h"
+#include "material.h"
+#include "modelData.h"
+#include "mappedFile.h"
+#include "hash.h"
+#include "blockCompression.h"
+#include "mipmaps.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+// On-disk layout of an asset pack, written by src_alt/asset-cooker.cpp:
+//
+//   PackHeader | payloads (16 byte aligned) | PackEntry[entryCount] sorted by name | names
+//
+// A model payload is a PackedModel followed by its PackedModelTexture, PackedMesh and
+// PackedMeshTexture tables, texture paths, then vertex and index data. A texture payload is
+// a PackedTexture followed by its mip chain. Offsets inside a payload are relative to the
+// payload start. Everything is little endian and read in place from the mapped file.
+// Version 2 added block compressed textures, version 3 bakes node transforms into meshes.
+
+const char PACK_MAGIC[4] = { 'L', 'P', 'A', 'K' };
+const std::uint32_t PACK_VERSION = 3;
+const std::uint32_t PACK_MAX_LEVELS = MAX_MIP_LEVELS;
+const std::size_t PACK_ALIGNMENT = 16;
+
+enum PackEntryType : std::uint32_t {
+    PACK_MODEL = 1,
+    PACK_TEXTURE = 2
+};
+
+struct PackHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t vertexSize;     // sizeof(Vertex) when cooked, stale packs are rejected
+    std::uint32_t entryCount;
+    std::uint64_t entriesOffset;
+    std::uint64_t namesOffset;
+};
+
+struct PackEntry {
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t hash;           // PackHash of the payload
+    std::uint64_t sourceSize;     // of the file cooked into the entry, when it was cooked
+    std::int64_t sourceTime;      // its modification time in seconds, 0 if it couldn't be read
+    std::uint32_t nameOffset;     // into the names block
+    std::uint32_t nameLength;
+    std::uint32_t type;
+    std::uint32_t reserved;
+};
+
+struct PackedModel {
+    std::uint32_t meshCount;
+    std::uint32_t textureCount;
+    // bounding box of the model; importing recomputes bounds per mesh, these are informational
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// a texture of the model; its pack entry is named <model directory>/<path>
+struct PackedModelTexture {
+    std::uint32_t pathOffset;
+    std::uint32_t pathLength;
+    std::uint32_t role;
+    std::uint32_t reserved;
+};
+
+struct PackedMesh {
+    std::uint64_t verticesOffset;
+    std::uint64_t indicesOffset;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    std::uint32_t firstTexture;   // into the PackedMeshTexture table
+    std::uint32_t textureCount;
+};
+
+struct PackedMeshTexture {
+    std::uint32_t texture;        // into the PackedModelTexture table
+    std::uint32_t role;
+};
+
+// level i is max(width >> i, 1) * max(height >> i, 1) * components tightly packed bytes, or
+// the blocks of that size when format is a BlockFormat
+struct PackedTexture {
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t components;     // of the source image
+    std::uint32_t levels;
+    std::uint32_t format;         // BlockFormat
+    std::uint32_t reserved;
+    std::uint64_t levelOffsets[PACK_MAX_LEVELS];
+};
+
+inline std::uint64_t PackHash(const void *data, std::size_t size)
+{
+    return HashBytes(data, size);
+}
+
+// size and modification time of a file, false if it can't be read
+inline bool PackSourceStamp(const std::string &path, std::uint64_t &size, std::int64_t &time)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    size = static_cast<std::uint64_t>(info.st_size);
+    time = static_cast<std::int64_t>(info.st_mtime);
+    return true;
+}
+
+// Read side of an asset pack. The whole pack is mapped once; lookups binary search the
+// sorted index and hand out pointers into the mapping, so nothing is read until touched.
+class AssetPack
+{
+public:
+    // false (quietly) if the file doesn't exist, with an error if it isn't a valid pack.
+    // The index is checked against the file size here, payloads when they're imported.
+    bool Open(const std::string &path)
+    {
+        Close();
+        if (!file.Open(path))
+            return false;
+        const PackHeader *candidate = reinterpret_cast<const PackHeader*>(file.Data());
+        bool valid = file.Size() >= sizeof(PackHeader) && std::memcmp(candidate->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+                candidate->version == PACK_VERSION && candidate->vertexSize == sizeof(Vertex) &&
+                within(candidate->entriesOffset, static_cast<std::uint64_t>(candidate->entryCount) * sizeof(PackEntry), file.Size()) &&
+                candidate->namesOffset <= file.Size();
+        if (valid) {
+            // payloads come before the index, names after it
+            const PackEntry *candidates = reinterpret_cast<const PackEntry*>(file.Data() + candidate->entriesOffset);
+            for (std::uint32_t i = 0; valid && i < candidate->entryCount; i++)
+                valid = within(candidates[i].offset, candidates[i].size, candidate->entriesOffset) &&
+                        within(candidates[i].nameOffset, candidates[i].nameLength, file.Size() - candidate->namesOffset);
+        }
+        if (!valid) {
+            std::cout << "ERROR::ASSET_PACK:: " << path << " is not a valid pack for this build, re-run the asset cooker" << std::endl;
+            Close();
+            return false;
+        }
+        header = candidate;
+        entries = reinterpret_cast<const PackEntry*>(file.Data() + header->entriesOffset);
+        return true;
+    }
+
+    void Close()
+    {
+        file.Close();
+        header = nullptr;
+        entries = nullptr;
+    }
+
+    bool IsOpen() const { return header != nullptr; }
+    unsigned int EntryCount() const { return header ? header->entryCount : 0; }
+    std::size_t Size() const { return file.Size(); }
+
+    // entry with this name (as the file path the runtime would open), nullptr if not cooked
+    const PackEntry* Find(const std::string &name) const
+    {
+        if (!header)
+            return nullptr;
+        const PackEntry *end = entries + header->entryCount;
+        const PackEntry *entry = std::lower_bound(entries, end, name, [this](const PackEntry &e, const std::string &key) {
+            return Name(e).compare(key) < 0;
+        });
+        return entry != end && Name(*entry) == name ? entry : nullptr;
+    }
+
+    std::string Name(const PackEntry &entry) const
+    {
+        return std::string(file.Data() + header->namesOffset + entry.nameOffset, entry.nameLength);
+    }
+
+    const char* Payload(const PackEntry &entry) const
+    {
+        return file.Data() + entry.offset;
+    }
+
+    // true if the entry's source file was edited since it was cooked. Entries whose source
+    // isn't there (a pack shipped on its own) are never stale.
+    bool Stale(const PackEntry &entry) const
+    {
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+        if (entry.sourceTime == 0 || !PackSourceStamp(Name(entry), size, time))
+            return false;
+        return size != entry.sourceSize || time != entry.sourceTime;
+    }
+
+    // rehashes every payload; touches the whole file, so meant for tools and debugging
+    bool Verify() const
+    {
+        bool valid = IsOpen();
+        for (unsigned int i = 0; valid && i < header->entryCount; i++) {
+            if (PackHash(Payload(entries[i]), entries[i].size) != entries[i].hash) {
+                std::cout << "ERROR::ASSET_PACK:: hash mismatch for " << Name(entries[i]) << std::endl;
+                valid = false;
+            }
+        }
+        return valid;
+    }
+
+    // Fills data from the cooked model, false if the pack doesn't have it, the model or one
+    // of its textures was edited since it was cooked, an entry is corrupt or a texture is
+    // block compressed while TextureCache compression is off (--uncompressed, or no S3TC);
+    // the source files load instead. Geometry is copied (the upload frees it), texture pixels
+    // and mip chains point into the mapping and stay valid while the pack is open.
+    bool ImportModel(const std::string &path, bool gamma, ModelData &data) const
+    {
+        const PackEntry *entry = Find(path);
+        if (!entry || entry->type != PACK_MODEL)
+            return false;
+        if (!validModel(*entry)) {
+            std::cout << "ERROR::ASSET_PACK:: " << path << " is corrupt in the pack, loading it from its source files (re-run the asset cooker)" << std::endl;
+            return false;
+        }
+        const char *payload = Payload(*entry);
+        const PackedModel &model = *reinterpret_cast<const PackedModel*>(payload);
+        const PackedModelTexture *textures = reinterpret_cast<const PackedModelTexture*>(payload + sizeof(PackedModel));
+        const PackedMesh *meshes = reinterpret_cast<const PackedMesh*>(textures + model.textureCount);
+        const PackedMeshTexture *meshTextures = reinterpret_cast<const PackedMeshTexture*>(meshes + model.meshCount);
+
+        std::string directory = path.substr(0, path.find_last_of('/'));
+        for (std::uint32_t i = 0; i <= model.textureCount; i++) {
+            const PackEntry *cooked = i == model.textureCount ? entry :
+                    Find(directory + '/' + std::string(payload + textures[i].pathOffset, textures[i].pathLength));
+            if (cooked && Stale(*cooked)) {
+                std::cout << "WARNING::ASSET_PACK:: " << Name(*cooked) << " changed since it was cooked, loading " << path
+                          << " from its source files (re-run the asset cooker)" << std::endl;
+                return false;
+            }
+            if (i == model.textureCount || !cooked || cooked->type != PACK_TEXTURE)
+                continue;
+            if (!validTexture(*cooked)) {
+                std::cout << "ERROR::ASSET_PACK:: " << Name(*cooked) << " is corrupt in the pack, loading " << path
+                          << " from its source files (re-run the asset cooker)" << std::endl;
+                return false;
+            }
+            // compressed levels would go to GL as they are, which the context may not sample
+            const PackedTexture &packed = *reinterpret_cast<const PackedTexture*>(Payload(*cooked));
+            if (static_cast<BlockFormat>(packed.format) != BlockFormat::NONE && !TextureCache::Settings().enabled) {
+                std::cout << "WARNING::ASSET_PACK:: " << Name(*cooked) << " is block compressed but texture compression is off, loading "
+                          << path << " from its source files" << std::endl;
+                return false;
+            }
+        }
+
+        data.directory = directory;
+        data.textures.resize(model.textureCount);
+        for (std::uint32_t i = 0; i < model.textureCount; i++) {
+            ImportedTexture &texture = data.textures[i];
+            texture.path.assign(payload + textures[i].pathOffset, textures[i].pathLength);
+            texture.role = static_cast<TextureRole>(textures[i].role);
+            texture.gamma = gamma && texture.role == TextureRole::DIFFUSE;
+
+            const PackEntry *pixels = Find(data.directory + '/' + texture.path);
+            if (!pixels || pixels->type != PACK_TEXTURE) {
+                std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+                continue;
+            }
+            const char *texturePayload = Payload(*pixels);
+            const PackedTexture &packed = *reinterpret_cast<const PackedTexture*>(texturePayload);
+            texture.width = static_cast<int>(packed.width);
+            texture.height = static_cast<int>(packed.height);
+            texture.nrComponents = static_cast<int>(packed.components);
+            texture.format = static_cast<BlockFormat>(packed.format);
+            const char *level0 = texturePayload + packed.levelOffsets[0];
+            texture.data = unique_ptr<unsigned char, void(*)(void*)>(reinterpret_cast<unsigned char*>(const_cast<char*>(level0)), ImportedTexture::KeepData);
+            for (std::uint32_t level = 1; level < packed.levels; level++)
+                texture.levelOffsets.push_back(static_cast<std::size_t>(packed.levelOffsets[level] - packed.levelOffsets[0]));
+        }
+
+        data.meshes.resize(model.meshCount);
+        for (std::uint32_t i = 0; i < model.meshCount; i++) {
+            ImportedMesh &mesh = data.meshes[i];
+            const Vertex *vertices = reinterpret_cast<const Vertex*>(payload + meshes[i].verticesOffset);
+            const unsigned int *indices = reinterpret_cast<const unsigned int*>(payload + meshes[i].indicesOffset);
+            mesh.vertices.assign(vertices, vertices + meshes[i].vertexCount);
+            mesh.indices.assign(indices, indices + meshes[i].indexCount);
+            for (std::uint32_t t = 0; t < meshes[i].textureCount; t++) {
+                const PackedMeshTexture &reference = meshTextures[meshes[i].firstTexture + t];
+                mesh.textures.push_back(std::make_pair(reference.texture, static_cast<TextureRole>(reference.role)));
+            }
+        }
+        return true;
+    }
+
+    // The pack Model::Import looks in before touching the filesystem. Mount once at startup,
+    // before any import starts, and keep it mounted while models loaded from it are uploading.
+    static bool Mount(const std::string &path)
+    {
+        return mounted().Open(path);
+    }
+
+    static void Unmount()
+    {
+        mounted().Close();
+    }
+
+    static const AssetPack* Mounted()
+    {
+        return mounted().IsOpen() ? &mounted() : nullptr;
+    }
+
+private:
+    MappedFile file;
+    const PackHeader *header = nullptr;
+    const PackEntry *entries = nullptr;
+
+    // true if [offset, offset + size) lies within the first limit bytes, without overflowing
+    static bool within(std::uint64_t offset, std::uint64_t size, std::uint64_t limit)
+    {
+        return offset <= limit && size <= limit - offset;
+    }
+
+    // every table, path, vertex and index range of a model payload inside the entry
+    bool validModel(const PackEntry &entry) const
+    {
+        if (entry.size < sizeof(PackedModel))
+            return false;
+        const char *payload = Payload(entry);
+        const PackedModel &model = *reinterpret_cast<const PackedModel*>(payload);
+        std::uint64_t tables = sizeof(PackedModel) + static_cast<std::uint64_t>(model.textureCount) * sizeof(PackedModelTexture) +
+                static_cast<std::uint64_t>(model.meshCount) * sizeof(PackedMesh);
+        if (tables > entry.size)
+            return false;
+        const PackedModelTexture *textures = reinterpret_cast<const PackedModelTexture*>(payload + sizeof(PackedModel));
+        const PackedMesh *meshes = reinterpret_cast<const PackedMesh*>(textures + model.textureCount);
+        const PackedMeshTexture *meshTextures = reinterpret_cast<const PackedMeshTexture*>(meshes + model.meshCount);
+        for (std::uint32_t i = 0; i < model.textureCount; i++)
+            if (!within(textures[i].pathOffset, textures[i].pathLength, entry.size))
+                return false;
+        for (std::uint32_t i = 0; i < model.meshCount; i++) {
+            const PackedMesh &mesh = meshes[i];
+            if (!within(mesh.verticesOffset, static_cast<std::uint64_t>(mesh.vertexCount) * sizeof(Vertex), entry.size) ||
+                    !within(mesh.indicesOffset, static_cast<std::uint64_t>(mesh.indexCount) * sizeof(unsigned int), entry.size) ||
+                    !within(tables + static_cast<std::uint64_t>(mesh.firstTexture) * sizeof(PackedMeshTexture),
+                            static_cast<std::uint64_t>(mesh.textureCount) * sizeof(PackedMeshTexture), entry.size))
+                return false;
+            for (std::uint32_t t = 0; t < mesh.textureCount; t++)
+                if (meshTextures[mesh.firstTexture + t].texture >= model.textureCount)
+                    return false;
+        }
+        return true;
+    }
+
+    // every mip level of a texture payload inside the entry, at the size its header implies
+    bool validTexture(const PackEntry &entry) const
+    {
+        if (entry.size < sizeof(PackedTexture))
+            return false;
+        const PackedTexture &packed = *reinterpret_cast<const PackedTexture*>(Payload(entry));
+        // larger than any GL texture, and the level sizes below stay in range
+        const std::uint32_t maxSize = 1u << 16;
+        if (packed.width == 0 || packed.width > maxSize || packed.height == 0 || packed.height > maxSize ||
+                packed.components == 0 || packed.components > 4 || packed.levels == 0 || packed.levels > PACK_MAX_LEVELS ||
+                packed.format > static_cast<std::uint32_t>(BlockFormat::BC5))
+            return false;
+        BlockFormat format = static_cast<BlockFormat>(packed.format);
+        for (std::uint32_t level = 0; level < packed.levels; level++) {
+            int width = std::max(static_cast<int>(packed.width >> level), 1);
+            int height = std::max(static_cast<int>(packed.height >> level), 1);
+            std::uint64_t size = format == BlockFormat::NONE ? static_cast<std::uint64_t>(width) * height * packed.components :
+                    CompressedLevelSize(format, width, height);
+            if (!within(packed.levelOffsets[level], size, entry.size) || packed.levelOffsets[level] < packed.levelOffsets[0])
+                return false;
+        }
+        return true;
+    }
+
+    static AssetPack& mounted()
+    {
+        static AssetPack pack;
+        return pack;
+    }
+};
+
+// Write side, used by the cooker: collects payloads in memory and writes the pack in one go.
+class AssetPackWriter
+{
+public:
+    // the model's textures must be added separately with AddTexture, named <directory>/<path>
+    void AddModel(const std::string &name, const ModelData &data)
+    {
+        std::vector<char> payload;
+        PackedModel model = {};
+        model.meshCount = static_cast<std::uint32_t>(data.meshes.size());
+        model.textureCount = static_cast<std::uint32_t>(data.textures.size());
+        for (int i = 0; i < 3; i++) {
+            model.boundsMin[i] = data.bounds.min[i];
+            model.boundsMax[i] = data.bounds.max[i];
+        }
+        append(payload, &model, sizeof(model));
+
+        // fixed size tables first, their offsets get patched once the variable data is placed
+        std::size_t texturesAt = payload.size();
+        payload.resize(payload.size() + data.textures.size() * sizeof(PackedModelTexture));
+        std::size_t meshesAt = payload.size();
+        payload.resize(payload.size() + data.meshes.size() * sizeof(PackedMesh));
+
+        std::vector<PackedMeshTexture> meshTextures;
+        std::vector<PackedMesh> meshes(data.meshes.size());
+        for (std::size_t i = 0; i < data.meshes.size(); i++) {
+            meshes[i].firstTexture = static_cast<std::uint32_t>(meshTextures.size());
+            meshes[i].textureCount = static_cast<std::uint32_t>(data.meshes[i].textures.size());
+            for (const pair<unsigned int, TextureRole> &reference : data.meshes[i].textures)
+                meshTextures.push_back({ reference.first, static_cast<std::uint32_t>(reference.second) });
+        }
+        append(payload, meshTextures.data(), meshTextures.size() * sizeof(PackedMeshTexture));
+
+        std::vector<PackedModelTexture> textures(data.textures.size());
+        for (std::size_t i = 0; i < data.textures.size(); i++) {
+            textures[i].pathOffset = static_cast<std::uint32_t>(payload.size());
+            textures[i].pathLength = static_cast<std::uint32_t>(data.textures[i].path.size());
+            textures[i].role = static_cast<std::uint32_t>(data.textures[i].role);
+            textures[i].reserved = 0;
+            append(payload, data.textures[i].path.data(), data.textures[i].path.size());
+        }
+
+        for (std::size_t i = 0; i < data.meshes.size(); i++) {
+            const ImportedMesh &mesh = data.meshes[i];
+            align(payload);
+            meshes[i].verticesOffset = payload.size();
+            meshes[i].vertexCount = static_cast<std::uint32_t>(mesh.vertices.size());
+            append(payload, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            align(payload);
+            meshes[i].indicesOffset = payload.size();
+            meshes[i].indexCount = static_cast<std::uint32_t>(mesh.indices.size());
+            append(payload, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        }
+
+        if (!textures.empty())
+            std::memcpy(&payload[texturesAt], textures.data(), textures.size() * sizeof(PackedModelTexture));
+        if (!meshes.empty())
+            std::memcpy(&payload[meshesAt], meshes.data(), meshes.size() * sizeof(PackedMesh));
+        add(name, PACK_MODEL, std::move(payload));
+    }
+
+    // levels[0] is the full image, each next level half the size (rounded down, at least 1),
+    // either raw pixels or compressed to format
+    void AddTexture(const std::string &name, int width, int height, int components, const std::vector<std::vector<unsigned char>> &levels,
+            BlockFormat format = BlockFormat::NONE)
+    {
+        std::vector<char> payload;
+        PackedTexture texture = {};
+        texture.width = static_cast<std::uint32_t>(width);
+        texture.height = static_cast<std::uint32_t>(height);
+        texture.components = static_cast<std::uint32_t>(components);
+        texture.levels = static_cast<std::uint32_t>(std::min<std::size_t>(levels.size(), PACK_MAX_LEVELS));
+        texture.format = static_cast<std::uint32_t>(format);
+        payload.resize(sizeof(PackedTexture));
+        for (std::uint32_t level = 0; level < texture.levels; level++) {
+            align(payload);
+            texture.levelOffsets[level] = payload.size();
+            append(payload, levels[level].data(), levels[level].size());
+        }
+        std::memcpy(&payload[0], &texture, sizeof(texture));
+        add(name, PACK_TEXTURE, std::move(payload));
+    }
+
+    bool Contains(const std::string &name) const
+    {
+        for (const Pending &entry : pending)
+            if (entry.name == name)
+                return true;
+        return false;
+    }
+
+    bool Write(const std::string &path)
+    {
+        std::sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) { return a.name < b.name; });
+
+        std::vector<char> out(sizeof(PackHeader));
+        std::vector<PackEntry> index(pending.size());
+        std::string names;
+        for (std::size_t i = 0; i < pending.size(); i++) {
+            align(out);
+            index[i].offset = out.size();
+            index[i].size = pending[i].payload.size();
+            index[i].hash = PackHash(pending[i].payload.data(), pending[i].payload.size());
+            index[i].sourceSize = pending[i].sourceSize;
+            index[i].sourceTime = pending[i].sourceTime;
+            index[i].nameOffset = static_cast<std::uint32_t>(names.size());
+            index[i].nameLength = static_cast<std::uint32_t>(pending[i].name.size());
+            index[i].type = pending[i].type;
+            index[i].reserved = 0;
+            append(out, pending[i].payload.data(), pending[i].payload.size());
+            names += pending[i].name;
+        }
+
+        PackHeader header = {};
+        std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+        header.version = PACK_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.entryCount = static_cast<std::uint32_t>(index.size());
+        align(out);
+        header.entriesOffset = out.size();
+        append(out, index.data(), index.size() * sizeof(PackEntry));
+        header.namesOffset = out.size();
+        append(out, names.data(), names.size());
+        std::memcpy(&out[0], &header, sizeof(header));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(out.data(), static_cast<std::streamsize>(out.size()))) {
+            std::cout << "ERROR::ASSET_PACK:: failed to write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    struct Pending {
+        std::string name;
+        PackEntryType type;
+        std::vector<char> payload;
+        std::uint64_t sourceSize;
+        std::int64_t sourceTime;
+    };
+    std::vector<Pending> pending;
+
+    // names are the paths the runtime opens, stamp the file they were cooked from
+    void add(const std::string &name, PackEntryType type, std::vector<char> payload)
+    {
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+        if (!PackSourceStamp(name, size, time))
+            std::cout << "WARNING::ASSET_PACK:: can't stat " << name << ", edits to it won't be noticed" << std::endl;
+        pending.push_back({ name, type, std::move(payload), size, time });
+    }
+
+    static void append(std::vector<char> &out, const void *data, std::size_t size)
+    {
+        if (size > 0)
+            out.insert(out.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    }
+
+    static void align(std::vector<char> &out)
+    {
+        out.resize((out.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT, 0);
+    }
+};
+#endif
@@ -0,0 +1,114 @@
+#ifndef ASTEROID_FIELD_H
+#define ASTEROID_FIELD_H
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+// rings of randomly placed, scaled and rotated asteroids around the origin
+struct AsteroidField {
+    unsigned int amount = 100000;   // total number of asteroids
+    unsigned int rings = 7;         // asteroids are distributed evenly across the rings
+    float baseRadius = 150.0f;      // radius of the innermost ring
+    float ringSpacing = 90.0f;      // space between each ring
+    float offset = 25.0f;           // random offset for each asteroid within a ring
+    unsigned int seed = 0;
+};
+
+// splitmix64 finalizer: nearby inputs give unrelated outputs
+inline std::uint64_t MixSeed(std::uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// model matrix of one asteroid. Every asteroid has its own random stream seeded from its
+// index, so the result doesn't depend on how the field is split across threads.
+inline glm::mat4 AsteroidMatrix(const AsteroidField &field, unsigned int index)
+{
+    // at least one asteroid per ring, fewer asteroids than rings leave the outer rings empty
+    unsigned int rings = std::max(1u, std::min(field.rings, field.amount));
+    unsigned int asteroidsPerRing = std::max(1u, field.amount / rings);
+    // leftovers of the division go to the last ring
+    unsigned int ring = std::min(index / asteroidsPerRing, rings - 1);
+    unsigned int i = index - ring * asteroidsPerRing;
+    float currentRadius = field.baseRadius + field.ringSpacing * ring;
+
+    // the LCG's first draws follow its seed linearly, so neighbouring asteroids get hashed
+    // seeds (in [1, modulus), 0 would stay 0)
+    std::uint64_t mixed = MixSeed((static_cast<std::uint64_t>(field.seed) << 32) | index);
+    std::minstd_rand random(static_cast<std::minstd_rand::result_type>(mixed % (std::minstd_rand::modulus - 1) + 1));
+    int range = (int)(2 * field.offset * 100);
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // 1. Translation: displace along circle with 'currentRadius' in range [-offset, offset]
+    float angle = (float)i / (float)asteroidsPerRing * 360.0f;
+    float displacement = (random() % range) / 100.0f - field.offset;
+    float x = sin(glm::radians(angle)) * currentRadius + displacement;
+    displacement = (random() % range) / 100.0f - field.offset;
+    float y = displacement * 0.4f; // Keep height of asteroid field smaller compared to width of x and z
+    displacement = (random() % range) / 100.0f - field.offset;
+    float z = cos(glm::radians(angle)) * currentRadius + displacement;
+    model = glm::translate(model, glm::vec3(x, y, z));
+
+    // 2. Scale: Scale between 0.05 and 0.25f
+    float scale = static_cast<float>((random() % 20) / 100.0 + 0.05);
+    model = glm::scale(model, glm::vec3(scale));
+
+    // 3. Rotation: add random rotation around a (semi)randomly picked rotation axis vector
+    float rotAngle = static_cast<float>((random() % 360));
+    model = glm::rotate(model, glm::radians(rotAngle), glm::vec3(0.4f, 0.6f, 0.8f));
+
+    return model;
+}
+
+// largest scale AsteroidMatrix gives an asteroid
+const float ASTEROID_MAX_SCALE = 0.25f;
+
+// the point closest to position where an asteroid's center can be, from the ring layout
+// alone: a bound on the nearest asteroid that costs one test per ring, not per asteroid
+inline glm::vec3 AsteroidFieldClosestPoint(const AsteroidField &field, const glm::vec3 &position)
+{
+    unsigned int rings = std::max(1u, std::min(field.rings, field.amount));
+    // the x and z displacements move an asteroid at most this far off its ring
+    float spread = field.offset * std::sqrt(2.0f);
+    float height = field.offset * 0.4f;
+    float planarDistance = std::sqrt(position.x * position.x + position.z * position.z);
+    // straight above the center every direction is as close, take +z
+    float directionX = planarDistance > 0.0f ? position.x / planarDistance : 0.0f;
+    float directionZ = planarDistance > 0.0f ? position.z / planarDistance : 1.0f;
+    float y = glm::clamp(position.y, -height, height);
+
+    glm::vec3 closest(0.0f);
+    float closestDistance = -1.0f;
+    for (unsigned int ring = 0; ring < rings; ring++) {
+        float radius = field.baseRadius + field.ringSpacing * ring;
+        float clamped = glm::clamp(planarDistance, std::max(0.0f, radius - spread), radius + spread);
+        glm::vec3 point(directionX * clamped, y, directionZ * clamped);
+        glm::vec3 offset = point - position;
+        float distance = glm::dot(offset, offset);
+        if (closestDistance < 0.0f || distance < closestDistance) {
+            closestDistance = distance;
+            closest = point;
+        }
+    }
+    return closest;
+}
+
+// fills matrices[0, field.amount) in parallel
+inline void GenerateAsteroidMatrices(const AsteroidField &field, glm::mat4 *matrices, JobSystem &jobs = JobSystem::Global())
+{
+    jobs.ParallelFor(0, field.amount, 1024, [&field, matrices](std::size_t begin, std::size_t end) {
+        for (std::size_t index = begin; index < end; index++)
+            matrices[index] = AsteroidMatrix(field, static_cast<unsigned int>(index));
+    });
+}
+#endif
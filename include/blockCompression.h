@@ -0,0 +1,270 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// GPU block compression formats (S3TC/RGTC), 4x4 texel blocks
+enum class BlockFormat : std::uint32_t {
+    NONE,
+    BC1,    // RGB, 8 bytes per block
+    BC3,    // RGBA: BC4 encoded alpha + BC1 color, 16 bytes
+    BC4,    // one channel, 8 bytes
+    BC5     // two channels (tangent space normal xy), 16 bytes
+};
+
+inline const char* BlockFormatName(BlockFormat format)
+{
+    switch (format) {
+    case BlockFormat::BC1: return "BC1";
+    case BlockFormat::BC3: return "BC3";
+    case BlockFormat::BC4: return "BC4";
+    case BlockFormat::BC5: return "BC5";
+    default:               return "uncompressed";
+    }
+}
+
+inline std::size_t BlockBytes(BlockFormat format)
+{
+    return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+// bytes of one width x height level, partial blocks at the edges count whole
+inline std::size_t CompressedLevelSize(BlockFormat format, int width, int height)
+{
+    return static_cast<std::size_t>((width + 3) / 4) * static_cast<std::size_t>((height + 3) / 4) * BlockBytes(format);
+}
+
+// Block encoders. Quality is in the range of the usual "fast" real-time encoders: endpoints
+// from the principal axis of the block's colors, refined once by least squares.
+namespace BlockEncoder
+{
+    inline std::uint16_t to565(const float color[3])
+    {
+        int r = std::min(std::max(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+        int g = std::min(std::max(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+        int b = std::min(std::max(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+        return static_cast<std::uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    inline void from565(std::uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // picks the nearest of the four palette colors per texel, returns the squared error
+    inline int bc1Indices(const std::uint8_t rgba[16][4], std::uint16_t c0, std::uint16_t c1, std::uint32_t &indices)
+    {
+        int palette[4][3];
+        from565(c0, palette[0]);
+        from565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        indices = 0;
+        int error = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = rgba[i][0] - palette[p][0], dg = rgba[i][1] - palette[p][1], db = rgba[i][2] - palette[p][2];
+                int e = dr * dr + dg * dg + db * db;
+                if (e < bestError) {
+                    bestError = e;
+                    best = p;
+                }
+            }
+            indices |= static_cast<std::uint32_t>(best) << (2 * i);
+            error += bestError;
+        }
+        return error;
+    }
+
+    inline void writeBC1(std::uint16_t c0, std::uint16_t c1, std::uint32_t indices, std::uint8_t *out)
+    {
+        out[0] = static_cast<std::uint8_t>(c0 & 0xFF);
+        out[1] = static_cast<std::uint8_t>(c0 >> 8);
+        out[2] = static_cast<std::uint8_t>(c1 & 0xFF);
+        out[3] = static_cast<std::uint8_t>(c1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = static_cast<std::uint8_t>(indices >> (8 * i));
+    }
+
+    // four color mode only (c0 > c1), alpha is ignored
+    inline void EncodeBC1(const std::uint8_t rgba[16][4], std::uint8_t *out)
+    {
+        // principal axis of the colors by power iteration on their covariance
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+            for (int c = 0; c < 3; c++)
+                mean[c] += rgba[i][c] / 16.0f;
+        float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++) {
+            float r = rgba[i][0] - mean[0], g = rgba[i][1] - mean[1], b = rgba[i][2] - mean[2];
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 4; iteration++) {
+            float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+            if (length < 1e-6f)
+                break;
+            axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+        }
+
+        // extremes along the axis are the endpoints
+        float minDot = 1e30f, maxDot = -1e30f;
+        int minIndex = 0, maxIndex = 0;
+        for (int i = 0; i < 16; i++) {
+            float d = rgba[i][0] * axis[0] + rgba[i][1] * axis[1] + rgba[i][2] * axis[2];
+            if (d < minDot) { minDot = d; minIndex = i; }
+            if (d > maxDot) { maxDot = d; maxIndex = i; }
+        }
+        float high[3] = { float(rgba[maxIndex][0]), float(rgba[maxIndex][1]), float(rgba[maxIndex][2]) };
+        float low[3] = { float(rgba[minIndex][0]), float(rgba[minIndex][1]), float(rgba[minIndex][2]) };
+        std::uint16_t c0 = to565(high), c1 = to565(low);
+        if (c0 < c1)
+            std::swap(c0, c1);
+        if (c0 == c1) {
+            // flat block: every texel takes color0
+            writeBC1(c0, c1, 0, out);
+            return;
+        }
+        std::uint32_t indices;
+        int error = bc1Indices(rgba, c0, c1, indices);
+
+        // least squares endpoints for the chosen indices
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = { 0.0f, 0.0f, 0.0f }, bx[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++) {
+            float a = weights[(indices >> (2 * i)) & 3], b = 1.0f - a;
+            aa += a * a; bb += b * b; ab += a * b;
+            for (int c = 0; c < 3; c++) {
+                ax[c] += a * rgba[i][c];
+                bx[c] += b * rgba[i][c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f) {
+            for (int c = 0; c < 3; c++) {
+                high[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                low[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            std::uint16_t r0 = to565(high), r1 = to565(low);
+            if (r0 < r1)
+                std::swap(r0, r1);
+            std::uint32_t refined;
+            if (r0 != r1 && bc1Indices(rgba, r0, r1, refined) < error) {
+                c0 = r0;
+                c1 = r1;
+                indices = refined;
+            }
+        }
+        writeBC1(c0, c1, indices, out);
+    }
+
+    // eight value mode (a0 > a1) over the block's range
+    inline void EncodeBC4(const std::uint8_t values[16], std::uint8_t *out)
+    {
+        int low = 255, high = 0;
+        for (int i = 0; i < 16; i++) {
+            low = std::min(low, int(values[i]));
+            high = std::max(high, int(values[i]));
+        }
+        out[0] = static_cast<std::uint8_t>(high);
+        out[1] = static_cast<std::uint8_t>(low);
+        std::uint64_t bits = 0;
+        if (high > low) {
+            int palette[8];
+            palette[0] = high;
+            palette[1] = low;
+            for (int i = 2; i < 8; i++)
+                palette[i] = ((8 - i) * high + (i - 1) * low + 3) / 7;
+            for (int i = 0; i < 16; i++) {
+                int best = 0, bestError = 256;
+                for (int p = 0; p < 8; p++) {
+                    int e = std::abs(values[i] - palette[p]);
+                    if (e < bestError) {
+                        bestError = e;
+                        best = p;
+                    }
+                }
+                bits |= static_cast<std::uint64_t>(best) << (3 * i);
+            }
+        }
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+}
+
+// Compresses one 8 bit image (1 to 4 components, as decoded by stb_image) into format.
+// Grey images expand to RGB for BC1/BC3; BC4 takes the luminance of color images (the red
+// channel of grey ones), BC5 the first two color channels. Rows of blocks are encoded in
+// parallel.
+inline std::vector<unsigned char> CompressImage(const unsigned char *pixels, int width, int height, int components,
+        BlockFormat format, JobSystem &jobs = JobSystem::Global())
+{
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    std::size_t blockBytes = BlockBytes(format);
+    std::vector<unsigned char> out(static_cast<std::size_t>(blocksWide) * blocksHigh * blockBytes);
+
+    jobs.ParallelFor(0, static_cast<std::size_t>(blocksHigh), 8, [&](std::size_t begin, std::size_t end) {
+        std::uint8_t rgba[16][4];
+        std::uint8_t channel[16];
+        for (std::size_t by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksWide; bx++) {
+                // gather the block as RGBA, edge texels repeat into partial blocks
+                for (int i = 0; i < 16; i++) {
+                    int x = std::min(bx * 4 + (i & 3), width - 1);
+                    int y = std::min(static_cast<int>(by) * 4 + (i >> 2), height - 1);
+                    const unsigned char *texel = pixels + (static_cast<std::size_t>(y) * width + x) * components;
+                    bool grey = components < 3;
+                    rgba[i][0] = texel[0];
+                    rgba[i][1] = grey ? texel[0] : texel[1];
+                    rgba[i][2] = grey ? texel[0] : texel[2];
+                    rgba[i][3] = components == 2 ? texel[1] : components == 4 ? texel[3] : 255;
+                }
+                unsigned char *block = &out[(by * blocksWide + bx) * blockBytes];
+                switch (format) {
+                case BlockFormat::BC1:
+                    BlockEncoder::EncodeBC1(rgba, block);
+                    break;
+                case BlockFormat::BC3:
+                    for (int i = 0; i < 16; i++)
+                        channel[i] = rgba[i][3];
+                    BlockEncoder::EncodeBC4(channel, block);
+                    BlockEncoder::EncodeBC1(rgba, block + 8);
+                    break;
+                case BlockFormat::BC4:
+                    for (int i = 0; i < 16; i++)
+                        channel[i] = static_cast<std::uint8_t>((rgba[i][0] + 2 * rgba[i][1] + rgba[i][2] + 2) / 4);
+                    BlockEncoder::EncodeBC4(channel, block);
+                    break;
+                case BlockFormat::BC5:
+                    for (int i = 0; i < 16; i++)
+                        channel[i] = rgba[i][0];
+                    BlockEncoder::EncodeBC4(channel, block);
+                    for (int i = 0; i < 16; i++)
+                        channel[i] = rgba[i][1];
+                    BlockEncoder::EncodeBC4(channel, block + 8);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    });
+    return out;
+}
+#endif
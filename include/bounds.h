@@ -0,0 +1,157 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// Axis aligned box and bounding sphere of a set of points, in the space of those points.
+// Computed once (at import for model geometry) so culling, LOD and picking get them in
+// constant time. Empty until built from at least one point.
+struct Bounds {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    glm::vec3 center = glm::vec3(0.0f);     // of the sphere, the box center for point sets
+    float radius = -1.0f;
+
+    bool Empty() const { return radius < 0.0f; }
+    // extent of the box along each axis
+    glm::vec3 Size() const { return Empty() ? glm::vec3(0.0f) : max - min; }
+    glm::vec3 BoxCenter() const { return Empty() ? glm::vec3(0.0f) : (min + max) * 0.5f; }
+
+    // bounds of count points stride bytes apart, e.g. the Position of every Vertex in an array
+    static Bounds FromPoints(const glm::vec3 *points, std::size_t count, std::size_t stride = sizeof(glm::vec3))
+    {
+        Bounds bounds;
+        if (count == 0)
+            return bounds;
+        const unsigned char *base = reinterpret_cast<const unsigned char*>(points);
+        // a 4 float load of a point reads one float past it, not allowed for the last packed point
+        std::size_t wide = stride >= 4 * sizeof(float) ? count : count - 1;
+#if defined(__SSE__)
+        // min/max of x, y, z in the low three lanes, two accumulators to hide latency
+        __m128 first = load(base, 0, stride, wide);
+        __m128 min0 = first, max0 = first, min1 = first, max1 = first;
+        std::size_t i = 1;
+        for (; i + 1 < wide; i += 2) {
+            __m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(base + i * stride));
+            __m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(base + (i + 1) * stride));
+            min0 = _mm_min_ps(min0, a);
+            max0 = _mm_max_ps(max0, a);
+            min1 = _mm_min_ps(min1, b);
+            max1 = _mm_max_ps(max1, b);
+        }
+        for (; i < count; i++) {
+            __m128 a = load(base, i, stride, wide);
+            min0 = _mm_min_ps(min0, a);
+            max0 = _mm_max_ps(max0, a);
+        }
+        float low[4], high[4];
+        _mm_storeu_ps(low, _mm_min_ps(min0, min1));
+        _mm_storeu_ps(high, _mm_max_ps(max0, max1));
+        bounds.min = glm::vec3(low[0], low[1], low[2]);
+        bounds.max = glm::vec3(high[0], high[1], high[2]);
+#else
+        for (std::size_t i = 0; i < count; i++) {
+            const glm::vec3 &point = *reinterpret_cast<const glm::vec3*>(base + i * stride);
+            bounds.min = glm::min(bounds.min, point);
+            bounds.max = glm::max(bounds.max, point);
+        }
+#endif
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        bounds.radius = std::sqrt(farthest(base, count, stride, wide, bounds.center));
+        return bounds;
+    }
+
+    // grows the box and the sphere to contain other as well
+    void Merge(const Bounds &other)
+    {
+        if (other.Empty())
+            return;
+        if (Empty()) {
+            *this = other;
+            return;
+        }
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+        float distance = glm::length(other.center - center);
+        if (distance + other.radius <= radius)
+            return;
+        if (distance + radius <= other.radius) {
+            center = other.center;
+            radius = other.radius;
+            return;
+        }
+        float merged = (distance + radius + other.radius) * 0.5f;
+        center += (other.center - center) * ((merged - radius) / distance);
+        radius = merged;
+    }
+
+    // bounds of the points after an affine transform such as an instance's model matrix: the
+    // box enclosing the transformed box, and the sphere scaled by the largest axis scale
+    Bounds Transformed(const glm::mat4 &transform) const
+    {
+        if (Empty())
+            return *this;
+        glm::mat3 linear(transform);
+        glm::vec3 boxCenter = glm::vec3(transform * glm::vec4(BoxCenter(), 1.0f));
+        glm::vec3 halfSize = (max - min) * 0.5f;
+        glm::vec3 extent = glm::abs(linear[0]) * halfSize.x + glm::abs(linear[1]) * halfSize.y + glm::abs(linear[2]) * halfSize.z;
+
+        Bounds transformed;
+        transformed.min = boxCenter - extent;
+        transformed.max = boxCenter + extent;
+        transformed.center = glm::vec3(transform * glm::vec4(center, 1.0f));
+        float scale = std::max(std::max(glm::dot(linear[0], linear[0]), glm::dot(linear[1], linear[1])), glm::dot(linear[2], linear[2]));
+        transformed.radius = radius * std::sqrt(scale);
+        return transformed;
+    }
+
+private:
+#if defined(__SSE__)
+    static __m128 load(const unsigned char *base, std::size_t i, std::size_t stride, std::size_t wide)
+    {
+        const float *point = reinterpret_cast<const float*>(base + i * stride);
+        return i < wide ? _mm_loadu_ps(point) : _mm_set_ps(0.0f, point[2], point[1], point[0]);
+    }
+#endif
+
+    // largest squared distance from center to any of the points
+    static float farthest(const unsigned char *base, std::size_t count, std::size_t stride, std::size_t wide, const glm::vec3 &center)
+    {
+        std::size_t i = 0;
+        float result = 0.0f;
+#if defined(__SSE__)
+        // four points per step, transposed so each lane holds one point's distance
+        const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+        __m128 best = _mm_setzero_ps();
+        for (; i + 4 <= wide; i += 4) {
+            __m128 p0 = _mm_loadu_ps(reinterpret_cast<const float*>(base + i * stride));
+            __m128 p1 = _mm_loadu_ps(reinterpret_cast<const float*>(base + (i + 1) * stride));
+            __m128 p2 = _mm_loadu_ps(reinterpret_cast<const float*>(base + (i + 2) * stride));
+            __m128 p3 = _mm_loadu_ps(reinterpret_cast<const float*>(base + (i + 3) * stride));
+            _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+            __m128 dx = _mm_sub_ps(p0, cx), dy = _mm_sub_ps(p1, cy), dz = _mm_sub_ps(p2, cz);
+            __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            best = _mm_max_ps(best, squared);
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, best);
+        result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+        for (; i < count; i++) {
+            const float *point = reinterpret_cast<const float*>(base + i * stride);
+            glm::vec3 offset = glm::vec3(point[0], point[1], point[2]) - center;
+            result = std::max(result, glm::dot(offset, offset));
+        }
+        return result;
+    }
+};
+#endif
@@ -0,0 +1,328 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include "shader.h"
+#include "model.h"
+
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class RenderCommand : unsigned char {
+    UNIFORM_INT,
+    UNIFORM_FLOAT,
+    UNIFORM_VEC3,
+    UNIFORM_MAT4,
+    UNIFORM_BLOCK,
+    BUFFER_WRITE,
+    BIND_FRAMEBUFFER,
+    VIEWPORT,
+    CLEAR,
+    BIND_TEXTURE,
+    DRAW_MODEL,
+    DRAW_MODEL_INSTANCED,
+    DRAW_ARRAYS
+};
+
+// A list of render commands recorded without touching GL, so any thread can fill one.
+// Uniform values, uniform block contents and instance data are copied into the list's
+// payload at record time; nothing recorded may change until the list has been replayed.
+// Every uniform and draw command names the program it belongs to, the replayer switches
+// programs as needed, so lists recorded in parallel can be replayed in any order that
+// respects their draw order.
+class CommandList
+{
+public:
+    // forget the recorded commands, keeping the allocations for the next frame
+    void Reset()
+    {
+        packets.clear();
+        payload.clear();
+    }
+
+    // uniforms, resolved by name on the GL thread
+    void SetInt(const Shader &shader, const std::string &name, int value)
+    {
+        uniform(RenderCommand::UNIFORM_INT, shader, name, &value, sizeof(value));
+    }
+    void SetFloat(const Shader &shader, const std::string &name, float value)
+    {
+        uniform(RenderCommand::UNIFORM_FLOAT, shader, name, &value, sizeof(value));
+    }
+    void SetVec3(const Shader &shader, const std::string &name, const glm::vec3 &value)
+    {
+        uniform(RenderCommand::UNIFORM_VEC3, shader, name, glm::value_ptr(value), sizeof(glm::vec3));
+    }
+    void SetMat4(const Shader &shader, const std::string &name, const glm::mat4 &value)
+    {
+        uniform(RenderCommand::UNIFORM_MAT4, shader, name, glm::value_ptr(value), sizeof(glm::mat4));
+    }
+
+    // replace the contents of the uniform buffer bound to the given binding point
+    void WriteUniformBlock(unsigned int binding, const void *data, std::size_t size)
+    {
+        Packet &packet = push(RenderCommand::UNIFORM_BLOCK, 0);
+        packet.args[0] = binding;
+        packet.offset = append(data, size);
+        packet.size = size;
+    }
+
+    // update part of an existing buffer, e.g. per instance attributes
+    void WriteBuffer(unsigned int buffer, std::size_t offset, const void *data, std::size_t size)
+    {
+        Packet &packet = push(RenderCommand::BUFFER_WRITE, 0);
+        packet.args[0] = buffer;
+        packet.args[1] = static_cast<unsigned int>(offset);
+        packet.offset = append(data, size);
+        packet.size = size;
+    }
+
+    // pipeline state
+    void BindFramebuffer(unsigned int framebuffer)
+    {
+        push(RenderCommand::BIND_FRAMEBUFFER, 0).args[0] = framebuffer;
+    }
+    void Viewport(int x, int y, int width, int height)
+    {
+        Packet &packet = push(RenderCommand::VIEWPORT, 0);
+        packet.args[0] = static_cast<unsigned int>(x);
+        packet.args[1] = static_cast<unsigned int>(y);
+        packet.args[2] = static_cast<unsigned int>(width);
+        packet.args[3] = static_cast<unsigned int>(height);
+    }
+    void Clear(unsigned int mask)
+    {
+        push(RenderCommand::CLEAR, 0).args[0] = mask;
+    }
+    void BindTexture(unsigned int unit, unsigned int target, unsigned int texture)
+    {
+        Packet &packet = push(RenderCommand::BIND_TEXTURE, 0);
+        packet.args[0] = unit;
+        packet.args[1] = target;
+        packet.args[2] = texture;
+    }
+
+    // draws
+    void DrawModel(const Model &model, const Shader &shader)
+    {
+        Packet &packet = push(RenderCommand::DRAW_MODEL, shader.ID);
+        packet.model = &model;
+        packet.shader = &shader;
+    }
+    // every mesh of the model, instanced with attributes already set up on the given VAO.
+    // With bindMaterials each mesh's material is bound before its draw (in material order,
+    // like Model::Draw); otherwise whatever textures are bound are used for every mesh.
+    void DrawModelInstanced(const Model &model, const Shader &shader, unsigned int VAO, unsigned int instances, bool bindMaterials = false)
+    {
+        Packet &packet = push(RenderCommand::DRAW_MODEL_INSTANCED, shader.ID);
+        packet.model = &model;
+        packet.shader = &shader;
+        packet.args[0] = VAO;
+        packet.args[1] = instances;
+        packet.args[2] = bindMaterials ? 1 : 0;
+    }
+    void DrawArrays(const Shader &shader, unsigned int VAO, unsigned int mode, int first, int count)
+    {
+        Packet &packet = push(RenderCommand::DRAW_ARRAYS, shader.ID);
+        packet.args[0] = VAO;
+        packet.args[1] = mode;
+        packet.args[2] = static_cast<unsigned int>(first);
+        packet.args[3] = static_cast<unsigned int>(count);
+    }
+
+    unsigned int Size() const { return static_cast<unsigned int>(packets.size()); }
+
+private:
+    friend class CommandReplayer;
+
+    struct Packet {
+        RenderCommand type;
+        unsigned int program;       // 0 for commands that don't need a program
+        unsigned int args[4];
+        const Model *model;
+        const Shader *shader;
+        std::size_t offset;         // payload range: uniform name + value, or raw data
+        std::size_t size;
+    };
+
+    std::vector<Packet> packets;
+    std::vector<unsigned char> payload;
+
+    Packet& push(RenderCommand type, unsigned int program)
+    {
+        Packet packet = {};
+        packet.type = type;
+        packet.program = program;
+        packets.push_back(packet);
+        return packets.back();
+    }
+
+    std::size_t append(const void *data, std::size_t size)
+    {
+        std::size_t offset = payload.size();
+        payload.resize(offset + size);
+        if (size > 0)
+            std::memcpy(&payload[offset], data, size);
+        return offset;
+    }
+
+    // payload holds the null terminated name followed by the value
+    void uniform(RenderCommand type, const Shader &shader, const std::string &name, const void *value, std::size_t size)
+    {
+        std::size_t offset = append(name.c_str(), name.size() + 1);
+        append(value, size);
+        Packet &packet = push(type, shader.ID);
+        packet.offset = offset;
+        packet.size = name.size() + 1 + size;
+        packet.args[0] = static_cast<unsigned int>(name.size() + 1);
+    }
+};
+
+// Executes command lists on the GL thread. Keeps the uniform location cache and the
+// buffers backing uniform block writes alive between frames.
+class CommandReplayer
+{
+public:
+    // commands executed by the last Replay
+    unsigned int PacketsReplayed = 0;
+
+    // replays the lists in order as if they were one, leaves no program in use
+    void Replay(const std::vector<const CommandList*> &lists)
+    {
+        PacketsReplayed = 0;
+        currentProgram = 0;
+        for (const CommandList *list : lists) {
+            for (const CommandList::Packet &packet : list->packets)
+                execute(*list, packet);
+            PacketsReplayed += list->Size();
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(0);
+        currentProgram = 0;
+    }
+
+    // drops the uniform locations cached for a deleted (or rebuilt) program
+    void Forget(unsigned int program)
+    {
+        locations.erase(program);
+    }
+
+private:
+    unsigned int currentProgram = 0;
+    std::map<unsigned int, std::unordered_map<std::string, int>> locations;
+    std::map<unsigned int, GpuBuffer> uniformBuffers;
+
+    void execute(const CommandList &list, const CommandList::Packet &packet)
+    {
+        if (packet.program != 0 && packet.program != currentProgram) {
+            glUseProgram(packet.program);
+            currentProgram = packet.program;
+        }
+        const unsigned char *data = packet.size > 0 ? &list.payload[packet.offset] : nullptr;
+
+        switch (packet.type) {
+            case RenderCommand::UNIFORM_INT: {
+                int value;
+                std::memcpy(&value, data + packet.args[0], sizeof(value));
+                glUniform1i(location(packet.program, data), value);
+                break;
+            }
+            case RenderCommand::UNIFORM_FLOAT: {
+                float value;
+                std::memcpy(&value, data + packet.args[0], sizeof(value));
+                glUniform1f(location(packet.program, data), value);
+                break;
+            }
+            case RenderCommand::UNIFORM_VEC3: {
+                float value[3];
+                std::memcpy(value, data + packet.args[0], sizeof(value));
+                glUniform3fv(location(packet.program, data), 1, value);
+                break;
+            }
+            case RenderCommand::UNIFORM_MAT4: {
+                float value[16];
+                std::memcpy(value, data + packet.args[0], sizeof(value));
+                glUniformMatrix4fv(location(packet.program, data), 1, GL_FALSE, value);
+                break;
+            }
+            case RenderCommand::UNIFORM_BLOCK: {
+                GpuBuffer &buffer = uniformBuffers[packet.args[0]];
+                if (!buffer)
+                    buffer = GpuBuffer::Create("command replayer uniform block");
+                glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+                glBufferData(GL_UNIFORM_BUFFER, packet.size, data, GL_STREAM_DRAW);
+                buffer.SetBytes(packet.size);
+                glBindBufferBase(GL_UNIFORM_BUFFER, packet.args[0], buffer);
+                glBindBuffer(GL_UNIFORM_BUFFER, 0);
+                break;
+            }
+            case RenderCommand::BUFFER_WRITE:
+                glBindBuffer(GL_ARRAY_BUFFER, packet.args[0]);
+                glBufferSubData(GL_ARRAY_BUFFER, packet.args[1], packet.size, data);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                break;
+            case RenderCommand::BIND_FRAMEBUFFER:
+                glBindFramebuffer(GL_FRAMEBUFFER, packet.args[0]);
+                break;
+            case RenderCommand::VIEWPORT:
+                glViewport(static_cast<int>(packet.args[0]), static_cast<int>(packet.args[1]),
+                        static_cast<int>(packet.args[2]), static_cast<int>(packet.args[3]));
+                break;
+            case RenderCommand::CLEAR:
+                glClear(packet.args[0]);
+                break;
+            case RenderCommand::BIND_TEXTURE:
+                glActiveTexture(GL_TEXTURE0 + packet.args[0]);
+                glBindTexture(packet.args[1], packet.args[2]);
+                break;
+            case RenderCommand::DRAW_MODEL:
+                packet.model->Draw(*packet.shader);
+                break;
+            case RenderCommand::DRAW_MODEL_INSTANCED:
+                glBindVertexArray(packet.args[0]);
+                if (packet.args[2]) {
+                    const Material *bound = nullptr;
+                    for (unsigned int index : packet.model->drawOrder) {
+                        const Mesh &mesh = packet.model->meshes[index];
+                        if (mesh.material.get() != bound) {
+                            mesh.material->Bind(*packet.shader);
+                            bound = mesh.material.get();
+                        }
+                        mesh.DrawElementsInstanced(packet.args[1]);
+                    }
+                    glActiveTexture(GL_TEXTURE0);
+                } else {
+                    for (const Mesh &mesh : packet.model->meshes)
+                        mesh.DrawElementsInstanced(packet.args[1]);
+                }
+                glBindVertexArray(0);
+                break;
+            case RenderCommand::DRAW_ARRAYS:
+                glBindVertexArray(packet.args[0]);
+                glDrawArrays(packet.args[1], static_cast<int>(packet.args[2]), static_cast<int>(packet.args[3]));
+                glBindVertexArray(0);
+                break;
+        }
+    }
+
+    // glGetUniformLocation once per program and name
+    int location(unsigned int program, const unsigned char *name)
+    {
+        const char *key = reinterpret_cast<const char*>(name);
+        std::unordered_map<std::string, int> &cache = locations[program];
+        auto it = cache.find(key);
+        if (it == cache.end())
+            it = cache.emplace(key, glGetUniformLocation(program, key)).first;
+        return it->second;
+    }
+};
+#endif
@@ -0,0 +1,156 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include "glm/glm.hpp"
+
+#include "model.h"
+#include "sceneGraph.h"
+
+#include <cstddef>
+#include <vector>
+
+// id of an object in an EntityStore, ids of destroyed entities are handed out again
+typedef unsigned int Entity;
+const Entity NO_ENTITY = ~0u;
+
+// One component type stored densely: the components of every entity that has one packed in
+// an array, next to the array of their owners. A sparse table maps an entity to its slot, so
+// Has/Get are constant time, and removal moves the last component into the freed slot to keep
+// the array packed. Systems walk Data()/Entities() (or Each) front to back; slots are not
+// stable across Remove.
+template <typename T>
+class ComponentArray
+{
+public:
+    T& Add(Entity entity, const T &component = T())
+    {
+        if (entity >= slots.size())
+            slots.resize(entity + 1, NO_SLOT);
+        if (slots[entity] != NO_SLOT)
+            return components[slots[entity]] = component;
+        slots[entity] = static_cast<unsigned int>(components.size());
+        components.push_back(component);
+        owners.push_back(entity);
+        return components.back();
+    }
+
+    void Remove(Entity entity)
+    {
+        if (!Has(entity))
+            return;
+        unsigned int slot = slots[entity];
+        unsigned int last = static_cast<unsigned int>(components.size() - 1);
+        if (slot != last) {
+            components[slot] = components[last];
+            owners[slot] = owners[last];
+            slots[owners[slot]] = slot;
+        }
+        components.pop_back();
+        owners.pop_back();
+        slots[entity] = NO_SLOT;
+    }
+
+    bool Has(Entity entity) const { return entity < slots.size() && slots[entity] != NO_SLOT; }
+    // the entity must have the component
+    T& Get(Entity entity) { return components[slots[entity]]; }
+    const T& Get(Entity entity) const { return components[slots[entity]]; }
+    // the component of entity, or null
+    T* Find(Entity entity) { return Has(entity) ? &components[slots[entity]] : nullptr; }
+
+    std::size_t Size() const { return components.size(); }
+    T* Data() { return components.data(); }
+    const T* Data() const { return components.data(); }
+    const Entity* Entities() const { return owners.data(); }
+
+    // calls fn(entity, component) for every component in storage order
+    template <typename FN>
+    void Each(FN fn)
+    {
+        for (std::size_t i = 0; i < components.size(); i++)
+            fn(owners[i], components[i]);
+    }
+
+    void Reserve(std::size_t count)
+    {
+        components.reserve(count);
+        owners.reserve(count);
+    }
+
+private:
+    enum : unsigned int { NO_SLOT = ~0u };
+
+    std::vector<T> components;
+    std::vector<Entity> owners;
+    std::vector<unsigned int> slots;    // per entity id
+};
+
+// scene components
+// ----------------
+// where the entity is: its node in the SceneGraph, the node's world matrix is its model matrix
+struct Transform {
+    SceneNode node = NO_PARENT;
+};
+
+// what is drawn: a model, or when model is null a textured quad of the scene's quad VAO
+struct Renderable {
+    Model *model = nullptr;
+    unsigned int texture = 0;
+    // never moves, drawn through the static IndirectBatch
+    bool isStatic = false;
+};
+
+// a point light at the entity's position, its model (if any) glows in the light's color
+struct Light {
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+// can be picked with the mouse ray, tested against the model bounds at the entity's transform
+struct Selectable {
+    bool selected = false;
+};
+
+// blended, drawn last and back to front; distance is the sort key of the current frame
+struct Transparent {
+    float distance = 0.0f;
+};
+
+// Entities of a scene and their components, one ComponentArray per component type. An entity
+// is only an id; what it is follows from the components it has.
+class EntityStore
+{
+public:
+    ComponentArray<Transform> transforms;
+    ComponentArray<Renderable> renderables;
+    ComponentArray<Light> lights;
+    ComponentArray<Selectable> selectables;
+    ComponentArray<Transparent> transparents;
+
+    Entity Create()
+    {
+        if (!freeIds.empty()) {
+            Entity entity = freeIds.back();
+            freeIds.pop_back();
+            return entity;
+        }
+        return nextId++;
+    }
+
+    // removes every component of entity and recycles its id
+    void Destroy(Entity entity)
+    {
+        transforms.Remove(entity);
+        renderables.Remove(entity);
+        lights.Remove(entity);
+        selectables.Remove(entity);
+        transparents.Remove(entity);
+        freeIds.push_back(entity);
+    }
+
+    // entities alive
+    std::size_t Size() const { return nextId - freeIds.size(); }
+
+private:
+    Entity nextId = 0;
+    std::vector<Entity> freeIds;
+};
+#endif
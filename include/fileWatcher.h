@@ -0,0 +1,114 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Reports watched files that were written on disk, through inotify on Linux (elsewhere it
+// never reports anything). The directory of a file is watched rather than the file, so
+// editors that save by writing a new file and renaming it over the old one are caught too;
+// only finished writes (close after write, rename into place) count. Changes pile up in the
+// kernel until Poll, which never blocks.
+class FileWatcher
+{
+public:
+    FileWatcher()
+    {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0)
+            std::cout << "WARNING::FILE_WATCHER:: inotify unavailable (errno " << errno << "), files won't be watched" << std::endl;
+#else
+        std::cout << "WARNING::FILE_WATCHER:: no file watching on this platform" << std::endl;
+#endif
+    }
+
+    ~FileWatcher()
+    {
+#ifdef __linux__
+        if (fd >= 0)
+            close(fd);
+#endif
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool Available() const { return fd >= 0; }
+
+    // reports path (as given here) from the next Poll after it's written; watching a file
+    // again does nothing
+    void Watch(const std::string &path)
+    {
+#ifdef __linux__
+        if (fd < 0)
+            return;
+        std::size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash == 0 ? 1 : slash);
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        // the same directory reached through another path gets the same descriptor back
+        int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            std::cout << "WARNING::FILE_WATCHER:: can't watch " << directory << " (errno " << errno << ")" << std::endl;
+            return;
+        }
+        std::vector<std::string> &paths = files[std::make_pair(wd, name)];
+        for (const std::string &watched : paths)
+            if (watched == path)
+                return;
+        paths.push_back(path);
+#else
+        (void)path;
+#endif
+    }
+
+    // the watched files written since the last Poll, each once
+    std::vector<std::string> Poll()
+    {
+        std::vector<std::string> changed;
+#ifdef __linux__
+        if (fd < 0)
+            return changed;
+        alignas(inotify_event) char buffer[16 * 1024];
+        for (;;) {
+            ssize_t bytes = read(fd, buffer, sizeof(buffer));
+            // EAGAIN: nothing left to read
+            if (bytes <= 0)
+                break;
+            for (char *at = buffer; at < buffer + bytes; ) {
+                const inotify_event *event = reinterpret_cast<const inotify_event*>(at);
+                at += sizeof(inotify_event) + event->len;
+                if (event->len == 0)
+                    continue;
+                std::map<std::pair<int, std::string>, std::vector<std::string>>::const_iterator found =
+                        files.find(std::make_pair(event->wd, std::string(event->name)));
+                if (found == files.end())
+                    continue;
+                for (const std::string &path : found->second) {
+                    bool seen = false;
+                    for (const std::string &other : changed)
+                        seen = seen || other == path;
+                    if (!seen)
+                        changed.push_back(path);
+                }
+            }
+        }
+#endif
+        return changed;
+    }
+
+private:
+    int fd = -1;
+    // paths watched, by directory watch descriptor and file name
+    std::map<std::pair<int, std::string>, std::vector<std::string>> files;
+};
+#endif
@@ -0,0 +1,74 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "glm/glm.hpp"
+
+#include "bounds.h"
+
+// meshes tested by culling draws since the last Reset
+struct CullStats {
+    unsigned int total = 0;
+    unsigned int visible = 0;
+
+    unsigned int Culled() const { return total - visible; }
+    void Reset() { total = visible = 0; }
+};
+
+// The six planes of a view frustum in world space, extracted from a projection * view matrix
+// (Gribb & Hartmann). Each plane is (normal, distance) with the normal pointing inside and
+// normalized, so plane distances of points are in world units.
+struct Frustum {
+    enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+    glm::vec4 planes[PLANE_COUNT];
+
+    static Frustum FromMatrix(const glm::mat4 &viewProjection)
+    {
+        // rows of the matrix, glm stores columns
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        Frustum frustum;
+        frustum.planes[PLANE_LEFT]   = rows[3] + rows[0];
+        frustum.planes[PLANE_RIGHT]  = rows[3] - rows[0];
+        frustum.planes[PLANE_BOTTOM] = rows[3] + rows[1];
+        frustum.planes[PLANE_TOP]    = rows[3] - rows[1];
+        frustum.planes[PLANE_NEAR]   = rows[3] + rows[2];
+        frustum.planes[PLANE_FAR]    = rows[3] - rows[2];
+        for (glm::vec4 &plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    // false only if the world space bounds are entirely outside one of the planes. The sphere
+    // rejects most invisible objects, the box (its corner furthest along each plane normal)
+    // the rest; objects straddling two planes outside the frustum's corner may pass.
+    bool Intersects(const Bounds &bounds) const
+    {
+        if (bounds.Empty())
+            return false;
+        for (const glm::vec4 &plane : planes) {
+            glm::vec3 normal(plane);
+            if (glm::dot(normal, bounds.center) + plane.w < -bounds.radius)
+                return false;
+            glm::vec3 positive(normal.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                               normal.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                               normal.z >= 0.0f ? bounds.max.z : bounds.min.z);
+            if (glm::dot(normal, positive) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // tests model space bounds placed with transform, counting the test in stats if given
+    bool Intersects(const Bounds &bounds, const glm::mat4 &transform, CullStats *stats = nullptr) const
+    {
+        bool visible = Intersects(bounds.Transformed(transform));
+        if (stats) {
+            stats->total++;
+            stats->visible += visible ? 1 : 0;
+        }
+        return visible;
+    }
+};
+#endif
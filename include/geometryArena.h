@@ -0,0 +1,273 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include "gpuResource.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// location of a mesh inside a GeometryArena
+struct GeometryRange {
+    int          baseVertex = 0;  // added to every index by glDrawElementsBaseVertex
+    unsigned int firstIndex = 0;  // offset into the index buffer, in indices
+    unsigned int indexCount = 0;
+    unsigned int vertexCount = 0;
+};
+
+// A single vertex buffer + index buffer + VAO that many meshes sub-allocate from.
+// Every mesh sharing an arena is drawn with the same VAO bound, using
+// glDrawElementsBaseVertex and the mesh's GeometryRange. One arena exists per vertex
+// format, so the layout is fixed by the Vertex template argument's SetupAttributes.
+//
+// Buffers grow by doubling; growing re-specifies the Vertex attributes on the VAO, so
+// any extra attributes (e.g. instance matrices) must be added after all allocations.
+// Freed ranges are reused by later allocations that fit (first fit), so replacing a model
+// (a hot reload, say) doesn't grow the arena each time.
+template <typename VertexT>
+class GeometryArena
+{
+public:
+    GpuVertexArray VAO;
+    GpuBuffer VBO;
+    GpuBuffer EBO;
+    // label of the buffers in GpuResources reports
+    std::string Owner = "geometry arena";
+    // buffers live as long as the GL context, not reported as leaks at exit
+    bool ContextLifetime = false;
+
+    GeometryArena(unsigned int vertexCapacity = 1 << 16, unsigned int indexCapacity = 1 << 18)
+        : vertexCapacity(vertexCapacity), indexCapacity(indexCapacity)
+    {
+    }
+
+    // copies the vertices/indices into the arena and returns where they landed
+    GeometryRange Allocate(const std::vector<VertexT> &vertices, const std::vector<unsigned int> &indices)
+    {
+        return Allocate(vertices.empty() ? nullptr : &vertices[0], vertices.size(), indices.empty() ? nullptr : &indices[0], indices.size());
+    }
+
+    GeometryRange Allocate(const VertexT *vertices, std::size_t vertexTotal, const unsigned int *indices, std::size_t indexTotal)
+    {
+        if (VAO == 0)
+            create();
+
+        // a batch stages everything contiguously after the used part, freed ranges aren't used
+        unsigned int firstVertex = vertexCount;
+        unsigned int firstIndex = indexCount;
+        bool reusedVertices = !batching && vertexTotal > 0 && take(freeVertices, vertexTotal, firstVertex);
+        bool reusedIndices = !batching && indexTotal > 0 && take(freeIndices, indexTotal, firstIndex);
+        reserve(vertexCount + (reusedVertices ? 0 : vertexTotal), indexCount + (reusedIndices ? 0 : indexTotal));
+
+        GeometryRange range;
+        range.baseVertex = static_cast<int>(firstVertex);
+        range.firstIndex = firstIndex;
+        range.indexCount = static_cast<unsigned int>(indexTotal);
+        range.vertexCount = static_cast<unsigned int>(vertexTotal);
+
+        if (batching) {
+            stagedVertices.insert(stagedVertices.end(), vertices, vertices + vertexTotal);
+            stagedIndices.insert(stagedIndices.end(), indices, indices + indexTotal);
+        } else {
+            upload(firstVertex, vertexTotal, vertices, firstIndex, indexTotal, indices);
+        }
+
+        if (!reusedVertices)
+            vertexCount += range.vertexCount;
+        if (!reusedIndices)
+            indexCount += range.indexCount;
+        return range;
+    }
+
+    // gives a range back to the arena once nothing draws it anymore; not during a batch
+    void Free(const GeometryRange &range)
+    {
+        release(freeVertices, vertexCount, static_cast<unsigned int>(range.baseVertex), range.vertexCount);
+        release(freeIndices, indexCount, range.firstIndex, range.indexCount);
+    }
+
+    // Between BeginBatch and EndBatch, Allocate only stages the data on the CPU and EndBatch
+    // uploads all of it with one glBufferSubData per buffer. Passing the expected totals
+    // grows the buffers once up front instead of during the batch.
+    void BeginBatch(std::size_t vertices = 0, std::size_t indices = 0)
+    {
+        if (VAO == 0)
+            create();
+        reserve(vertexCount + vertices, indexCount + indices);
+        batching = true;
+        batchVertexStart = vertexCount;
+        batchIndexStart = indexCount;
+    }
+
+    void EndBatch()
+    {
+        upload(batchVertexStart, stagedVertices.size(), stagedVertices.empty() ? nullptr : &stagedVertices[0],
+                batchIndexStart, stagedIndices.size(), stagedIndices.empty() ? nullptr : &stagedIndices[0]);
+        // release the staging memory, batches are rare
+        std::vector<VertexT>().swap(stagedVertices);
+        std::vector<unsigned int>().swap(stagedIndices);
+        batching = false;
+    }
+
+    // used part of the buffers, freed ranges inside it included
+    unsigned int VertexCount() const { return vertexCount; }
+    unsigned int IndexCount() const { return indexCount; }
+
+    // arena shared by every model that doesn't ask for its own
+    static GeometryArena& Shared()
+    {
+        static GeometryArena arena;
+        arena.Owner = "shared geometry arena";
+        arena.ContextLifetime = true;
+        return arena;
+    }
+
+private:
+    unsigned int vertexCapacity;
+    unsigned int indexCapacity;
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+
+    // unused elements below vertexCount / indexCount, sorted by start and never adjacent
+    struct FreeSpan {
+        unsigned int start;
+        unsigned int count;
+    };
+    std::vector<FreeSpan> freeVertices;
+    std::vector<FreeSpan> freeIndices;
+
+    // data allocated since BeginBatch, uploaded by EndBatch
+    bool batching = false;
+    unsigned int batchVertexStart = 0;
+    unsigned int batchIndexStart = 0;
+    std::vector<VertexT> stagedVertices;
+    std::vector<unsigned int> stagedIndices;
+
+    // carves count elements from the front of the first free span large enough
+    static bool take(std::vector<FreeSpan> &spans, std::size_t count, unsigned int &start)
+    {
+        for (std::size_t i = 0; i < spans.size(); i++) {
+            if (spans[i].count < count)
+                continue;
+            start = spans[i].start;
+            spans[i].start += static_cast<unsigned int>(count);
+            spans[i].count -= static_cast<unsigned int>(count);
+            if (spans[i].count == 0)
+                spans.erase(spans.begin() + i);
+            return true;
+        }
+        return false;
+    }
+
+    // adds [start, start + count) to the free spans, merged with its neighbours; a span
+    // reaching the end of the used part shortens it instead
+    static void release(std::vector<FreeSpan> &spans, unsigned int &used, unsigned int start, unsigned int count)
+    {
+        if (count == 0)
+            return;
+        auto next = std::lower_bound(spans.begin(), spans.end(), start, [](const FreeSpan &span, unsigned int value) {
+            return span.start < value;
+        });
+        next = spans.insert(next, { start, count });
+        if (next + 1 != spans.end() && next->start + next->count == (next + 1)->start) {
+            next->count += (next + 1)->count;
+            spans.erase(next + 1);
+        }
+        if (next != spans.begin() && (next - 1)->start + (next - 1)->count == next->start) {
+            (next - 1)->count += next->count;
+            next = spans.erase(next) - 1;
+        }
+        if (next->start + next->count == used) {
+            used = next->start;
+            spans.erase(next);
+        }
+    }
+
+    // copy vertices/indices into the buffers at the given element offsets
+    void upload(unsigned int firstVertex, std::size_t vertexTotal, const VertexT *vertices,
+            unsigned int firstIndex, std::size_t indexTotal, const unsigned int *indices)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if (vertexTotal > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, firstVertex * sizeof(VertexT), vertexTotal * sizeof(VertexT), vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // element buffer binding is VAO state, bind the VAO so we don't clobber another one's
+        glBindVertexArray(VAO);
+        if (indexTotal > 0)
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, firstIndex * sizeof(unsigned int), indexTotal * sizeof(unsigned int), indices);
+        glBindVertexArray(0);
+    }
+
+    void create()
+    {
+        VAO = GpuVertexArray::Create(Owner);
+        VBO = GpuBuffer::Create(Owner + " vertices");
+        EBO = GpuBuffer::Create(Owner + " indices");
+        VBO.SetBytes(vertexCapacity * sizeof(VertexT));
+        EBO.SetBytes(indexCapacity * sizeof(unsigned int));
+        if (ContextLifetime) {
+            VAO.MarkContextLifetime();
+            VBO.MarkContextLifetime();
+            EBO.MarkContextLifetime();
+        }
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(VertexT), NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+        VertexT::SetupAttributes();
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void reserve(std::size_t vertices, std::size_t indices)
+    {
+        if (vertices > vertexCapacity) {
+            unsigned int capacity = std::max<unsigned int>(vertexCapacity * 2, static_cast<unsigned int>(vertices));
+            VBO = grow(VBO, vertexCount * sizeof(VertexT), capacity * sizeof(VertexT), Owner + " vertices");
+            vertexCapacity = capacity;
+
+            // attribute pointers captured the old buffer, point them at the new one
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            VertexT::SetupAttributes();
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+        if (indices > indexCapacity) {
+            unsigned int capacity = std::max<unsigned int>(indexCapacity * 2, static_cast<unsigned int>(indices));
+            EBO = grow(EBO, indexCount * sizeof(unsigned int), capacity * sizeof(unsigned int), Owner + " indices");
+            indexCapacity = capacity;
+
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBindVertexArray(0);
+        }
+    }
+
+    // allocates a bigger buffer and copies the used part of the old one across on the GPU,
+    // the old buffer is deleted when the result replaces it
+    GpuBuffer grow(const GpuBuffer &buffer, std::size_t usedBytes, std::size_t newBytes, const std::string &label)
+    {
+        GpuBuffer grown = GpuBuffer::Create(label);
+        grown.SetBytes(newBytes);
+        if (ContextLifetime)
+            grown.MarkContextLifetime();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+        if (usedBytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedBytes);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return grown;
+    }
+};
+#endif
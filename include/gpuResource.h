@@ -0,0 +1,292 @@
+#ifndef GPU_RESOURCE_H
+#define GPU_RESOURCE_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class GpuResourceType {
+    BUFFER,
+    TEXTURE,
+    VERTEX_ARRAY,
+    FRAMEBUFFER,
+    RENDERBUFFER,
+    PROGRAM,
+    COUNT
+};
+
+inline const char* GpuResourceTypeName(GpuResourceType type)
+{
+    switch (type) {
+        case GpuResourceType::BUFFER:       return "buffers";
+        case GpuResourceType::TEXTURE:      return "textures";
+        case GpuResourceType::VERTEX_ARRAY: return "vertex arrays";
+        case GpuResourceType::FRAMEBUFFER:  return "framebuffers";
+        case GpuResourceType::RENDERBUFFER: return "renderbuffers";
+        case GpuResourceType::PROGRAM:      return "programs";
+        default:                            return "";
+    }
+}
+
+// Every live GL object created through a GpuHandle, with its owner (a free form label such
+// as the model path) and the bytes it's estimated to take on the GPU. GL thread only.
+//
+// Call ContextDestroyed right before the context goes away (glfwTerminate): handles dying
+// afterwards no longer call into GL, and at exit anything still registered is reported as
+// leaked, except objects meant to live as long as the context (MarkContextLifetime).
+class GpuResources
+{
+public:
+    struct Entry {
+        GpuResourceType type;
+        std::string owner;
+        std::size_t bytes = 0;
+        bool contextLifetime = false;
+    };
+
+    void Add(GpuResourceType type, unsigned int name, const std::string &owner)
+    {
+        Entry &entry = entries[key(type, name)];
+        entry.type = type;
+        entry.owner = owner;
+        entry.bytes = 0;
+        entry.contextLifetime = false;
+    }
+
+    void Remove(GpuResourceType type, unsigned int name)
+    {
+        entries.erase(key(type, name));
+    }
+
+    void SetBytes(GpuResourceType type, unsigned int name, std::size_t bytes)
+    {
+        std::unordered_map<std::uint64_t, Entry>::iterator found = entries.find(key(type, name));
+        if (found != entries.end())
+            found->second.bytes = bytes;
+    }
+
+    void MarkContextLifetime(GpuResourceType type, unsigned int name)
+    {
+        std::unordered_map<std::uint64_t, Entry>::iterator found = entries.find(key(type, name));
+        if (found != entries.end())
+            found->second.contextLifetime = true;
+    }
+
+    std::size_t Bytes(GpuResourceType type) const
+    {
+        std::size_t bytes = 0;
+        for (const std::pair<const std::uint64_t, Entry> &entry : entries)
+            if (entry.second.type == type)
+                bytes += entry.second.bytes;
+        return bytes;
+    }
+
+    std::size_t Count(GpuResourceType type) const
+    {
+        std::size_t count = 0;
+        for (const std::pair<const std::uint64_t, Entry> &entry : entries)
+            if (entry.second.type == type)
+                count++;
+        return count;
+    }
+
+    bool ContextAlive() const { return contextAlive; }
+
+    // stops handles from calling into GL and arranges the leak report at exit
+    void ContextDestroyed()
+    {
+        if (!contextAlive)
+            return;
+        contextAlive = false;
+        std::atexit([]() { GpuResources::Get().reportLeaks(); });
+    }
+
+    // estimated GPU memory per type, then per owner, largest first
+    void Report(std::ostream &out = std::cout) const
+    {
+        out << "GPU resources (estimated):" << std::endl;
+        for (unsigned int t = 0; t < static_cast<unsigned int>(GpuResourceType::COUNT); t++) {
+            GpuResourceType type = static_cast<GpuResourceType>(t);
+            out << "  " << std::left << std::setw(14) << GpuResourceTypeName(type) << std::right << std::setw(6) << Count(type)
+                << std::fixed << std::setprecision(2) << std::setw(10) << Bytes(type) / (1024.0 * 1024.0) << " MB" << std::endl;
+        }
+        std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>> owners = byOwner(false);
+        out << "  by owner:" << std::endl;
+        for (const std::pair<std::string, std::pair<std::size_t, std::size_t>> &owner : owners)
+            out << "    " << std::setw(10) << std::fixed << std::setprecision(2) << owner.second.first / (1024.0 * 1024.0) << " MB "
+                << std::setw(5) << owner.second.second << " objects  " << owner.first << std::endl;
+    }
+
+    // never destroyed, handles in other statics may outlive any static registry
+    static GpuResources& Get()
+    {
+        static GpuResources *resources = new GpuResources();
+        return *resources;
+    }
+
+private:
+    std::unordered_map<std::uint64_t, Entry> entries;
+    bool contextAlive = true;
+
+    static std::uint64_t key(GpuResourceType type, unsigned int name)
+    {
+        return (static_cast<std::uint64_t>(type) << 32) | name;
+    }
+
+    // owner -> (bytes, objects), sorted by bytes
+    std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>> byOwner(bool leaksOnly) const
+    {
+        std::map<std::string, std::pair<std::size_t, std::size_t>> totals;
+        for (const std::pair<const std::uint64_t, Entry> &entry : entries) {
+            if (leaksOnly && entry.second.contextLifetime)
+                continue;
+            std::pair<std::size_t, std::size_t> &total = totals[entry.second.owner];
+            total.first += entry.second.bytes;
+            total.second++;
+        }
+        std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>> sorted(totals.begin(), totals.end());
+        std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, std::pair<std::size_t, std::size_t>> &a,
+                                                   const std::pair<std::string, std::pair<std::size_t, std::size_t>> &b) {
+            return a.second.first > b.second.first;
+        });
+        return sorted;
+    }
+
+    void reportLeaks() const
+    {
+        std::vector<std::pair<std::string, std::pair<std::size_t, std::size_t>>> leaks = byOwner(true);
+        for (const std::pair<std::string, std::pair<std::size_t, std::size_t>> &leak : leaks)
+            std::cout << "WARNING::GPU_RESOURCES:: leaked " << leak.second.second << " objects (" << std::fixed << std::setprecision(2)
+                      << leak.second.first / (1024.0 * 1024.0) << " MB) owned by " << leak.first << std::endl;
+    }
+};
+
+// Move-only owner of one GL object of the given type. Converts to the GL name, so it can be
+// passed to GL calls and compared like the unsigned int it replaces. Creation registers the
+// object with GpuResources, destruction deletes and unregisters it.
+template <GpuResourceType TYPE>
+class GpuHandle
+{
+public:
+    GpuHandle() = default;
+
+    // a new object, owner labels it in reports
+    static GpuHandle Create(const std::string &owner)
+    {
+        GpuHandle handle;
+        handle.name = generate();
+        GpuResources::Get().Add(TYPE, handle.name, owner);
+        return handle;
+    }
+
+    // takes over an object created elsewhere
+    static GpuHandle Adopt(unsigned int name, const std::string &owner)
+    {
+        GpuHandle handle;
+        handle.name = name;
+        if (name)
+            GpuResources::Get().Add(TYPE, name, owner);
+        return handle;
+    }
+
+    GpuHandle(const GpuHandle&) = delete;
+    GpuHandle& operator=(const GpuHandle&) = delete;
+
+    GpuHandle(GpuHandle &&other) noexcept : name(other.name)
+    {
+        other.name = 0;
+    }
+
+    GpuHandle& operator=(GpuHandle &&other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            name = other.name;
+            other.name = 0;
+        }
+        return *this;
+    }
+
+    ~GpuHandle()
+    {
+        Reset();
+    }
+
+    operator unsigned int() const { return name; }
+    unsigned int Get() const { return name; }
+
+    // estimated GPU memory behind the object, for reports
+    void SetBytes(std::size_t bytes) const
+    {
+        if (name)
+            GpuResources::Get().SetBytes(TYPE, name, bytes);
+    }
+
+    // not reported as a leak when still alive at exit
+    void MarkContextLifetime() const
+    {
+        if (name)
+            GpuResources::Get().MarkContextLifetime(TYPE, name);
+    }
+
+    // deletes the object now
+    void Reset()
+    {
+        if (!name)
+            return;
+        GpuResources &resources = GpuResources::Get();
+        resources.Remove(TYPE, name);
+        if (resources.ContextAlive())
+            destroy(name);
+        name = 0;
+    }
+
+private:
+    unsigned int name = 0;
+
+    static unsigned int generate()
+    {
+        unsigned int generated = 0;
+        switch (TYPE) {
+            case GpuResourceType::BUFFER:       glGenBuffers(1, &generated); break;
+            case GpuResourceType::TEXTURE:      glGenTextures(1, &generated); break;
+            case GpuResourceType::VERTEX_ARRAY: glGenVertexArrays(1, &generated); break;
+            case GpuResourceType::FRAMEBUFFER:  glGenFramebuffers(1, &generated); break;
+            case GpuResourceType::RENDERBUFFER: glGenRenderbuffers(1, &generated); break;
+            case GpuResourceType::PROGRAM:      generated = glCreateProgram(); break;
+            default:                            break;
+        }
+        return generated;
+    }
+
+    static void destroy(unsigned int name)
+    {
+        switch (TYPE) {
+            case GpuResourceType::BUFFER:       glDeleteBuffers(1, &name); break;
+            case GpuResourceType::TEXTURE:      glDeleteTextures(1, &name); break;
+            case GpuResourceType::VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+            case GpuResourceType::FRAMEBUFFER:  glDeleteFramebuffers(1, &name); break;
+            case GpuResourceType::RENDERBUFFER: glDeleteRenderbuffers(1, &name); break;
+            case GpuResourceType::PROGRAM:      glDeleteProgram(name); break;
+            default:                            break;
+        }
+    }
+};
+
+typedef GpuHandle<GpuResourceType::BUFFER>       GpuBuffer;
+typedef GpuHandle<GpuResourceType::TEXTURE>      GpuTexture;
+typedef GpuHandle<GpuResourceType::VERTEX_ARRAY> GpuVertexArray;
+typedef GpuHandle<GpuResourceType::FRAMEBUFFER>  GpuFramebuffer;
+typedef GpuHandle<GpuResourceType::RENDERBUFFER> GpuRenderbuffer;
+typedef GpuHandle<GpuResourceType::PROGRAM>      GpuProgram;
+#endif
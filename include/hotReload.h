@@ -0,0 +1,326 @@
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <glad/glad.h>
+
+#include "shader.h"
+#include "material.h"
+#include "model.h"
+#include "modelData.h"
+#include "modelStreamer.h"
+#include "fileWatcher.h"
+#include "jobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Picks up edits to shaders, models and their textures while the program runs. Files are
+// watched with a FileWatcher; Update, called once per frame on the GL thread outside command
+// recording, swaps whatever finished reloading in place, so every pointer or reference to a
+// watched Shader or Model (entities, command lists, batches) stays valid and sees the new one.
+// Only what changed is reloaded:
+//  - a shader file (or a file it includes) rebuilds the programs built from it, with the same
+//    defines, in a ShaderBatch the driver compiles in the background. The new program replaces
+//    the old one only if it linked; otherwise the errors are printed and the old one stays.
+//  - a texture is decoded again on the job system and replaces that texture alone in the
+//    models using it, their materials re-pointed at it.
+//  - a model file is re-imported through a ModelStreamer and moved over the old model once
+//    uploaded, the old geometry freed back to the arena. An arena that grows re-specifies the
+//    vertex attributes of its VAO: onReload is where to restore instance attributes or
+//    rebuild what was derived from the model. A model still streaming in is watched once
+//    it's ready.
+//  - any other file (a texture loaded on its own, say) runs the callback it's watched with.
+// Models cooked into the mounted AssetPack are watched too: once their files are edited the
+// pack's entries are stale and the re-import reads the files instead.
+class HotReload
+{
+public:
+    // programs deleted by the last Update (replaced by their rebuilds), for caches keyed by
+    // program name such as CommandReplayer::Forget
+    std::vector<unsigned int> Retired;
+    // swapped in by the last Update
+    unsigned int ShadersReloaded = 0;
+    unsigned int TexturesReloaded = 0;
+    unsigned int ModelsReloaded = 0;
+    unsigned int FilesReloaded = 0;
+
+    explicit HotReload(JobSystem &jobs = JobSystem::Global()) : jobs(jobs), streamer(jobs)
+    {
+    }
+
+    // texture decodes still running reference this object
+    ~HotReload()
+    {
+        jobs.Wait(decoding);
+    }
+
+    bool Available() const { return watcher.Available(); }
+
+    // rebuilds shader when a file it was built from changes; onReload runs once the new
+    // program is in place, to set the uniforms only set once. shader must outlive this.
+    void Watch(Shader &shader, std::function<void(Shader&)> onReload = nullptr)
+    {
+        std::unique_ptr<WatchedShader> watched(new WatchedShader());
+        watched->shader = &shader;
+        watched->onReload = onReload;
+        for (const std::string &file : shader.sourceFiles)
+            watcher.Watch(file);
+        shaders.push_back(std::move(watched));
+    }
+
+    // reloads model, imported from path, when the file or one of its textures changes;
+    // onReload runs after a re-import replaced it. model must outlive this.
+    void Watch(Model &model, const std::string &path, std::function<void(Model&)> onReload = nullptr)
+    {
+        std::unique_ptr<WatchedModel> watched(new WatchedModel());
+        watched->model = &model;
+        watched->path = path;
+        watched->onReload = onReload;
+        watcher.Watch(path);
+        watchTextures(*watched);
+        models.push_back(std::move(watched));
+    }
+
+    // the same for a model requested from a ModelStreamer, from the frame it's ready
+    void Watch(const ModelHandle &handle, const std::string &path, std::function<void(Model&)> onReload = nullptr)
+    {
+        streaming.push_back({ handle, path, onReload });
+    }
+
+    // runs onChange (on the GL thread, in Update) whenever path is written, e.g. to load a
+    // standalone texture again through the same function that loaded it
+    void Watch(const std::string &path, std::function<void()> onChange)
+    {
+        watcher.Watch(path);
+        files.push_back({ path, onChange });
+    }
+
+    // starts reloading what changed on disk and swaps in what finished; call once per frame
+    void Update()
+    {
+        Retired.clear();
+        ShadersReloaded = TexturesReloaded = ModelsReloaded = FilesReloaded = 0;
+
+        for (std::size_t i = 0; i < streaming.size(); ) {
+            StreamingModel &pending = streaming[i];
+            if (pending.handle.Ready())
+                Watch(*pending.handle.Get(), pending.path, pending.onReload);
+            if (pending.handle.Ready() || pending.handle.Failed())
+                streaming.erase(streaming.begin() + i);
+            else
+                i++;
+        }
+
+        for (const std::string &file : watcher.Poll()) {
+            for (const WatchedFile &watched : files)
+                if (watched.path == file) {
+                    watched.onChange();
+                    FilesReloaded++;
+                    std::cout << "Reloaded " << file << std::endl;
+                }
+            for (std::unique_ptr<WatchedShader> &watched : shaders)
+                if (contains(watched->shader->sourceFiles, file))
+                    rebuild(*watched);
+            for (std::unique_ptr<WatchedModel> &watched : models) {
+                if (file == watched->path) {
+                    reimport(*watched);
+                    continue;
+                }
+                const std::vector<Texture> &textures = watched->model->textures_loaded;
+                for (unsigned int i = 0; i < textures.size(); i++)
+                    if (texturePath(*watched->model, textures[i]) == file)
+                        decode(*watched, i);
+            }
+        }
+
+        finishShaders();
+        finishTextures();
+        // re-imported models go up within the streamer's budget, onReady swaps them in
+        streamer.Update();
+    }
+
+private:
+    struct WatchedShader {
+        Shader *shader = nullptr;
+        std::function<void(Shader&)> onReload;
+        std::unique_ptr<Shader> rebuilt;     // compiling in the batch
+        bool changedAgain = false;           // written again while compiling
+        std::chrono::high_resolution_clock::time_point started;
+    };
+
+    struct WatchedModel {
+        Model *model = nullptr;
+        std::string path;
+        std::function<void(Model&)> onReload;
+        bool reimporting = false;
+        bool changedAgain = false;           // written again while reimporting
+    };
+
+    struct StreamingModel {
+        ModelHandle handle;
+        std::string path;
+        std::function<void(Model&)> onReload;
+    };
+
+    struct WatchedFile {
+        std::string path;
+        std::function<void()> onChange;
+    };
+
+    // one texture of a model decoded on the job system
+    struct TextureDecode {
+        WatchedModel *watched = nullptr;
+        unsigned int index = 0;
+        std::string path;
+        ModelData data;
+        std::atomic<bool> done{false};
+    };
+
+    JobSystem &jobs;
+    FileWatcher watcher;
+    ShaderBatch batch;
+    ModelStreamer streamer;
+    JobGroup decoding;
+    std::vector<std::unique_ptr<WatchedShader>> shaders;
+    std::vector<std::unique_ptr<WatchedModel>> models;
+    std::vector<StreamingModel> streaming;
+    std::vector<WatchedFile> files;
+    std::vector<std::shared_ptr<TextureDecode>> decodes;
+
+    static bool contains(const std::vector<std::string> &files, const std::string &file)
+    {
+        for (const std::string &watched : files)
+            if (watched == file)
+                return true;
+        return false;
+    }
+
+    static std::string texturePath(const Model &model, const Texture &texture)
+    {
+        return model.directory + '/' + texture.path;
+    }
+
+    void watchTextures(const WatchedModel &watched)
+    {
+        for (const Texture &texture : watched.model->textures_loaded)
+            watcher.Watch(texturePath(*watched.model, texture));
+    }
+
+    // queues the program's sources again, once the rebuild still compiling (if any) is done
+    void rebuild(WatchedShader &watched)
+    {
+        if (watched.rebuilt) {
+            watched.changedAgain = true;
+            return;
+        }
+        const Shader &shader = *watched.shader;
+        watched.started = std::chrono::high_resolution_clock::now();
+        watched.rebuilt.reset(new Shader(shader.vertexPath, shader.geometryPath, shader.fragmentPath, shader.defines, batch));
+    }
+
+    void finishShaders()
+    {
+        batch.Poll();
+        for (std::unique_ptr<WatchedShader> &watched : shaders) {
+            if (!watched->rebuilt || batch.Waiting(watched->rebuilt->ID))
+                continue;
+            std::unique_ptr<Shader> rebuilt = std::move(watched->rebuilt);
+            Shader &shader = *watched->shader;
+            if (watched->changedAgain) {
+                // outdated already, build the latest sources instead
+                watched->changedAgain = false;
+                rebuild(*watched);
+                continue;
+            }
+            int linked = GL_FALSE;
+            glGetProgramiv(rebuilt->ID, GL_LINK_STATUS, &linked);
+            if (!linked) {
+                std::cout << "WARNING::HOT_RELOAD:: " << shader.vertexPath << " / " << shader.fragmentPath << " failed to build, keeping the running program" << std::endl;
+                continue;
+            }
+            unsigned int previous = shader.ID;
+            Material::ForgetProgram(previous);
+            Retired.push_back(previous);
+            shader.ID = std::move(rebuilt->ID);
+            // includes may have changed
+            shader.sourceFiles = rebuilt->sourceFiles;
+            for (const std::string &file : shader.sourceFiles)
+                watcher.Watch(file);
+            if (watched->onReload)
+                watched->onReload(shader);
+            ShadersReloaded++;
+            std::cout << "Reloaded " << shader.vertexPath << " / " << shader.fragmentPath << " in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - watched->started).count() << " ms" << std::endl;
+        }
+    }
+
+    void decode(WatchedModel &watched, unsigned int index)
+    {
+        const Model &model = *watched.model;
+        const Texture &texture = model.textures_loaded[index];
+        std::shared_ptr<TextureDecode> request = std::make_shared<TextureDecode>();
+        request->watched = &watched;
+        request->index = index;
+        request->path = texture.path;
+        request->data.directory = model.directory;
+        // gamma corrected like the import does, diffuse maps only
+        request->data.TextureIndex(texture.path, texture.role, model.gammaCorrection && texture.role == TextureRole::DIFFUSE);
+        decodes.push_back(request);
+        jobs.Run(decoding, [request, this]() {
+            request->data.DecodeTextures(jobs);
+            request->done.store(true, std::memory_order_release);
+        });
+    }
+
+    void finishTextures()
+    {
+        for (std::size_t i = 0; i < decodes.size(); ) {
+            TextureDecode &request = *decodes[i];
+            if (!request.done.load(std::memory_order_acquire)) {
+                i++;
+                continue;
+            }
+            Model &model = *request.watched->model;
+            ImportedTexture &imported = request.data.textures[0];
+            // the model may have been re-imported meanwhile, textures get a fresh copy then
+            bool current = request.index < model.textures_loaded.size() && model.textures_loaded[request.index].path == request.path;
+            if (current && imported.data) {
+                model.ReplaceTexture(request.index, imported);
+                TexturesReloaded++;
+                std::cout << "Reloaded texture " << texturePath(model, model.textures_loaded[request.index]) << std::endl;
+            }
+            decodes.erase(decodes.begin() + i);
+        }
+    }
+
+    void reimport(WatchedModel &watched)
+    {
+        if (watched.reimporting) {
+            watched.changedAgain = true;
+            return;
+        }
+        watched.reimporting = true;
+        Model &model = *watched.model;
+        streamer.KeepGeometry = model.keepGeometry;
+        WatchedModel *target = &watched;
+        streamer.Request(watched.path, model.gammaCorrection, model.arena, [this, target](Model &reloaded) {
+            *target->model = std::move(reloaded);
+            watchTextures(*target);
+            target->reimporting = false;
+            if (target->onReload)
+                target->onReload(*target->model);
+            ModelsReloaded++;
+            std::cout << "Reloaded " << target->path << std::endl;
+            if (target->changedAgain) {
+                target->changedAgain = false;
+                reimport(*target);
+            }
+        });
+    }
+};
+#endif
@@ -0,0 +1,247 @@
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "material.h"
+#include "mesh.h"
+#include "model.h"
+
+#include <algorithm>
+#include <vector>
+
+// command layout read from GL_DRAW_INDIRECT_BUFFER by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// first of the four attribute locations holding the per-draw model matrix (after Vertex's 0..6)
+const unsigned int INSTANCE_MATRIX_LOCATION = 7;
+
+// Collects static draws of meshes living in one MeshArena and submits them with as few API
+// calls as possible. Draws are sorted by material, repeated meshes become one instanced
+// command, and every material's commands go out in a single glMultiDrawElementsIndirect when
+// GL 4.3 is available. Per-draw transforms are an instanced attribute (location 7..10) read at
+// each command's baseInstance, so the vertex shader needs no gl_DrawID (see the INSTANCED
+// path of shaders/generic/3.3.lighting_maps.vs). On GL 3.3 the same commands are replayed in a
+// loop, re-pointing the instance attribute at baseInstance before each draw.
+class IndirectBatch
+{
+public:
+    IndirectBatch(MeshArena &arena = MeshArena::Shared()) : arena(arena)
+    {
+    }
+
+    // forget the draws of the previous frame
+    void Clear()
+    {
+        items.clear();
+        transforms.clear();
+    }
+
+    // queue every mesh of the model with the given model matrix
+    void Add(const Model &model, const glm::mat4 &transform)
+    {
+        for (const Mesh &mesh : model.meshes)
+            Add(mesh, transform);
+    }
+
+    // queue the meshes of the model whose bounds, placed with transform, intersect the frustum
+    void Add(const Model &model, const glm::mat4 &transform, const Frustum &frustum, CullStats *stats = nullptr)
+    {
+        if (!model.Visible(transform, frustum, stats))
+            return;
+        for (const Mesh &mesh : model.meshes)
+            if (model.MeshVisible(mesh, transform, frustum, stats))
+                Add(mesh, transform);
+    }
+
+    // queue a single mesh, it must have been allocated from this batch's arena
+    void Add(const Mesh &mesh, const glm::mat4 &transform)
+    {
+        Item item;
+        item.material = mesh.material.get();
+        item.range = mesh.range;
+        item.transform = static_cast<unsigned int>(transforms.size());
+        items.push_back(item);
+        transforms.push_back(transform);
+    }
+
+    // upload the queued draws and render them; the shader must already be in use
+    void Submit(const Shader &shader)
+    {
+        apiCalls = 0;
+        build();
+        if (commands.empty())
+            return;
+
+        if (VAO == 0 || boundVBO != arena.VBO || boundEBO != arena.EBO)
+            setupVAO();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(glm::mat4), &instanceData[0], GL_STREAM_DRAW);
+        instanceVBO.SetBytes(instanceData.size() * sizeof(glm::mat4));
+
+        bool multiDraw = MultiDrawAvailable();
+#ifdef GL_VERSION_4_3
+        if (multiDraw) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STREAM_DRAW);
+            indirectBuffer.SetBytes(commands.size() * sizeof(DrawElementsIndirectCommand));
+        }
+#endif
+
+        glBindVertexArray(VAO);
+        for (const Group &group : groups) {
+            group.material->Bind(shader);
+#ifdef GL_VERSION_4_3
+            if (multiDraw) {
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                        (void*)(group.firstCommand * sizeof(DrawElementsIndirectCommand)), group.commandCount, 0);
+                apiCalls++;
+                continue;
+            }
+#endif
+            // GL 3.3 fallback: no baseInstance, so offset the instance attribute instead
+            for (unsigned int i = group.firstCommand; i < group.firstCommand + group.commandCount; i++) {
+                const DrawElementsIndirectCommand &command = commands[i];
+                setInstanceAttributes(command.baseInstance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                        (void*)(command.firstIndex * sizeof(unsigned int)), command.instanceCount, command.baseVertex);
+                apiCalls++;
+            }
+        }
+        if (!multiDraw)
+            setInstanceAttributes(0);
+        glBindVertexArray(0);
+#ifdef GL_VERSION_4_3
+        if (multiDraw)
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+#endif
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // queued mesh draws, indirect commands and draw calls of the last Submit
+    unsigned int DrawCount() const { return static_cast<unsigned int>(items.size()); }
+    unsigned int CommandCount() const { return static_cast<unsigned int>(commands.size()); }
+    unsigned int ApiCalls() const { return apiCalls; }
+
+    // true if the context exposes glMultiDrawElementsIndirect (GL 4.3)
+    static bool MultiDrawAvailable()
+    {
+#ifdef GL_VERSION_4_3
+        return GLAD_GL_VERSION_4_3 != 0;
+#else
+        return false;
+#endif
+    }
+
+private:
+    struct Item {
+        const Material *material;
+        GeometryRange range;
+        unsigned int transform;
+    };
+
+    // consecutive commands sharing a material
+    struct Group {
+        const Material *material;
+        unsigned int firstCommand;
+        unsigned int commandCount;
+    };
+
+    MeshArena &arena;
+    std::vector<Item> items;
+    std::vector<glm::mat4> transforms;
+    std::vector<glm::mat4> instanceData;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<Group> groups;
+    unsigned int apiCalls = 0;
+
+    GpuVertexArray VAO;
+    GpuBuffer instanceVBO;
+    GpuBuffer indirectBuffer;
+    // arena buffers captured by the VAO, they change when the arena grows
+    unsigned int boundVBO = 0;
+    unsigned int boundEBO = 0;
+
+    // sort by material then mesh, merge repeated meshes into instanced commands
+    void build()
+    {
+        std::stable_sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+            if (a.material->ID != b.material->ID)
+                return a.material->ID < b.material->ID;
+            if (a.range.firstIndex != b.range.firstIndex)
+                return a.range.firstIndex < b.range.firstIndex;
+            return a.range.baseVertex < b.range.baseVertex;
+        });
+
+        instanceData.clear();
+        commands.clear();
+        groups.clear();
+        for (const Item &item : items) {
+            bool sameMaterial = !groups.empty() && groups.back().material == item.material;
+            if (sameMaterial && commands.back().firstIndex == item.range.firstIndex &&
+                    commands.back().baseVertex == item.range.baseVertex && commands.back().count == item.range.indexCount) {
+                commands.back().instanceCount++;
+            } else {
+                DrawElementsIndirectCommand command;
+                command.count = item.range.indexCount;
+                command.instanceCount = 1;
+                command.firstIndex = item.range.firstIndex;
+                command.baseVertex = item.range.baseVertex;
+                command.baseInstance = static_cast<GLuint>(instanceData.size());
+                commands.push_back(command);
+
+                if (sameMaterial)
+                    groups.back().commandCount++;
+                else
+                    groups.push_back({ item.material, static_cast<unsigned int>(commands.size() - 1), 1 });
+            }
+            instanceData.push_back(transforms[item.transform]);
+        }
+    }
+
+    // VAO reading the arena's vertices/indices plus our instance matrices
+    void setupVAO()
+    {
+        if (VAO == 0) {
+            VAO = GpuVertexArray::Create("indirect draw");
+            instanceVBO = GpuBuffer::Create("indirect draw instances");
+            indirectBuffer = GpuBuffer::Create("indirect draw commands");
+        }
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, arena.VBO);
+        Vertex::SetupAttributes();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena.EBO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int i = 0; i < 4; i++) {
+            glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + i);
+            glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + i, 1);
+        }
+        setInstanceAttributes(0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        boundVBO = arena.VBO;
+        boundEBO = arena.EBO;
+    }
+
+    // point the matrix attribute at the given instance; VAO and instanceVBO must be bound
+    void setInstanceAttributes(unsigned int baseInstance)
+    {
+        std::size_t offset = baseInstance * sizeof(glm::mat4);
+        for (unsigned int i = 0; i < 4; i++)
+            glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+    }
+};
+#endif
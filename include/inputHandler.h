@@ -10,12 +10,14 @@ struct InputState {
     bool qHeld = false;
     bool fHeld = false;
     bool jHeld = false;
+    bool mHeld = false;
     bool shiftHeld = false;
     float speedMult = 3.0f;
     bool firstToggle = true;
     bool cursorDisabled = true;
     bool flashlightOn = false;
     bool drawDebugLine = false;
+    bool dumpMemoryReport = false;
 };
 
 void processInput(GLFWwindow *window, Camera &camera, InputState &inputState, float deltaTime);
@@ -0,0 +1,125 @@
+#ifndef INSTANCE_BATCHER_H
+#define INSTANCE_BATCHER_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "model.h"
+#include "indirectDraw.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Collects Model::Draw calls for a frame and merges repeated draws of the same model with
+// the same shader into one instanced draw. Queued draws must only differ by their model
+// matrix. Models drawn once go through the regular Model::Draw path; repeated ones are drawn
+// with the shader's INSTANCED variant (compiled on first use, or given to UseInstanced),
+// which reads the model matrix from attribute locations 7..10 instead of the "model"
+// uniform. Nothing is read back from GL: the variant is a program of its own, so set its
+// other uniforms through Instanced alongside the shader's.
+class InstanceBatcher
+{
+public:
+    // draws queued, draws issued and draws absorbed into instanced calls by the last Flush
+    unsigned int DrawsQueued = 0;
+    unsigned int DrawsIssued = 0;
+    unsigned int DrawsMerged = 0;
+
+    InstanceBatcher(MeshArena &arena = MeshArena::Shared()) : batch(arena)
+    {
+    }
+
+    // queue a draw of the whole model with the given model matrix
+    void Draw(Model &model, Shader &shader, const glm::mat4 &transform)
+    {
+        std::pair<Shader*, Model*> key(&shader, &model);
+        auto it = groupIndex.find(key);
+        if (it == groupIndex.end()) {
+            it = groupIndex.emplace(key, static_cast<unsigned int>(groups.size())).first;
+            groups.push_back({ &shader, &model, {} });
+        }
+        groups[it->second].transforms.push_back(transform);
+        DrawsQueued++;
+    }
+
+    // queue the draw only if the model placed with transform may be inside the frustum
+    void Draw(Model &model, Shader &shader, const glm::mat4 &transform, const Frustum &frustum, CullStats *stats = nullptr)
+    {
+        if (model.Visible(transform, frustum, stats)) {
+            if (stats) {
+                stats->total += static_cast<unsigned int>(model.meshes.size());
+                stats->visible += static_cast<unsigned int>(model.meshes.size());
+            }
+            Draw(model, shader, transform);
+        }
+    }
+
+    // issue all queued draws in first-queued order, leaves no shader in use
+    void Flush()
+    {
+        DrawsIssued = 0;
+        DrawsMerged = 0;
+        for (Group &group : groups) {
+            if (group.transforms.size() == 1) {
+                group.shader->use();
+                group.shader->setMat4("model", group.transforms[0]);
+                group.model->Draw(*group.shader);
+                DrawsIssued++;
+                continue;
+            }
+
+            Shader &instanced = Instanced(*group.shader);
+            instanced.use();
+
+            batch.Clear();
+            for (const glm::mat4 &transform : group.transforms)
+                batch.Add(*group.model, transform);
+            batch.Submit(instanced);
+
+            DrawsIssued++;
+            DrawsMerged += static_cast<unsigned int>(group.transforms.size()) - 1;
+        }
+        glUseProgram(0);
+
+        groups.clear();
+        groupIndex.clear();
+        DrawsQueued = 0;
+    }
+
+    // the INSTANCED variant Flush draws repeated models of shader with, compiled on first use
+    Shader& Instanced(const Shader &shader)
+    {
+        Shader *&variant = variants[shader.ID];
+        if (!variant) {
+            owned.emplace_back(new Shader(shader.Variant("#define INSTANCED\n")));
+            variant = owned.back().get();
+        }
+        return *variant;
+    }
+
+    // draw repeated models of shader with instanced, a variant built elsewhere (e.g. by
+    // ShaderVariants, shared with an IndirectBatch), instead of compiling one. instanced
+    // must outlive this.
+    void UseInstanced(const Shader &shader, Shader &instanced)
+    {
+        variants[shader.ID] = &instanced;
+    }
+
+private:
+    struct Group {
+        Shader *shader;
+        Model *model;
+        std::vector<glm::mat4> transforms;
+    };
+
+    IndirectBatch batch;
+    std::vector<Group> groups;
+    std::map<std::pair<Shader*, Model*>, unsigned int> groupIndex;
+    std::map<unsigned int, Shader*> variants;
+    std::vector<std::unique_ptr<Shader>> owned;
+};
+#endif
@@ -0,0 +1,288 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Counts the unfinished jobs started with JobSystem::Run; JobSystem::Wait blocks on it.
+struct JobGroup {
+    std::atomic<unsigned int> pending{0};
+};
+
+// Fork/join handle for a single spawned job, cheap to copy. A default constructed handle
+// counts as finished.
+class JobHandle
+{
+public:
+    bool Done() const { return !group || group->pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::shared_ptr<JobGroup> group;
+};
+
+// A small work-stealing thread pool. Every worker owns a deque: it pushes and pops its own
+// jobs at the back, idle workers steal from the front of the others. Jobs submitted from a
+// non-worker thread (e.g. the GL thread) are spread round-robin over the workers. Waiting
+// threads execute queued jobs instead of sleeping, so nested Run/Wait never deadlocks.
+// Jobs can be joined through a shared JobGroup (Run), a per job JobHandle (Spawn) or
+// implicitly by ParallelFor, which splits an index range over all threads.
+class JobSystem
+{
+public:
+    // worker count meaning one worker per hardware thread minus the calling thread
+    static const unsigned int AUTO_WORKERS = ~0u;
+
+    // with 0 workers every job runs on the thread waiting for it. With pinThreads worker N is
+    // bound to core N + 1, leaving core 0 to the GL thread (Linux only).
+    explicit JobSystem(unsigned int threadCount = AUTO_WORKERS, bool pinThreads = false)
+    {
+        if (threadCount == AUTO_WORKERS) {
+            unsigned int hardware = std::thread::hardware_concurrency();
+            threadCount = hardware > 1 ? hardware - 1 : 1;
+        }
+        // a queue always exists so jobs have somewhere to wait for their waiter
+        queues.resize(std::max(threadCount, 1u));
+        for (unsigned int i = 0; i < queues.size(); i++)
+            queues[i].reset(new WorkQueue());
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+            if (pinThreads)
+                pin(workers.back(), i + 1);
+        }
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running = false;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // queue a job, group.pending drops back when it has run
+    void Run(JobGroup &group, std::function<void()> job)
+    {
+        group.pending.fetch_add(1, std::memory_order_relaxed);
+        Job entry = { std::move(job), &group };
+
+        int self = workerIndex();
+        unsigned int target = self >= 0 && owner() == this ? static_cast<unsigned int>(self)
+            : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->jobs.push_back(std::move(entry));
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        wake.notify_one();
+    }
+
+    // queue a job with its own handle to join on
+    JobHandle Spawn(std::function<void()> job)
+    {
+        JobHandle handle;
+        handle.group = std::make_shared<JobGroup>();
+        std::shared_ptr<JobGroup> group = handle.group;
+        // the job keeps its group alive even if every handle is dropped
+        Run(*group, [group, job]() { job(); });
+        return handle;
+    }
+
+    // run queued jobs on this thread until every job of the group has finished
+    void Wait(JobGroup &group)
+    {
+        while (group.pending.load(std::memory_order_acquire) > 0) {
+            if (!runOne())
+                std::this_thread::yield();
+        }
+    }
+
+    void Wait(const JobHandle &handle)
+    {
+        if (handle.group)
+            Wait(*handle.group);
+    }
+
+    // call function(begin, end) over sub-ranges of [first, last) in parallel and wait for all
+    // of them. Ranges hold at least grain items; small ranges run on the calling thread.
+    void ParallelFor(std::size_t first, std::size_t last, std::size_t grain,
+            const std::function<void(std::size_t, std::size_t)> &function)
+    {
+        if (first >= last)
+            return;
+        std::size_t count = last - first;
+        grain = std::max<std::size_t>(grain, 1);
+        // a few chunks per thread so stealing can even out uneven work
+        std::size_t chunks = std::min<std::size_t>((count + grain - 1) / grain, (WorkerCount() + 1) * 4);
+        if (chunks <= 1) {
+            function(first, last);
+            return;
+        }
+        std::size_t chunkSize = (count + chunks - 1) / chunks;
+
+        JobGroup group;
+        for (std::size_t begin = first + chunkSize; begin < last; begin += chunkSize) {
+            std::size_t end = std::min(begin + chunkSize, last);
+            Run(group, [&function, begin, end]() { function(begin, end); });
+        }
+        // the calling thread takes the first chunk itself
+        function(first, std::min(first + chunkSize, last));
+        Wait(group);
+    }
+
+    unsigned int WorkerCount() const { return static_cast<unsigned int>(workers.size()); }
+
+    // worker count and pinning of the Global pool, only effective before its first use
+    static void ConfigureGlobal(unsigned int threadCount, bool pinThreads = false)
+    {
+        globalSettings().threadCount = threadCount;
+        globalSettings().pinThreads = pinThreads;
+    }
+
+    // process wide pool used by the scenes and loaders
+    static JobSystem& Global()
+    {
+        static JobSystem system(globalSettings().threadCount, globalSettings().pinThreads);
+        return system;
+    }
+
+private:
+    struct Job {
+        std::function<void()> function;
+        JobGroup *group;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> nextQueue{0};
+    std::atomic<unsigned int> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool running = true;
+
+    struct Settings {
+        unsigned int threadCount = AUTO_WORKERS;
+        bool pinThreads = false;
+    };
+
+    static Settings& globalSettings()
+    {
+        static Settings settings;
+        return settings;
+    }
+
+    static void pin(std::thread &thread, unsigned int core)
+    {
+#ifdef __linux__
+        unsigned int hardware = std::max(std::thread::hardware_concurrency(), 1u);
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(core % hardware, &cpus);
+        if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpus) != 0)
+            std::cout << "WARNING::JOB_SYSTEM:: failed to pin worker to core " << core % hardware << std::endl;
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    // index of the worker running on this thread, -1 for outside threads
+    static int& workerIndex()
+    {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    // pool owning the current worker thread
+    static JobSystem*& owner()
+    {
+        static thread_local JobSystem *system = nullptr;
+        return system;
+    }
+
+    void workerLoop(unsigned int index)
+    {
+        workerIndex() = static_cast<int>(index);
+        owner() = this;
+        while (true) {
+            if (runOne())
+                continue;
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            if (!running)
+                break;
+            // timeout guards against a notify racing the queued check
+            wake.wait_for(lock, std::chrono::milliseconds(1), [this] {
+                return !running || queued.load(std::memory_order_acquire) > 0;
+            });
+            if (!running)
+                break;
+        }
+    }
+
+    // pop from our own queue (back) or steal from another (front); false if all are empty
+    bool runOne()
+    {
+        Job job;
+        int self = owner() == this ? workerIndex() : -1;
+        bool found = false;
+        if (self >= 0)
+            found = pop(*queues[self], job, true);
+
+        unsigned int start = self >= 0 ? static_cast<unsigned int>(self) + 1 : 0;
+        for (unsigned int i = 0; i < queues.size() && !found; i++) {
+            unsigned int victim = (start + i) % queues.size();
+            if (static_cast<int>(victim) != self)
+                found = pop(*queues[victim], job, false);
+        }
+        if (!found)
+            return false;
+
+        job.function();
+        job.group->pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool pop(WorkQueue &queue, Job &job, bool back)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty())
+            return false;
+        if (back) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,121 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_MMAP
+#endif
+
+// Read-only view of a whole file. Memory-mapped where the platform supports it, read into
+// memory otherwise. Move-only; the view stays valid until the object is destroyed.
+class MappedFile
+{
+public:
+    MappedFile() {}
+
+    explicit MappedFile(const std::string &path)
+    {
+        Open(path);
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile &&other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile &&other) noexcept
+    {
+        if (this != &other) {
+            Close();
+            data = other.data;
+            size = other.size;
+            mapped = other.mapped;
+            buffer.swap(other.buffer);
+            other.data = nullptr;
+            other.size = 0;
+            other.mapped = false;
+        }
+        return *this;
+    }
+
+    // false if the file can't be opened; empty files open fine with Size() == 0
+    bool Open(const std::string &path)
+    {
+        Close();
+#ifdef MAPPED_FILE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        if (size > 0) {
+            void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // parsers read front to back
+                madvise(view, size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(view);
+                mapped = true;
+            }
+        }
+        close(fd);
+        if (size == 0 || mapped)
+            return true;
+#endif
+        // no mmap (or it failed): read the file into memory
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        size = static_cast<std::size_t>(file.tellg());
+        buffer.resize(size);
+        file.seekg(0);
+        if (size > 0 && !file.read(&buffer[0], static_cast<std::streamsize>(size))) {
+            Close();
+            return false;
+        }
+        data = buffer.empty() ? nullptr : &buffer[0];
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef MAPPED_FILE_MMAP
+        if (mapped)
+            munmap(const_cast<char*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        std::vector<char>().swap(buffer);
+    }
+
+    const char* Data() const { return data; }
+    std::size_t Size() const { return size; }
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::vector<char> buffer;
+};
+#endif
@@ -0,0 +1,172 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include "shader.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// Texture roles a material can bind. The order defines the fixed texture unit layout.
+enum class TextureRole {
+    DIFFUSE,
+    SPECULAR,
+    NORMAL,
+    HEIGHT,
+    EMISSIVE,
+    COUNT
+};
+
+const unsigned int TEXTURE_ROLE_COUNT    = static_cast<unsigned int>(TextureRole::COUNT);
+const unsigned int MAX_TEXTURES_PER_ROLE = 3;
+const unsigned int MAX_MATERIAL_UNITS    = TEXTURE_ROLE_COUNT * MAX_TEXTURES_PER_ROLE;
+
+// sampler prefix used in the shaders for each role, e.g. texture_diffuseN
+inline const char* TextureRoleName(TextureRole role)
+{
+    switch (role) {
+        case TextureRole::DIFFUSE:  return "texture_diffuse";
+        case TextureRole::SPECULAR: return "texture_specular";
+        case TextureRole::NORMAL:   return "texture_normal";
+        case TextureRole::HEIGHT:   return "texture_height";
+        case TextureRole::EMISSIVE: return "texture_emissive";
+        default:                    return "";
+    }
+}
+
+// fixed texture unit for the Nth (0 based) texture of a role. The first texture of every role
+// lands on units 0..4 so a single-map material keeps texture_diffuse1 on GL_TEXTURE0.
+inline unsigned int MaterialUnit(TextureRole role, unsigned int index)
+{
+    return index * TEXTURE_ROLE_COUNT + static_cast<unsigned int>(role);
+}
+
+// A set of textures bound to fixed texture units, created once at load time.
+// Sampler uniforms are resolved once per shader program and shared by every material.
+class Material
+{
+public:
+    struct Binding {
+        unsigned int unit;
+        unsigned int textureID;
+    };
+
+    // bindings sorted by texture unit
+    std::vector<Binding> bindings;
+    // bit N set if unit N is used by this material
+    unsigned int unitMask = 0;
+    // unique per material, used as a sort key when batching draws
+    unsigned int ID;
+
+    Material() : ID(nextID()) {}
+
+    // add a texture of the given role; textures beyond MAX_TEXTURES_PER_ROLE are ignored
+    void AddTexture(TextureRole role, unsigned int textureID)
+    {
+        unsigned int index = roleCounts[static_cast<unsigned int>(role)];
+        if (index >= MAX_TEXTURES_PER_ROLE) {
+            std::cout << "WARNING::MATERIAL:: too many " << TextureRoleName(role) << " textures, ignoring" << std::endl;
+            return;
+        }
+        roleCounts[static_cast<unsigned int>(role)]++;
+
+        Binding binding = { MaterialUnit(role, index), textureID };
+        bindings.insert(std::upper_bound(bindings.begin(), bindings.end(), binding,
+                    [](const Binding &a, const Binding &b) { return a.unit < b.unit; }), binding);
+        unitMask |= 1u << binding.unit;
+    }
+
+    // points the bindings of texture from at texture to, e.g. once from has been reloaded
+    void ReplaceTexture(unsigned int from, unsigned int to)
+    {
+        for (Binding &binding : bindings)
+            if (binding.textureID == from)
+                binding.textureID = to;
+    }
+
+    // drops the sampler locations cached for a program that was deleted (or rebuilt), its
+    // name may be handed out again
+    static void ForgetProgram(unsigned int program)
+    {
+        layouts().erase(program);
+    }
+
+    // true if both materials bind the same textures to the same units
+    bool SameTextures(const Material &other) const
+    {
+        if (unitMask != other.unitMask)
+            return false;
+        for (unsigned int i = 0; i < bindings.size(); i++)
+            if (bindings[i].textureID != other.bindings[i].textureID)
+                return false;
+        return true;
+    }
+
+    // bind all textures; the shader must already be in use. Only the samplers of the roles
+    // this material has are assigned, so samplers of missing roles keep whatever unit the
+    // caller set (e.g. texture_specular1 falling back to the diffuse unit).
+    void Bind(const Shader &shader) const
+    {
+        SamplerLayout &layout = samplerLayout(shader.ID);
+        if ((layout.assigned & unitMask) != unitMask)
+            assignSamplers(layout);
+
+        for (const Binding &binding : bindings) {
+            glActiveTexture(GL_TEXTURE0 + binding.unit);
+            glBindTexture(GL_TEXTURE_2D, binding.textureID);
+        }
+    }
+
+private:
+    // per program sampler locations, indexed by texture unit
+    struct SamplerLayout {
+        std::array<int, MAX_MATERIAL_UNITS> locations;
+        unsigned int assigned = 0;
+        bool resolved = false;
+    };
+
+    unsigned int roleCounts[TEXTURE_ROLE_COUNT] = {};
+
+    static unsigned int nextID()
+    {
+        static unsigned int counter = 0;
+        return counter++;
+    }
+
+    static std::map<unsigned int, SamplerLayout>& layouts()
+    {
+        static std::map<unsigned int, SamplerLayout> layouts;
+        return layouts;
+    }
+
+    static SamplerLayout& samplerLayout(unsigned int program)
+    {
+        SamplerLayout &layout = layouts()[program];
+        if (!layout.resolved) {
+            // one lookup per program and unit, never repeated during draws
+            for (unsigned int unit = 0; unit < MAX_MATERIAL_UNITS; unit++) {
+                TextureRole role = static_cast<TextureRole>(unit % TEXTURE_ROLE_COUNT);
+                std::string name = TextureRoleName(role) + std::to_string(unit / TEXTURE_ROLE_COUNT + 1);
+                layout.locations[unit] = glGetUniformLocation(program, name.c_str());
+            }
+            layout.resolved = true;
+        }
+        return layout;
+    }
+
+    // point the sampler uniforms of this material's units at their fixed texture units
+    void assignSamplers(SamplerLayout &layout) const
+    {
+        for (const Binding &binding : bindings) {
+            if (layout.locations[binding.unit] != -1)
+                glUniform1i(layout.locations[binding.unit], binding.unit);
+        }
+        layout.assigned |= unitMask;
+    }
+};
+#endif
@@ -7,8 +7,14 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "shader.h"
-
-#include <limits>
+#include "material.h"
+#include "geometryArena.h"
+#include "gpuResource.h"
+#include "meshStorage.h"
+#include "bounds.h"
+
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <vector>
 using namespace std;
@@ -30,98 +36,176 @@ struct Vertex {
 	int m_BoneIDs[MAX_BONE_INFLUENCE];
 	//weights from each bone
 	float m_Weights[MAX_BONE_INFLUENCE];
+
+    // set the vertex attribute pointers for the currently bound VAO/VBO
+    static void SetupAttributes()
+    {
+        // vertex Positions
+        glEnableVertexAttribArray(0);	
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        // vertex normals
+        glEnableVertexAttribArray(1);	
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);	
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        // vertex bitangent
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+		// ids
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+
+		// weights
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+    }
 };
 
+// arena holding meshes of the Vertex layout
+typedef GeometryArena<Vertex> MeshArena;
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
+    TextureRole role;
 };
 
+// move-only: a mesh outside an arena owns its buffers. What it keeps of its geometry on the
+// CPU lives in its model's MeshStorage, see CpuGeometry.
 class Mesh {
 public:
-    // mesh Data
-    vector<Vertex>       vertices;
-    vector<unsigned int> indices;
-    vector<Texture>      textures;
+    // mesh Data, CPU copy of range.vertexCount vertices and range.indexCount indices:
+    // vertices when kept in full, positions when only positions are kept, null if discarded
+    const Vertex       *vertices = nullptr;
+    const glm::vec3    *positions = nullptr;
+    const unsigned int *indices = nullptr;
     unsigned int VAO;
+    // where this mesh lives in its vertex/index buffers (the arena's, or its own)
+    GeometryRange range;
+    // bounds of the vertices in model space, kept whatever happens to the geometry
+    Bounds bounds;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // textures of this mesh, shared with every mesh using identical textures
+    shared_ptr<Material> material;
+
+    // constructor, the mesh owns its buffers and keeps no CPU copy of the geometry
+    Mesh(const vector<Vertex> &vertices, const vector<unsigned int> &indices, const vector<Texture> &textures)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        // build a private material from the texture list
+        material = make_shared<Material>();
+        for (const Texture &texture : textures)
+            material->AddTexture(texture.role, texture.id);
 
+        if (!vertices.empty())
+            bounds = Bounds::FromPoints(&vertices[0].Position, vertices.size(), sizeof(Vertex));
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(vertices.empty() ? nullptr : &vertices[0], vertices.size(), indices.empty() ? nullptr : &indices[0], indices.size());
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // constructor with pre-computed bounds and a pre-built (possibly shared) material, uploading
+    // the given arrays. If an arena is given the geometry is sub-allocated from it and VAO is the
+    // arena's, otherwise the mesh owns its buffers. The part of the geometry asked for by keep
+    // is copied into storage.
+    Mesh(const Vertex *vertices, std::size_t vertexCount, const unsigned int *indices, std::size_t indexCount, const Bounds &bounds,
+            shared_ptr<Material> material, MeshArena *arena = nullptr, MeshStorage *storage = nullptr, CpuGeometry keep = CpuGeometry::NONE)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        unsigned int emissiveNr = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        this->bounds = bounds;
+        this->material = material;
+
+        if (arena)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-             else if(name == "texture_emissive")
-                number = std::to_string(emissiveNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            range = arena->Allocate(vertices, vertexCount, indices, indexCount);
+            VAO = arena->VAO;
+            VBO = arena->VBO;
+            EBO = arena->EBO;
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        else
+            setupMesh(vertices, vertexCount, indices, indexCount);
+
+        if (storage && keep == CpuGeometry::FULL)
+            this->vertices = storage->Copy(vertices, vertexCount);
+        else if (storage && keep == CpuGeometry::POSITIONS)
+        {
+            glm::vec3 *kept = storage->Allocate<glm::vec3>(vertexCount);
+            for (std::size_t i = 0; i < vertexCount; i++)
+                kept[i] = vertices[i].Position;
+            this->positions = kept;
+        }
+        if (storage && keep != CpuGeometry::NONE)
+            this->indices = storage->Copy(indices, indexCount);
+    }
+
+    // render the mesh
+    void Draw(Shader &shader) 
+    {
+        // bind appropriate textures to their fixed units
+        material->Bind(shader);
+
+        DrawGeometry();
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
-    // Get dimensions of mesh
-    glm::vec3 GetDimensions() const {
-        glm::vec3 minCoords(std::numeric_limits<float>::max());
-        glm::vec3 maxCoords(std::numeric_limits<float>::lowest());
+    // issue the draw call only, textures are expected to be bound already
+    void DrawGeometry() const
+    {
+        glBindVertexArray(VAO);
+        DrawElements();
+        glBindVertexArray(0);
+    }
 
-        for (const auto& vertex : vertices) {
-            minCoords = glm::min(minCoords, vertex.Position);
-            maxCoords = glm::max(maxCoords, vertex.Position);
-        }
+    // draw this mesh's range of the currently bound VAO (this->VAO or its arena's)
+    void DrawElements() const
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                (void*)(range.firstIndex * sizeof(unsigned int)), range.baseVertex);
+    }
 
-        return maxCoords - minCoords;
+    // instanced version of DrawElements
+    void DrawElementsInstanced(unsigned int instanceCount) const
+    {
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT,
+                (void*)(range.firstIndex * sizeof(unsigned int)), instanceCount, range.baseVertex);
+    }
+
+    // position of a kept vertex, whether the geometry was kept in full or as positions only
+    glm::vec3 Position(unsigned int vertex) const
+    {
+        return vertices ? vertices[vertex].Position : positions[vertex];
+    }
+
+    // true if Position and indices can be used, e.g. for picking
+    bool HasPositions() const { return (vertices || positions) && indices; }
+
+    // Get dimensions of mesh
+    glm::vec3 GetDimensions() const {
+        return bounds.Size();
     }
 
 private:
-    // render data 
+    // render data: the arena's buffers, or the mesh's own (owned, deleted with the mesh)
     unsigned int VBO, EBO;
+    GpuVertexArray ownVAO;
+    GpuBuffer ownVBO, ownEBO;
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertices, std::size_t vertexCount, const unsigned int *indices, std::size_t indexCount)
     {
         // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        ownVAO = GpuVertexArray::Create("mesh");
+        ownVBO = GpuBuffer::Create("mesh vertices");
+        ownEBO = GpuBuffer::Create("mesh indices");
+        ownVBO.SetBytes(vertexCount * sizeof(Vertex));
+        ownEBO.SetBytes(indexCount * sizeof(unsigned int));
+        VAO = ownVAO;
+        VBO = ownVBO;
+        EBO = ownEBO;
 
         glBindVertexArray(VAO);
         // load data into vertex buffers
@@ -129,34 +213,16 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
 
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+        range.indexCount = static_cast<unsigned int>(indexCount);
+        range.vertexCount = static_cast<unsigned int>(vertexCount);
 
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+        // set the vertex attribute pointers
+        Vertex::SetupAttributes();
         glBindVertexArray(0);
     }
 };
@@ -0,0 +1,109 @@
+#ifndef MESH_STORAGE_H
+#define MESH_STORAGE_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// what a model keeps of its geometry in CPU memory once it is uploaded
+enum class CpuGeometry {
+    FULL,       // every vertex and index
+    POSITIONS,  // vertex positions and indices only, enough for picking
+    NONE        // nothing, meshes only know their bounds
+};
+
+// CPU copy of one model's geometry: the vertex data and indices of every mesh packed back to
+// back in a single allocation, sized once with Reserve before the meshes are added. Meshes
+// point into it, so nothing handed out ever moves; allocations that don't fit the reserved
+// block (nothing reserved, or more than announced) get a block of their own.
+class MeshStorage
+{
+public:
+    // bytes taken by count elements of type T, add these up to Reserve exactly
+    template <typename T>
+    static std::size_t Footprint(std::size_t count)
+    {
+        return padded(count * sizeof(T));
+    }
+
+    // room for bytes more data in one block
+    void Reserve(std::size_t bytes)
+    {
+        if (bytes > 0)
+            addBlock(bytes);
+    }
+
+    // uninitialized room for count elements of a trivially copyable T
+    template <typename T>
+    T* Allocate(std::size_t count)
+    {
+        return count == 0 ? nullptr : static_cast<T*>(allocate(count * sizeof(T)));
+    }
+
+    // count elements copied from data
+    template <typename T>
+    T* Copy(const T *data, std::size_t count)
+    {
+        T *copy = Allocate<T>(count);
+        if (copy)
+            std::memcpy(copy, data, count * sizeof(T));
+        return copy;
+    }
+
+    // bytes held, reserved or not
+    std::size_t Bytes() const
+    {
+        std::size_t bytes = 0;
+        for (const Block &block : blocks)
+            bytes += block.size;
+        return bytes;
+    }
+
+    void Clear()
+    {
+        blocks.clear();
+    }
+
+private:
+    // every allocation starts aligned for any vertex member
+    static const std::size_t ALIGNMENT = 16;
+
+    struct Block {
+        std::unique_ptr<unsigned char, void(*)(void*)> data{nullptr, std::free};
+        std::size_t size = 0;
+        std::size_t used = 0;
+    };
+    std::vector<Block> blocks;
+
+    static std::size_t padded(std::size_t bytes)
+    {
+        return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    void* allocate(std::size_t bytes)
+    {
+        bytes = padded(bytes);
+        for (Block &block : blocks) {
+            if (block.size - block.used >= bytes) {
+                void *allocation = block.data.get() + block.used;
+                block.used += bytes;
+                return allocation;
+            }
+        }
+        Block &block = addBlock(bytes);
+        block.used = bytes;
+        return block.data.get();
+    }
+
+    Block& addBlock(std::size_t bytes)
+    {
+        bytes = padded(bytes);
+        blocks.emplace_back();
+        blocks.back().data.reset(static_cast<unsigned char*>(std::malloc(bytes)));
+        blocks.back().size = bytes;
+        return blocks.back();
+    }
+};
+#endif
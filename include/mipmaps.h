@@ -0,0 +1,275 @@
+#ifndef MIPMAPS_H
+#define MIPMAPS_H
+
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const unsigned int MAX_MIP_LEVELS = 16;
+
+enum class MipFilter {
+    BOX,        // 2x2 average, what glGenerateMipmap does
+    KAISER      // Kaiser windowed sinc over 6x6 texels, keeps detail without aliasing
+};
+
+struct MipOptions {
+    MipFilter filter = MipFilter::KAISER;
+    // color channels are sRGB encoded: filter in linear space (alpha stays linear)
+    bool srgb = false;
+    // tangent space normals: filter the decoded vectors and renormalize them
+    bool normalMap = false;
+    unsigned int maxLevels = MAX_MIP_LEVELS;
+};
+
+// a whole mip chain of an 8 bit image in one allocation; level N is
+// max(width >> N, 1) x max(height >> N, 1) texels, tightly packed
+struct MipChain {
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::unique_ptr<unsigned char, void(*)(void*)> data{nullptr, std::free};
+    std::vector<std::size_t> offsets;   // start of each level in data, offsets[0] is 0
+    std::size_t size = 0;
+
+    unsigned int Levels() const { return static_cast<unsigned int>(offsets.size()); }
+    int LevelWidth(unsigned int level) const { return std::max(width >> level, 1); }
+    int LevelHeight(unsigned int level) const { return std::max(height >> level, 1); }
+    unsigned char* Level(unsigned int level) const { return data.get() + offsets[level]; }
+    std::size_t LevelSize(unsigned int level) const { return (level + 1 < offsets.size() ? offsets[level + 1] : size) - offsets[level]; }
+};
+
+namespace MipDetail
+{
+    // filter taps of one destination texel along one axis
+    struct Taps {
+        int first;
+        std::vector<float> weights;
+    };
+
+    inline double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 20; k++) {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // taps for every destination texel when scaling source texels down to destination
+    inline std::vector<Taps> axisTaps(int source, int destination, MipFilter filter)
+    {
+        std::vector<Taps> taps(destination);
+        if (source == destination) {
+            for (int i = 0; i < destination; i++)
+                taps[i] = { i, { 1.0f } };
+            return taps;
+        }
+        const double radius = 3.0, alpha = 4.0;   // in source texels, Kaiser beta
+        double scale = static_cast<double>(source) / destination;
+        for (int i = 0; i < destination; i++) {
+            if (filter == MipFilter::BOX) {
+                taps[i] = { 2 * i, { 0.5f, 0.5f } };
+                continue;
+            }
+            double center = (i + 0.5) * scale;
+            int first = static_cast<int>(std::floor(center - radius));
+            int last = static_cast<int>(std::ceil(center + radius));
+            std::vector<float> weights;
+            double total = 0.0;
+            for (int s = first; s < last; s++) {
+                double t = (s + 0.5 - center) / scale;    // in destination texels
+                double window = t * scale / radius;
+                double weight = 0.0;
+                if (std::fabs(window) < 1.0) {
+                    const double pi = 3.14159265358979323846;
+                    double sinc = std::fabs(t) < 1e-6 ? 1.0 : std::sin(pi * t) / (pi * t);
+                    weight = sinc * besselI0(alpha * std::sqrt(1.0 - window * window)) / besselI0(alpha);
+                }
+                weights.push_back(static_cast<float>(weight));
+                total += weight;
+            }
+            for (float &weight : weights)
+                weight = static_cast<float>(weight / total);
+            taps[i] = { first, weights };
+        }
+        return taps;
+    }
+
+    // 8 bit value to the filtering space of each channel
+    struct Decode {
+        float table[4][256];
+
+        Decode(int components, const MipOptions &options)
+        {
+            for (int c = 0; c < 4; c++) {
+                bool alpha = (components == 2 && c == 1) || (components == 4 && c == 3);
+                for (int v = 0; v < 256; v++) {
+                    float x = v / 255.0f;
+                    if (options.normalMap && !alpha)
+                        x = x * 2.0f - 1.0f;
+                    else if (options.srgb && !alpha)
+                        x = x <= 0.04045f ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+                    table[c][v] = x;
+                }
+            }
+        }
+    };
+
+    // linear value back to sRGB bytes
+    struct EncodeSrgb {
+        static const int SIZE = 4096;
+        unsigned char table[SIZE + 1];
+
+        EncodeSrgb()
+        {
+            for (int i = 0; i <= SIZE; i++) {
+                float x = static_cast<float>(i) / SIZE;
+                float s = x <= 0.0031308f ? x * 12.92f : 1.055f * std::pow(x, 1.0f / 2.4f) - 0.055f;
+                table[i] = static_cast<unsigned char>(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+            }
+        }
+    };
+
+    inline unsigned char toByte(float x)
+    {
+        return static_cast<unsigned char>(std::min(std::max(x * 255.0f + 0.5f, 0.0f), 255.0f));
+    }
+
+    // horizontal pass of one source row into destinationWidth float4 texels
+    inline void filterColumns(const unsigned char *sourceRow, int sourceWidth, int components, const std::vector<Taps> &columns,
+            const Decode &decode, float *out)
+    {
+        for (std::size_t x = 0; x < columns.size(); x++) {
+            const Taps &column = columns[x];
+#if defined(__SSE2__)
+            __m128 sum = _mm_setzero_ps();
+            for (std::size_t tx = 0; tx < column.weights.size(); tx++) {
+                int sx = std::min(std::max(column.first + static_cast<int>(tx), 0), sourceWidth - 1);
+                const unsigned char *texel = sourceRow + sx * components;
+                __m128 value = _mm_set_ps(components > 3 ? decode.table[3][texel[3]] : 0.0f,
+                                          components > 2 ? decode.table[2][texel[2]] : 0.0f,
+                                          components > 1 ? decode.table[1][texel[1]] : 0.0f,
+                                          decode.table[0][texel[0]]);
+                sum = _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(column.weights[tx])));
+            }
+            _mm_storeu_ps(out + 4 * x, sum);
+#else
+            float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (std::size_t tx = 0; tx < column.weights.size(); tx++) {
+                int sx = std::min(std::max(column.first + static_cast<int>(tx), 0), sourceWidth - 1);
+                const unsigned char *texel = sourceRow + sx * components;
+                for (int c = 0; c < components; c++)
+                    sum[c] += decode.table[c][texel[c]] * column.weights[tx];
+            }
+            for (int c = 0; c < 4; c++)
+                out[4 * x + c] = sum[c];
+#endif
+        }
+    }
+
+    // vertical pass: weighted sum of horizontally filtered rows (width float4 texels each)
+    inline void filterRows(const float *const *rows, const float *weights, std::size_t count, int width, float *out)
+    {
+#if defined(__SSE2__)
+        for (int x = 0; x < width; x++) {
+            __m128 sum = _mm_setzero_ps();
+            for (std::size_t i = 0; i < count; i++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[i] + 4 * x), _mm_set1_ps(weights[i])));
+            _mm_storeu_ps(out + 4 * x, sum);
+        }
+#else
+        for (int x = 0; x < 4 * width; x++) {
+            float sum = 0.0f;
+            for (std::size_t i = 0; i < count; i++)
+                sum += rows[i][x] * weights[i];
+            out[x] = sum;
+        }
+#endif
+    }
+}
+
+// Builds the mip chain of an 8 bit image (1 to 4 components as decoded by stb_image) on the
+// job system, rows of each level in parallel. Level 0 is a copy of the image.
+inline MipChain BuildMipChain(const unsigned char *pixels, int width, int height, int components,
+        const MipOptions &options = MipOptions(), JobSystem &jobs = JobSystem::Global())
+{
+    MipChain chain;
+    chain.width = width;
+    chain.height = height;
+    chain.components = components;
+    for (unsigned int level = 0; level < std::max(options.maxLevels, 1u); level++) {
+        chain.offsets.push_back(chain.size);
+        chain.size += static_cast<std::size_t>(chain.LevelWidth(level)) * chain.LevelHeight(level) * components;
+        if (chain.LevelWidth(level) == 1 && chain.LevelHeight(level) == 1)
+            break;
+    }
+    chain.data.reset(static_cast<unsigned char*>(std::malloc(chain.size)));
+    std::memcpy(chain.data.get(), pixels, static_cast<std::size_t>(width) * height * components);
+
+    static const MipDetail::EncodeSrgb srgbEncode;
+    MipDetail::Decode decode(components, options);
+    int colorChannels = components == 2 || components == 4 ? components - 1 : components;
+
+    for (unsigned int level = 1; level < chain.Levels(); level++) {
+        const unsigned char *source = chain.Level(level - 1);
+        unsigned char *destination = chain.Level(level);
+        int sourceWidth = chain.LevelWidth(level - 1), sourceHeight = chain.LevelHeight(level - 1);
+        int destinationWidth = chain.LevelWidth(level), destinationHeight = chain.LevelHeight(level);
+        std::vector<MipDetail::Taps> columns = MipDetail::axisTaps(sourceWidth, destinationWidth, options.filter);
+        std::vector<MipDetail::Taps> rows = MipDetail::axisTaps(sourceHeight, destinationHeight, options.filter);
+
+        // separable filter: each chunk of destination rows filters the source rows it needs
+        // horizontally once, then combines them vertically
+        jobs.ParallelFor(0, static_cast<std::size_t>(destinationHeight), 16, [&](std::size_t begin, std::size_t end) {
+            int firstRow = rows[begin].first;
+            int lastRow = rows[end - 1].first + static_cast<int>(rows[end - 1].weights.size());
+            std::size_t rowFloats = 4 * static_cast<std::size_t>(destinationWidth);
+            std::vector<float> horizontal(static_cast<std::size_t>(lastRow - firstRow) * rowFloats);
+            for (int sy = firstRow; sy < lastRow; sy++) {
+                int clamped = std::min(std::max(sy, 0), sourceHeight - 1);
+                MipDetail::filterColumns(source + static_cast<std::size_t>(clamped) * sourceWidth * components, sourceWidth, components,
+                        columns, decode, &horizontal[(sy - firstRow) * rowFloats]);
+            }
+
+            std::vector<float> accumulator(rowFloats);
+            std::vector<const float*> taps;
+            for (std::size_t y = begin; y < end; y++) {
+                taps.clear();
+                for (std::size_t ty = 0; ty < rows[y].weights.size(); ty++)
+                    taps.push_back(&horizontal[(rows[y].first + ty - firstRow) * rowFloats]);
+                MipDetail::filterRows(taps.data(), rows[y].weights.data(), taps.size(), destinationWidth, accumulator.data());
+                unsigned char *out = destination + y * destinationWidth * components;
+                for (int x = 0; x < destinationWidth; x++) {
+                    float *texel = &accumulator[4 * x];
+                    if (options.normalMap && colorChannels >= 3) {
+                        float length = std::sqrt(texel[0] * texel[0] + texel[1] * texel[1] + texel[2] * texel[2]);
+                        for (int c = 0; c < 3; c++)
+                            texel[c] = length > 1e-6f ? texel[c] / length : (c == 2 ? 1.0f : 0.0f);
+                    }
+                    for (int c = 0; c < components; c++) {
+                        float value = texel[c];
+                        if (c < colorChannels && options.normalMap)
+                            out[x * components + c] = MipDetail::toByte(value * 0.5f + 0.5f);
+                        else if (c < colorChannels && options.srgb)
+                            out[x * components + c] = srgbEncode.table[static_cast<int>(std::min(std::max(value, 0.0f), 1.0f) * MipDetail::EncodeSrgb::SIZE + 0.5f)];
+                        else
+                            out[x * components + c] = MipDetail::toByte(value);
+                    }
+                }
+            }
+        });
+    }
+    return chain;
+}
+#endif
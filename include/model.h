@@ -11,6 +11,8 @@
 
 #include "shader.h"
 #include "camera.h"
+#include "frustum.h"
+#include "skeleton.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -18,16 +20,30 @@
 
 #include "shader.h"
 #include "mesh.h"
+#include "material.h"
+#include "modelData.h"
+#include "objLoader.h"
+#include "assetPack.h"
+#include "mipmaps.h"
+#include "textureUploader.h"
+#include "textureStreamer.h"
+#include "jobSystem.h"
 
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, TextureRole role = TextureRole::DIFFUSE);
+unsigned int TextureFromData(const unsigned char *data, int width, int height, int nrComponents, bool gamma = false);
+unsigned int TextureFromLevels(const unsigned char *data, const vector<size_t> &levelOffsets, int width, int height, int nrComponents, bool gamma = false);
+unsigned int TextureFromCompressed(const unsigned char *data, const vector<size_t> &levelOffsets, BlockFormat format, int width, int height, bool gamma = false);
 
 class Model 
 {
@@ -35,32 +51,177 @@ public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    vector<shared_ptr<Material>> materials_loaded; // unique materials, shared by meshes with identical textures
+    vector<unsigned int> drawOrder;                // mesh indices sorted by material
     string directory;
     bool gammaCorrection;
+    // vertex/index storage shared by all meshes of this model (and by default every other model)
+    MeshArena *arena;
+    // bounds of all meshes, in model space
+    Bounds bounds;
+    // what the meshes keep of their geometry once uploaded; bounds are always kept
+    CpuGeometry keepGeometry;
+    // joints and animations the meshes' bone ids refer to, null for static models (see SkinnedBatch)
+    shared_ptr<const Skeleton> skeleton;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // meshes are sub-allocated from the given arena, the scene-wide one unless specified.
+    Model(string const &path, bool gamma = false, MeshArena *arena = &MeshArena::Shared(), CpuGeometry keep = CpuGeometry::FULL)
+        : gammaCorrection(gamma), arena(arena), keepGeometry(keep)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // empty model, filled from a ModelData with ReserveGeometry, AddTexture, AddMesh and FinishLoading
+    Model(MeshArena *arena, bool gamma, CpuGeometry keep = CpuGeometry::FULL) : gammaCorrection(gamma), arena(arena), keepGeometry(keep)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
     }
 
-    // get dimensions of mesh
-    // this only accounts for 0th mesh and should only be used for single mesh objects
-    glm::vec3 Get0MeshDimensions() 
+    // a model owns its textures and (through its meshes) the buffers of meshes outside an
+    // arena: it can be moved but not copied. Arena geometry is freed back to the arena.
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    Model(Model &&other) noexcept
+        : textures_loaded(std::move(other.textures_loaded)), meshes(std::move(other.meshes)), materials_loaded(std::move(other.materials_loaded)),
+          drawOrder(std::move(other.drawOrder)), directory(std::move(other.directory)), gammaCorrection(other.gammaCorrection), arena(other.arena),
+          bounds(other.bounds), keepGeometry(other.keepGeometry), skeleton(std::move(other.skeleton)), textureHandles(std::move(other.textureHandles)),
+          geometry(std::move(other.geometry))
     {
-        return meshes[0].GetDimensions();
+        other.textures_loaded.clear();
+        other.meshes.clear();
     }
 
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    Model& operator=(Model &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            textures_loaded = std::move(other.textures_loaded);
+            meshes = std::move(other.meshes);
+            materials_loaded = std::move(other.materials_loaded);
+            drawOrder = std::move(other.drawOrder);
+            directory = std::move(other.directory);
+            gammaCorrection = other.gammaCorrection;
+            arena = other.arena;
+            bounds = other.bounds;
+            keepGeometry = other.keepGeometry;
+            skeleton = std::move(other.skeleton);
+            textureHandles = std::move(other.textureHandles);
+            geometry = std::move(other.geometry);
+            other.textures_loaded.clear();
+            other.meshes.clear();
+        }
+        return *this;
+    }
+
+    ~Model()
+    {
+        release();
+    }
+
+    // frees the model's textures and meshes now, leaving it empty. Models living until the
+    // end of main must be released before the GL context goes away (glfwTerminate).
+    void Release()
+    {
+        release();
+    }
+
+    // draws the model, and thus all its meshes. Meshes are visited in material order so
+    // each material is bound once per draw.
+    void Draw(const Shader &shader) const
+    {
+        draw(shader, nullptr, glm::mat4(1.0f), nullptr);
+    }
+
+    // draws only the meshes whose bounds, placed with transform (the model matrix the shader
+    // uses), intersect the frustum; nothing is bound for culled meshes. Tests are counted in
+    // stats if given.
+    void Draw(const Shader &shader, const glm::mat4 &transform, const Frustum &frustum, CullStats *stats = nullptr) const
+    {
+        draw(shader, &frustum, transform, stats);
+    }
+
+    // true if any part of the model placed with transform may be inside the frustum; when not,
+    // every mesh is counted as culled in stats
+    bool Visible(const glm::mat4 &transform, const Frustum &frustum, CullStats *stats = nullptr) const
+    {
+        if (frustum.Intersects(bounds.Transformed(transform)))
+            return true;
+        if (stats)
+            stats->total += static_cast<unsigned int>(meshes.size());
+        return false;
+    }
+
+    // whether a mesh of this model may be visible, once Visible passed; a lone mesh has the
+    // model's bounds and isn't tested again
+    bool MeshVisible(const Mesh &mesh, const glm::mat4 &transform, const Frustum &frustum, CullStats *stats = nullptr) const
+    {
+        if (meshes.size() > 1)
+            return frustum.Intersects(mesh.bounds, transform, stats);
+        if (stats)
+        {
+            stats->total++;
+            stats->visible++;
+        }
+        return true;
+    }
+
+    // asks the texture streamer for the mip levels of this model's textures when drawn with
+    // transform, seen from cameraPosition through a perspective projection of vertical field
+    // of view fovY (radians) on a viewport viewportHeight pixels tall. Call every frame the
+    // model is drawn; only streamed textures (TextureStreamer enabled at load) are affected.
+    void StreamTextures(const glm::mat4 &transform, const glm::vec3 &cameraPosition, float fovY, float viewportHeight) const
+    {
+        if (meshes.empty())
+            return;
+        Bounds world = bounds.Transformed(transform);
+        float pixels = TextureStreamer::ScreenSize(world.center, world.radius, cameraPosition, fovY, viewportHeight);
+        TextureStreamer &streamer = TextureStreamer::Shared();
+        for (const Texture &texture : textures_loaded)
+            streamer.Request(texture.id, pixels);
+    }
+
+    // get dimensions of the model's bounding box, all meshes included
+    glm::vec3 GetDimensions() const
+    {
+        return bounds.Size();
+    }
+
+    // reads a model file and decodes its textures. Models cooked into the mounted AssetPack
+    // come straight from it; Wavefront .obj files go through the dedicated ObjImporter,
+    // everything else (or an .obj it rejects) through ASSIMP.
+    // Touches no GL or model state, so any thread may import.
+    static ModelData Import(string const &path, bool gamma = false, JobSystem &jobs = JobSystem::Global())
+    {
+        ModelData data;
+        const AssetPack *pack = AssetPack::Mounted();
+        if(pack && pack->ImportModel(path, gamma, data))
+        {
+            data.ComputeBounds(jobs);
+            data.valid = true;
+            return data;
+        }
+
+        bool imported = false;
+        if(ObjImporter::IsObj(path))
+        {
+            imported = ObjImporter::Import(path, data, gamma, jobs);
+            if(!imported)
+                data = ModelData();
+        }
+        if(!imported && !ImportAssimp(path, data, gamma, jobs))
+            return data;
+
+        data.DecodeTextures(jobs);
+        data.ComputeBounds(jobs);
+        data.valid = true;
+        return data;
+    }
+
+    // geometry and texture references (not decoded) of a model with supported ASSIMP
+    // extensions. Each call uses its own Assimp::Importer.
+    static bool ImportAssimp(string const &path, ModelData &data, bool gamma, JobSystem &jobs)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -69,173 +230,555 @@ private:
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            return false;
         }
         // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        data.directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<aiMesh*> sceneMeshes;
+        vector<glm::mat4> sceneTransforms;
+        processNode(scene->mRootNode, scene, glm::mat4(1.0f), sceneMeshes, sceneTransforms);
+        // joints, bones and animations if any mesh is skinned
+        map<string, unsigned int> boneIds;
+        data.skeleton = importSkeleton(scene, boneIds);
+
+        // converting vertices and indices is plain CPU work, do every mesh in parallel. Skinned
+        // meshes stay in their own space, their bones place them.
+        data.meshes.resize(sceneMeshes.size());
+        jobs.ParallelFor(0, sceneMeshes.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++)
+            {
+                bool skinned = data.skeleton && sceneMeshes[i]->HasBones();
+                convertMesh(sceneMeshes[i], skinned ? glm::mat4(1.0f) : sceneTransforms[i], data.meshes[i].vertices, data.meshes[i].indices, jobs);
+                if(skinned)
+                    assignBoneWeights(sceneMeshes[i], boneIds, data.meshes[i].vertices);
+            }
+        });
+        for(unsigned int i = 0; i < sceneMeshes.size(); i++)
+            collectTextures(scene->mMaterials[sceneMeshes[i]->mMaterialIndex], data, data.meshes[i], gamma);
+        return true;
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // sizes the CPU copy of the geometry for every mesh of data (as far as keepGeometry keeps
+    // it) in one allocation. Call before adding the meshes.
+    void ReserveGeometry(const ModelData &data)
     {
-        // process each mesh located at the current node
+        meshes.reserve(meshes.size() + data.meshes.size());
+        if(keepGeometry == CpuGeometry::NONE)
+            return;
+        size_t bytes = 0;
+        for(const ImportedMesh &mesh : data.meshes)
+        {
+            bytes += keepGeometry == CpuGeometry::FULL ? MeshStorage::Footprint<Vertex>(mesh.vertices.size())
+                                                       : MeshStorage::Footprint<glm::vec3>(mesh.vertices.size());
+            bytes += MeshStorage::Footprint<unsigned int>(mesh.indices.size());
+        }
+        geometry.Reserve(bytes);
+    }
+
+    // bytes of geometry kept in CPU memory
+    size_t GeometryBytes() const { return geometry.Bytes(); }
+
+    // creates the GL texture of data.textures[N]; textures must be added in order and before
+    // any mesh. Call on the GL thread. With the TextureStreamer enabled, mip chains only go
+    // up with their small levels and the streamer keeps the pixels.
+    void AddTexture(ImportedTexture &imported)
+    {
+        Texture texture;
+        texture.id = uploadTexture(imported);
+        texture.type = TextureRoleName(imported.role);
+        texture.role = imported.role;
+        texture.path = imported.path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
+    }
+
+    // swaps textures_loaded[index] for a newly decoded image of it (its file changed) and
+    // points every material that sampled the old texture at the new one. Call on the GL thread.
+    void ReplaceTexture(unsigned int index, ImportedTexture &imported)
+    {
+        unsigned int previous = textures_loaded[index].id;
+        unsigned int id = uploadTexture(imported);
+        for (const shared_ptr<Material> &material : materials_loaded)
+            material->ReplaceTexture(previous, id);
+        textures_loaded[index].id = id;
+        // free the old texture, whoever owns it
+        TextureStreamer::Shared().Remove(previous);
+        for (size_t i = 0; i < textureHandles.size(); i++)
+            if (textureHandles[i] == previous)
+            {
+                textureHandles.erase(textureHandles.begin() + i);
+                break;
+            }
+    }
+
+    // uploads the geometry of an imported mesh into the arena, copies what keepGeometry asks
+    // for into the model's storage and frees the import's vertices and indices. Call on the GL thread.
+    void AddMesh(ImportedMesh &imported)
+    {
+        vector<Texture> textures;
+        for(const pair<unsigned int, TextureRole> &reference : imported.textures)
+        {
+            Texture texture = textures_loaded[reference.first];
+            texture.type = TextureRoleName(reference.second);
+            texture.role = reference.second;
+            textures.push_back(texture);
+        }
+        // build the mesh in place from the extracted mesh data
+        meshes.emplace_back(imported.vertices.data(), imported.vertices.size(), imported.indices.data(), imported.indices.size(),
+                imported.bounds, findOrCreateMaterial(textures), arena, &geometry, keepGeometry);
+        bounds.Merge(imported.bounds);
+        vector<Vertex>().swap(imported.vertices);
+        vector<unsigned int>().swap(imported.indices);
+    }
+
+    // call once every texture and mesh has been added
+    void FinishLoading()
+    {
+        // sort draws by material so consecutive meshes share bindings
+        drawOrder.resize(meshes.size());
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            drawOrder[i] = i;
+        std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b) {
+            return meshes[a].material->ID < meshes[b].material->ID;
+        });
+    }
+
+private:
+    // Draw with optional culling, of the whole model first, then of each mesh
+    void draw(const Shader &shader, const Frustum *frustum, const glm::mat4 &transform, CullStats *stats) const
+    {
+        if (frustum && !Visible(transform, *frustum, stats))
+            return;
+        // meshes in an arena share its VAO, bound once for the whole model; meshes with their
+        // own buffers bind theirs
+        unsigned int boundVAO = 0;
+        const Material *bound = nullptr;
+        for(unsigned int i = 0; i < drawOrder.size(); i++)
+        {
+            const Mesh &mesh = meshes[drawOrder[i]];
+            if (frustum && !MeshVisible(mesh, transform, *frustum, stats))
+                continue;
+            if (mesh.material.get() != bound)
+            {
+                mesh.material->Bind(shader);
+                bound = mesh.material.get();
+            }
+            if (mesh.VAO != boundVAO)
+            {
+                glBindVertexArray(mesh.VAO);
+                boundVAO = mesh.VAO;
+            }
+            mesh.DrawElements();
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // textures not owned by the streamer
+    vector<GpuTexture> textureHandles;
+
+    // the GL texture of imported, streamed or owned by textureHandles; frees the pixels
+    unsigned int uploadTexture(ImportedTexture &imported)
+    {
+        unsigned int id;
+        TextureStreamer &streamer = TextureStreamer::Shared();
+        if(streamer.Enabled && imported.data && !imported.levelOffsets.empty())
+            id = streamer.Add(imported);
+        else
+        {
+            if(imported.format != BlockFormat::NONE)
+                id = TextureFromCompressed(imported.data.get(), imported.levelOffsets, imported.format, imported.width, imported.height, imported.gamma);
+            else
+                id = TextureFromLevels(imported.data.get(), imported.levelOffsets, imported.width, imported.height, imported.nrComponents, imported.gamma);
+            textureHandles.push_back(GpuTexture::Adopt(id, "model " + directory));
+            textureHandles.back().SetBytes(imported.data ? imported.Bytes() : 0);
+        }
+        imported.data.reset();
+        return id;
+    }
+    // CPU copy of the meshes' geometry, see keepGeometry
+    MeshStorage geometry;
+
+    // deletes the textures (through the streamer for streamed ones) and mesh owned buffers
+    void release()
+    {
+        TextureStreamer &streamer = TextureStreamer::Shared();
+        for(const Texture &texture : textures_loaded)
+            streamer.Remove(texture.id);
+        textures_loaded.clear();
+        textureHandles.clear();
+        // arena geometry goes back to the arena, for the next model allocated from it
+        if(arena)
+            for(const Mesh &mesh : meshes)
+                arena->Free(mesh.range);
+        meshes.clear();
+        geometry.Clear();
+    }
+
+    // imports the file and uploads everything right away
+    void loadModel(string const &path)
+    {
+        ModelData data = Import(path, gammaCorrection);
+        if(!data.valid)
+            return;
+        directory = data.directory;
+        skeleton = data.skeleton;
+        ReserveGeometry(data);
+        for(ImportedTexture &texture : data.textures)
+            AddTexture(texture);
+        for(ImportedMesh &mesh : data.meshes)
+            AddMesh(mesh);
+        FinishLoading();
+    }
+
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node, along with the node's
+    // transform relative to the model (parent holds its parents'), and repeats this process on its children nodes (if any).
+    static void processNode(aiNode *node, const aiScene *scene, const glm::mat4 &parent, vector<aiMesh*> &sceneMeshes, vector<glm::mat4> &sceneTransforms)
+    {
+        glm::mat4 transform = parent * toGlm(node->mTransformation);
+        // collect each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            // a mesh referenced by several nodes is collected once per node.
+            sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+            sceneTransforms.push_back(transform);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, transform, sceneMeshes, sceneTransforms);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // assimp matrices are row major
+    static glm::mat4 toGlm(const aiMatrix4x4 &m)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        glm::mat4 result;
+        result[0] = glm::vec4(m.a1, m.b1, m.c1, m.d1);
+        result[1] = glm::vec4(m.a2, m.b2, m.c2, m.d2);
+        result[2] = glm::vec4(m.a3, m.b3, m.c3, m.d3);
+        result[3] = glm::vec4(m.a4, m.b4, m.c4, m.d4);
+        return result;
+    }
+
+    // copies the vertices and indices of an assimp mesh into our own format, placed with the
+    // transform of the node referencing it (baked in, models are static). Touches no GL or
+    // model state; big meshes are split into vertex ranges converted on all threads.
+    static void convertMesh(const aiMesh *mesh, const glm::mat4 &transform, vector<Vertex> &vertices, vector<unsigned int> &indices, JobSystem &jobs)
+    {
+        vertices.resize(mesh->mNumVertices);
+        bool placed = transform != glm::mat4(1.0f);
+        glm::mat3 linear(transform);
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
 
         // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
-        {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+        jobs.ParallelFor(0, mesh->mNumVertices, 4096, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i = begin; i < end; i++)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x; 
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+                Vertex vertex = {};
+                glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
+                // positions
+                vector.x = mesh->mVertices[i].x;
+                vector.y = mesh->mVertices[i].y;
+                vector.z = mesh->mVertices[i].z;
+                vertex.Position = vector;
+                // normals
+                if (mesh->HasNormals())
+                {
+                    vector.x = mesh->mNormals[i].x;
+                    vector.y = mesh->mNormals[i].y;
+                    vector.z = mesh->mNormals[i].z;
+                    vertex.Normal = vector;
+                }
+                // texture coordinates
+                if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+                {
+                    glm::vec2 vec;
+                    // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+                    // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+                    vec.x = mesh->mTextureCoords[0][i].x; 
+                    vec.y = mesh->mTextureCoords[0][i].y;
+                    vertex.TexCoords = vec;
+                    // tangent
+                    vector.x = mesh->mTangents[i].x;
+                    vector.y = mesh->mTangents[i].y;
+                    vector.z = mesh->mTangents[i].z;
+                    vertex.Tangent = vector;
+                    // bitangent
+                    vector.x = mesh->mBitangents[i].x;
+                    vector.y = mesh->mBitangents[i].y;
+                    vector.z = mesh->mBitangents[i].z;
+                    vertex.Bitangent = vector;
+                }
+                else
+                    vertex.TexCoords = glm::vec2(0.0f, 0.0f);
 
-            vertices.push_back(vertex);
+                if (placed)
+                {
+                    vertex.Position = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+                    vertex.Normal = glm::normalize(normalMatrix * vertex.Normal);
+                    vertex.Tangent = linear * vertex.Tangent;
+                    vertex.Bitangent = linear * vertex.Bitangent;
+                }
+                vertices[i] = vertex;
+            }
+        });
+        // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        if(mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        {
+            // triangles only: every face has three indices, so each face's slot is known up front
+            indices.resize(static_cast<std::size_t>(mesh->mNumFaces) * 3);
+            jobs.ParallelFor(0, mesh->mNumFaces, 8192, [mesh, &indices](std::size_t begin, std::size_t end) {
+                for(std::size_t i = begin; i < end; i++)
+                {
+                    const aiFace &face = mesh->mFaces[i];
+                    for(unsigned int j = 0; j < 3; j++)
+                        indices[i * 3 + j] = face.mIndices[j];
+                }
+            });
+            return;
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // mixed primitives (points and lines survive triangulation), faces vary in size
+        indices.reserve(static_cast<std::size_t>(mesh->mNumFaces) * 3);
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace &face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);        
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
+    }
 
+    // the node hierarchy as joints (parents first, the node transforms as bind pose), the bones
+    // of every mesh once per name and the scene's animations. Null if no mesh has bones;
+    // boneIds receives the bone index of every bone name.
+    static shared_ptr<Skeleton> importSkeleton(const aiScene *scene, map<string, unsigned int> &boneIds)
+    {
+        bool skinned = false;
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++)
+            skinned = skinned || scene->mMeshes[i]->HasBones();
+        if(!skinned)
+            return nullptr;
+
+        shared_ptr<Skeleton> skeleton = make_shared<Skeleton>();
+        map<string, unsigned int> joints;
+        addJoint(scene->mRootNode, -1, *skeleton, joints);
+        skeleton->bindPose.name = "bind pose";
+
+        for(unsigned int i = 0; i < scene->mNumMeshes; i++)
+        {
+            const aiMesh *mesh = scene->mMeshes[i];
+            for(unsigned int j = 0; j < mesh->mNumBones; j++)
+            {
+                string name = mesh->mBones[j]->mName.C_Str();
+                if(boneIds.count(name))
+                    continue;
+                map<string, unsigned int>::const_iterator joint = joints.find(name);
+                if(joint == joints.end())
+                {
+                    cout << "WARNING::ASSIMP:: bone " << name << " has no node, its weights are dropped" << endl;
+                    continue;
+                }
+                boneIds[name] = static_cast<unsigned int>(skeleton->boneJoints.size());
+                skeleton->boneJoints.push_back(joint->second);
+                skeleton->boneOffsets.push_back(toGlm(mesh->mBones[j]->mOffsetMatrix));
+            }
+        }
+
+        for(unsigned int i = 0; i < scene->mNumAnimations; i++)
+        {
+            const aiAnimation *animation = scene->mAnimations[i];
+            AnimationClip clip;
+            clip.name = animation->mName.C_Str();
+            clip.duration = static_cast<float>(animation->mDuration);
+            if(animation->mTicksPerSecond > 0.0)
+                clip.ticksPerSecond = static_cast<float>(animation->mTicksPerSecond);
+            // joints without a channel hold their bind pose
+            clip.tracks = skeleton->bindPose.tracks;
+            for(unsigned int j = 0; j < animation->mNumChannels; j++)
+            {
+                const aiNodeAnim *channel = animation->mChannels[j];
+                map<string, unsigned int>::const_iterator joint = joints.find(channel->mNodeName.C_Str());
+                if(joint != joints.end())
+                    convertChannel(channel, clip.tracks[joint->second]);
+            }
+            skeleton->animations.push_back(std::move(clip));
+        }
+        return skeleton;
+    }
+
+    // appends node and (after it) its children to the skeleton's joints
+    static void addJoint(const aiNode *node, int parent, Skeleton &skeleton, map<string, unsigned int> &joints)
+    {
+        unsigned int joint = static_cast<unsigned int>(skeleton.parents.size());
+        skeleton.jointNames.push_back(node->mName.C_Str());
+        skeleton.parents.push_back(parent);
+        skeleton.bindPose.tracks.push_back(JointTrack::FromMatrix(toGlm(node->mTransformation)));
+        joints.insert(make_pair(string(node->mName.C_Str()), joint));
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+            addJoint(node->mChildren[i], static_cast<int>(joint), skeleton, joints);
+    }
+
+    // replaces the channels of track the animation has keys for
+    static void convertChannel(const aiNodeAnim *channel, JointTrack &track)
+    {
+        if(channel->mNumPositionKeys > 0)
+        {
+            track.positionTimes.clear();
+            track.positions.clear();
+            for(unsigned int i = 0; i < channel->mNumPositionKeys; i++)
+            {
+                const aiVectorKey &key = channel->mPositionKeys[i];
+                track.positionTimes.push_back(static_cast<float>(key.mTime));
+                track.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+        }
+        if(channel->mNumRotationKeys > 0)
+        {
+            track.rotationTimes.clear();
+            track.rotations.clear();
+            for(unsigned int i = 0; i < channel->mNumRotationKeys; i++)
+            {
+                const aiQuatKey &key = channel->mRotationKeys[i];
+                track.rotationTimes.push_back(static_cast<float>(key.mTime));
+                track.rotations.push_back(glm::vec4(key.mValue.x, key.mValue.y, key.mValue.z, key.mValue.w));
+            }
+        }
+        if(channel->mNumScalingKeys > 0)
+        {
+            track.scaleTimes.clear();
+            track.scales.clear();
+            for(unsigned int i = 0; i < channel->mNumScalingKeys; i++)
+            {
+                const aiVectorKey &key = channel->mScalingKeys[i];
+                track.scaleTimes.push_back(static_cast<float>(key.mTime));
+                track.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+        }
+    }
+
+    // fills the bone ids and weights of a skinned mesh's vertices: the MAX_BONE_INFLUENCE
+    // heaviest bones of each vertex, weights normalized to sum to 1
+    static void assignBoneWeights(const aiMesh *mesh, const map<string, unsigned int> &boneIds, vector<Vertex> &vertices)
+    {
+        for(unsigned int i = 0; i < mesh->mNumBones; i++)
+        {
+            const aiBone *bone = mesh->mBones[i];
+            map<string, unsigned int>::const_iterator id = boneIds.find(bone->mName.C_Str());
+            if(id == boneIds.end())
+                continue;
+            for(unsigned int j = 0; j < bone->mNumWeights; j++)
+            {
+                const aiVertexWeight &weight = bone->mWeights[j];
+                if(weight.mVertexId >= vertices.size())
+                    continue;
+                Vertex &vertex = vertices[weight.mVertexId];
+                // take the slot of the lightest influence so far if this one is heavier
+                int lightest = 0;
+                for(int k = 1; k < MAX_BONE_INFLUENCE; k++)
+                    if(vertex.m_Weights[k] < vertex.m_Weights[lightest])
+                        lightest = k;
+                if(weight.mWeight > vertex.m_Weights[lightest])
+                {
+                    vertex.m_BoneIDs[lightest] = static_cast<int>(id->second);
+                    vertex.m_Weights[lightest] = weight.mWeight;
+                }
+            }
+        }
+        for(Vertex &vertex : vertices)
+        {
+            float total = 0.0f;
+            for(int k = 0; k < MAX_BONE_INFLUENCE; k++)
+                total += vertex.m_Weights[k];
+            if(total > 0.0f)
+                for(int k = 0; k < MAX_BONE_INFLUENCE; k++)
+                    vertex.m_Weights[k] /= total;
+        }
+    }
+
+    // returns the material binding exactly these textures, creating it on first use
+    shared_ptr<Material> findOrCreateMaterial(const vector<Texture> &textures)
+    {
+        shared_ptr<Material> material = make_shared<Material>();
+        for(const Texture &texture : textures)
+            material->AddTexture(texture.role, texture.id);
+
+        for(const shared_ptr<Material> &loaded : materials_loaded)
+        {
+            if(loaded->SameTextures(*material))
+                return loaded;
+        }
+        materials_loaded.push_back(material);
+        return material;
+    }
+
+    // records the textures of a mesh's material, adding paths not seen before to data.textures.
+    // We assume a convention for sampler names in the shaders. Each diffuse texture should be named
+    // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
+    // Same applies to other texture as the following list summarizes:
+    // diffuse: texture_diffuseN
+    // specular: texture_specularN
+    // normal: texture_normalN
+    static void collectTextures(aiMaterial *material, ModelData &data, ImportedMesh &mesh, bool gamma)
+    {
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        collectTextures(material, aiTextureType_DIFFUSE, TextureRole::DIFFUSE, data, mesh, gamma);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        collectTextures(material, aiTextureType_SPECULAR, TextureRole::SPECULAR, data, mesh, false);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        collectTextures(material, aiTextureType_HEIGHT, TextureRole::NORMAL, data, mesh, false);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        collectTextures(material, aiTextureType_AMBIENT, TextureRole::HEIGHT, data, mesh, false);
         // 5. emissive maps
-        std::vector<Texture> emissiveMaps = loadMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emissive");
-        textures.insert(textures.end(), emissiveMaps.begin(), emissiveMaps.end());
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        collectTextures(material, aiTextureType_EMISSIVE, TextureRole::EMISSIVE, data, mesh, false);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // checks all material textures of a given type and adds the ones not referenced yet.
+    static void collectTextures(aiMaterial *mat, aiTextureType type, TextureRole role, ModelData &data, ImportedMesh &mesh, bool gamma)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                if (typeName == "texture_diffuse") {
-                    texture.id = TextureFromFile(str.C_Str(), this->directory, gammaCorrection);
-                } else {
-                    texture.id = TextureFromFile(str.C_Str(), this->directory, false);
-                }
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-
-                // DEBUG texture path 
-                // cout << "Loaded Texture Path: " << texture.path << endl;
-            }
+            // textures referenced before are reused: skip loading a new texture
+            unsigned int index = data.TextureIndex(str.C_Str(), role, gamma);
+            mesh.textures.push_back(make_pair(index, role));
         }
-        return textures;
     }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, TextureRole role)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    if (!data)
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return TextureFromData(nullptr, 0, 0, 0);
+    }
+    // mip levels are filtered on the job system instead of glGenerateMipmap, per role like
+    // imported textures
+    MipChain chain = BuildMipChain(data, width, height, nrComponents, MipOptionsFor(role));
+    stbi_image_free(data);
+    vector<size_t> levelOffsets(chain.offsets.begin() + 1, chain.offsets.end());
+
+    return TextureFromLevels(chain.data.get(), levelOffsets, width, height, nrComponents, gamma);
+}
+
+// creates a mipmapped texture from decoded pixels; without data only the name is generated
+unsigned int TextureFromData(const unsigned char *data, int width, int height, int nrComponents, bool gamma)
+{
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
     {
         GLenum format;
@@ -254,13 +797,107 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    return textureID;
+}
+
+// like TextureFromData, with the mip chain supplied instead of generated: level N starts at
+// data + levelOffsets[N - 1], tightly packed rows. The chain goes through the shared
+// TextureUploader ring, so the call doesn't wait for the driver to copy it.
+unsigned int TextureFromLevels(const unsigned char *data, const vector<size_t> &levelOffsets, int width, int height, int nrComponents, bool gamma)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (data)
+    {
+        GLenum internalFormat, format;
+        TextureFormats(BlockFormat::NONE, nrComponents, gamma, internalFormat, format);
+
+        // allocate every level before the ring is bound, then fill them from it
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        size_t size = 0;
+        for (size_t level = 0; level <= levelOffsets.size(); level++)
+        {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            size = (level == 0 ? 0 : levelOffsets[level - 1]) + static_cast<size_t>(levelWidth) * levelHeight * nrComponents;
+        }
+
+        TextureUploader &uploader = TextureUploader::Shared();
+        TextureUploader::Staging staging = uploader.Stage(data, size);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level <= levelOffsets.size(); level++)
+        {
+            size_t offset = level == 0 ? 0 : levelOffsets[level - 1];
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, std::max(width >> level, 1), std::max(height >> level, 1),
+                    format, GL_UNSIGNED_BYTE, staging.Pointer(offset));
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        uploader.Submit(staging);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelOffsets.size()));
 
-        stbi_image_free(data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
-    else
+
+    return textureID;
+}
+
+// uploads a block compressed mip chain (see TextureCache), level N starts at
+// data + levelOffsets[N - 1]. Single channel (BC4) maps read as grey and normal maps (BC5)
+// as (x, y, 1), so shaders sampling .rgb see what they saw uncompressed.
+unsigned int TextureFromCompressed(const unsigned char *data, const vector<size_t> &levelOffsets, BlockFormat format, int width, int height, bool gamma)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (data)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        GLenum internalFormat, pixelFormat;
+        TextureFormats(format, 4, gamma, internalFormat, pixelFormat);
+
+        // as in TextureFromLevels: allocate, then fill every level from the upload ring
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        size_t size = 0;
+        for (size_t level = 0; level <= levelOffsets.size(); level++)
+        {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            GLsizei levelSize = static_cast<GLsizei>(CompressedLevelSize(format, levelWidth, levelHeight));
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), internalFormat, levelWidth, levelHeight, 0, levelSize, nullptr);
+            size = (level == 0 ? 0 : levelOffsets[level - 1]) + levelSize;
+        }
+
+        TextureUploader &uploader = TextureUploader::Shared();
+        TextureUploader::Staging staging = uploader.Stage(data, size);
+        for (size_t level = 0; level <= levelOffsets.size(); level++)
+        {
+            int levelWidth = std::max(width >> level, 1);
+            int levelHeight = std::max(height >> level, 1);
+            size_t offset = level == 0 ? 0 : levelOffsets[level - 1];
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levelWidth, levelHeight, internalFormat,
+                    static_cast<GLsizei>(CompressedLevelSize(format, levelWidth, levelHeight)), staging.Pointer(offset));
+        }
+        uploader.Submit(staging);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelOffsets.size()));
+
+        if (format == BlockFormat::BC4)
+        {
+            GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+        else if (format == BlockFormat::BC5)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
     return textureID;
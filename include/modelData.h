@@ -0,0 +1,135 @@
+#ifndef MODEL_DATA_H
+#define MODEL_DATA_H
+
+#include "stb_image.h"
+
+#include "glm/glm.hpp"
+
+#include "mesh.h"
+#include "bounds.h"
+#include "skeleton.h"
+#include "material.h"
+#include "jobSystem.h"
+#include "textureCache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// a texture referenced by an imported model, decoded without touching GL
+struct ImportedTexture {
+    string path;                // as written in the model's material, relative to its directory
+    TextureRole role;           // role of the first mesh referencing it
+    bool gamma = false;
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0;
+    // stbi_load result (or a view into an asset pack, see KeepData), empty if decoding
+    // failed or once uploaded
+    unique_ptr<unsigned char, void(*)(void*)> data{nullptr, stbi_image_free};
+    // offsets into data of pre-generated mip levels 1..N, empty to generate them on the GPU
+    vector<size_t> levelOffsets;
+    // block compression of data (and its levels), NONE for raw pixels
+    BlockFormat format = BlockFormat::NONE;
+
+    // bytes uploaded for this texture, mip levels included
+    size_t Bytes() const
+    {
+        size_t bytes = 0;
+        for (size_t level = 0; level <= levelOffsets.size(); level++) {
+            int levelWidth = std::max(width >> level, 1), levelHeight = std::max(height >> level, 1);
+            bytes += format != BlockFormat::NONE ? CompressedLevelSize(format, levelWidth, levelHeight)
+                                                 : static_cast<size_t>(levelWidth) * levelHeight * nrComponents;
+        }
+        return bytes;
+    }
+
+    // deleter for pixels owned by someone else
+    static void KeepData(void*) {}
+};
+
+// one mesh converted to our vertex layout
+struct ImportedMesh {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    // index into ModelData::textures and the role it is bound as, in material order
+    vector<pair<unsigned int, TextureRole>> textures;
+    Bounds bounds;
+};
+
+// everything read from a model file before any GL object exists. Model::Import fills it on
+// any thread, Model::AddTexture/AddMesh turn it into GL objects on the context thread.
+struct ModelData {
+    string directory;
+    vector<ImportedMesh> meshes;
+    vector<ImportedTexture> textures;
+    // bounds of all vertices, merged from the meshes' bounds
+    Bounds bounds;
+    // joints, bones and animations of a skinned model, null for static models
+    shared_ptr<const Skeleton> skeleton;
+    bool valid = false;
+
+    // index of the texture with this path, added (not decoded yet) on first reference
+    unsigned int TextureIndex(const string &path, TextureRole role, bool gamma)
+    {
+        for (unsigned int i = 0; i < textures.size(); i++)
+            if (textures[i].path == path)
+                return i;
+        textures.emplace_back();
+        textures.back().path = path;
+        textures.back().role = role;
+        textures.back().gamma = gamma;
+        return static_cast<unsigned int>(textures.size() - 1);
+    }
+
+    // decode every referenced image once and build its mip chain, in parallel, so the GL
+    // thread only copies finished levels. With texture compression enabled the block
+    // compressed mip chain comes from the TextureCache instead.
+    void DecodeTextures(JobSystem &jobs)
+    {
+        jobs.ParallelFor(0, textures.size(), 1, [this, &jobs](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                ImportedTexture &texture = textures[i];
+                string filename = directory + '/' + texture.path;
+                CompressedTexture compressed;
+                if (TextureCache::Settings().enabled && TextureCache::Load(filename, texture.role, compressed, jobs)) {
+                    texture.width = compressed.width;
+                    texture.height = compressed.height;
+                    texture.nrComponents = compressed.nrComponents;
+                    texture.format = compressed.format;
+                    texture.levelOffsets = std::move(compressed.levelOffsets);
+                    texture.data = std::move(compressed.data);
+                    continue;
+                }
+                unsigned char *pixels = stbi_load(filename.c_str(), &texture.width, &texture.height, &texture.nrComponents, 0);
+                if (!pixels) {
+                    std::cout << "Texture failed to load at path: " << texture.path << std::endl;
+                    continue;
+                }
+                MipChain chain = BuildMipChain(pixels, texture.width, texture.height, texture.nrComponents, MipOptionsFor(texture.role), jobs);
+                stbi_image_free(pixels);
+                texture.levelOffsets.assign(chain.offsets.begin() + 1, chain.offsets.end());
+                texture.data = std::move(chain.data);
+            }
+        });
+    }
+
+    // bounds of every mesh (in parallel), then of the whole model
+    void ComputeBounds(JobSystem &jobs)
+    {
+        jobs.ParallelFor(0, meshes.size(), 1, [this](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                meshes[i].bounds = meshes[i].vertices.empty() ? Bounds()
+                        : Bounds::FromPoints(&meshes[i].vertices[0].Position, meshes[i].vertices.size(), sizeof(Vertex));
+        });
+        bounds = Bounds();
+        for (const ImportedMesh &mesh : meshes)
+            bounds.Merge(mesh.bounds);
+    }
+};
+#endif
@@ -0,0 +1,97 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include "model.h"
+#include "jobSystem.h"
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+// a model file to load and where its geometry goes
+struct ModelRequest {
+    std::string path;
+    bool gamma = false;
+    MeshArena *arena = &MeshArena::Shared();
+    // what the model keeps of its geometry in CPU memory
+    CpuGeometry keepGeometry = CpuGeometry::FULL;
+};
+
+// wall time of the last LoadModels call
+struct ModelLoadStats {
+    double importMs = 0.0;      // all files parsed, converted and decoded
+    double uploadMs = 0.0;      // all textures and geometry created on the GL thread
+    unsigned int threads = 0;   // workers plus the calling thread
+};
+
+// imports every file on its own job (each with its own Assimp::Importer) while meshes and
+// textures inside a file are converted in parallel too. Needs no GL context.
+inline std::vector<ModelData> ImportModels(const std::vector<ModelRequest> &requests, JobSystem &jobs = JobSystem::Global())
+{
+    std::vector<ModelData> imported(requests.size());
+    jobs.ParallelFor(0, requests.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+            imported[i] = Model::Import(requests[i].path, requests[i].gamma, jobs);
+    });
+    return imported;
+}
+
+// Loads several models at once. All files are imported concurrently first, then the GL
+// objects are created on the calling (context) thread in one pass: every texture, then the
+// geometry of each arena staged and uploaded with a single buffer update per arena.
+// Models come back in request order; failed imports give empty models.
+inline std::vector<Model> LoadModels(const std::vector<ModelRequest> &requests, ModelLoadStats *stats = nullptr,
+        JobSystem &jobs = JobSystem::Global())
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::vector<ModelData> imported = ImportModels(requests, jobs);
+    std::chrono::high_resolution_clock::time_point importEnd = std::chrono::high_resolution_clock::now();
+
+    // one batch per arena, sized to everything going into it
+    std::set<MeshArena*> arenas;
+    for (std::size_t i = 0; i < requests.size(); i++) {
+        if (arenas.insert(requests[i].arena).second) {
+            std::size_t vertices = 0, indices = 0;
+            for (std::size_t j = i; j < requests.size(); j++) {
+                if (requests[j].arena != requests[i].arena)
+                    continue;
+                for (const ImportedMesh &mesh : imported[j].meshes) {
+                    vertices += mesh.vertices.size();
+                    indices += mesh.indices.size();
+                }
+            }
+            requests[i].arena->BeginBatch(vertices, indices);
+        }
+    }
+
+    std::vector<Model> models;
+    models.reserve(requests.size());
+    for (std::size_t i = 0; i < requests.size(); i++) {
+        models.emplace_back(requests[i].arena, requests[i].gamma, requests[i].keepGeometry);
+        Model &model = models.back();
+        ModelData &data = imported[i];
+        if (!data.valid)
+            continue;
+        model.directory = data.directory;
+        model.skeleton = data.skeleton;
+        model.ReserveGeometry(data);
+        for (ImportedTexture &texture : data.textures)
+            model.AddTexture(texture);
+        for (ImportedMesh &mesh : data.meshes)
+            model.AddMesh(mesh);
+        model.FinishLoading();
+    }
+
+    for (MeshArena *arena : arenas)
+        arena->EndBatch();
+
+    if (stats) {
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        stats->importMs = std::chrono::duration<double, std::milli>(importEnd - start).count();
+        stats->uploadMs = std::chrono::duration<double, std::milli>(end - importEnd).count();
+        stats->threads = jobs.WorkerCount() + 1;
+    }
+    return models;
+}
+#endif
@@ -0,0 +1,189 @@
+#ifndef MODEL_STREAMER_H
+#define MODEL_STREAMER_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "model.h"
+#include "jobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared state of one streamed model request.
+struct ModelStream {
+    enum Status {
+        IMPORTING,      // queued or being parsed/decoded on a worker
+        UPLOADING,      // imported, textures and meshes are being uploaded by Update
+        READY,
+        FAILED
+    };
+
+    std::string path;
+    std::atomic<int> status{IMPORTING};
+    ModelData data;
+    std::unique_ptr<Model> model;
+    std::function<void(Model&)> onReady;
+    // upload progress, next texture / mesh of data to add
+    bool started = false;
+    std::size_t nextTexture = 0;
+    std::size_t nextMesh = 0;
+};
+
+// Handle to a model requested from a ModelStreamer. Returns immediately; until the model
+// is ready, callers draw a placeholder from its bounding box (available once imported).
+class ModelHandle
+{
+public:
+    bool Ready() const { return stream && stream->status.load(std::memory_order_acquire) == ModelStream::READY; }
+    bool Failed() const { return !stream || stream->status.load(std::memory_order_acquire) == ModelStream::FAILED; }
+    // true once the bounds are known, i.e. the file has been imported
+    bool HasBounds() const { return stream && stream->status.load(std::memory_order_acquire) >= ModelStream::UPLOADING && !Failed(); }
+
+    // the loaded model, nullptr until Ready
+    Model* Get() const { return Ready() ? stream->model.get() : nullptr; }
+
+    // maps the unit cube [-1, 1] onto the model's bounding box, for drawing a placeholder
+    glm::mat4 PlaceholderTransform() const
+    {
+        if (!HasBounds())
+            return glm::scale(glm::mat4(1.0f), glm::vec3(0.0f));
+        glm::vec3 center = stream->data.bounds.BoxCenter();
+        glm::vec3 extent = stream->data.bounds.Size() * 0.5f;
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), center);
+        return glm::scale(transform, extent);
+    }
+
+private:
+    friend class ModelStreamer;
+    std::shared_ptr<ModelStream> stream;
+};
+
+// Loads models in the background. Importing (Assimp parsing, vertex conversion and image
+// decoding) runs on the job system; GL uploads happen in Update, called once per frame on
+// the GL thread, and stop for the frame once the milliseconds or bytes budget is used up.
+// Uploads are split per texture and per mesh, so one item may overshoot the budget, but
+// at least one item goes up every frame.
+class ModelStreamer
+{
+public:
+    // per frame upload budget
+    float BudgetMs = 2.0f;
+    std::size_t BudgetBytes = 16 << 20;
+    // what models requested from now on keep of their geometry in CPU memory
+    CpuGeometry KeepGeometry = CpuGeometry::FULL;
+
+    // uploaded by the last Update
+    std::size_t UploadedBytes = 0;
+    unsigned int UploadedItems = 0;
+
+    ModelStreamer(JobSystem &jobs = JobSystem::Global()) : jobs(jobs)
+    {
+    }
+
+    // imports still running reference this streamer's job group
+    ~ModelStreamer()
+    {
+        jobs.Wait(importing);
+    }
+
+    // start loading a model; onReady runs on the GL thread (inside Update) once it's usable
+    ModelHandle Request(const std::string &path, bool gamma = false, MeshArena *arena = &MeshArena::Shared(),
+            std::function<void(Model&)> onReady = nullptr)
+    {
+        std::shared_ptr<ModelStream> stream = std::make_shared<ModelStream>();
+        stream->path = path;
+        stream->model.reset(new Model(arena, gamma, KeepGeometry));
+        stream->onReady = onReady;
+        streams.push_back(stream);
+
+        jobs.Run(importing, [stream, path, gamma]() {
+            stream->data = Model::Import(path, gamma);
+            stream->status.store(stream->data.valid ? ModelStream::UPLOADING : ModelStream::FAILED, std::memory_order_release);
+        });
+
+        ModelHandle handle;
+        handle.stream = stream;
+        return handle;
+    }
+
+    // upload imported data within the budget and finish models; call once per frame
+    void Update()
+    {
+        UploadedBytes = 0;
+        UploadedItems = 0;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+        for (std::size_t i = 0; i < streams.size(); ) {
+            ModelStream &stream = *streams[i];
+            int status = stream.status.load(std::memory_order_acquire);
+            if (status == ModelStream::UPLOADING)
+                upload(stream, start);
+
+            status = stream.status.load(std::memory_order_acquire);
+            if (status == ModelStream::FAILED)
+                std::cout << "ERROR::MODEL_STREAMER:: failed to load " << stream.path << std::endl;
+            if (status == ModelStream::READY || status == ModelStream::FAILED)
+                streams.erase(streams.begin() + i);
+            else
+                i++;
+            if (overBudget(start))
+                break;
+        }
+    }
+
+    // number of requests not ready yet
+    unsigned int Pending() const { return static_cast<unsigned int>(streams.size()); }
+
+private:
+    JobSystem &jobs;
+    JobGroup importing;
+    std::vector<std::shared_ptr<ModelStream>> streams;
+
+    bool overBudget(std::chrono::high_resolution_clock::time_point start) const
+    {
+        if (UploadedItems == 0)
+            return false;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return ms >= BudgetMs || UploadedBytes >= BudgetBytes;
+    }
+
+    // textures first (meshes reference them by index), then meshes
+    void upload(ModelStream &stream, std::chrono::high_resolution_clock::time_point start)
+    {
+        Model &model = *stream.model;
+        if (!stream.started) {
+            model.directory = stream.data.directory;
+            model.skeleton = stream.data.skeleton;
+            model.ReserveGeometry(stream.data);
+            stream.started = true;
+        }
+        while (!overBudget(start)) {
+            if (stream.nextTexture < stream.data.textures.size()) {
+                ImportedTexture &texture = stream.data.textures[stream.nextTexture++];
+                UploadedBytes += texture.Bytes();
+                model.AddTexture(texture);
+            } else if (stream.nextMesh < stream.data.meshes.size()) {
+                ImportedMesh &mesh = stream.data.meshes[stream.nextMesh++];
+                UploadedBytes += mesh.vertices.size() * sizeof(Vertex) + mesh.indices.size() * sizeof(unsigned int);
+                model.AddMesh(mesh);
+            } else {
+                model.FinishLoading();
+                stream.status.store(ModelStream::READY, std::memory_order_release);
+                if (stream.onReady)
+                    stream.onReady(model);
+                return;
+            }
+            UploadedItems++;
+        }
+    }
+};
+#endif
@@ -0,0 +1,619 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "glm/glm.hpp"
+
+#include "mesh.h"
+#include "material.h"
+#include "modelData.h"
+#include "mappedFile.h"
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Dedicated Wavefront OBJ/MTL importer producing the same ModelData as the ASSIMP path
+// (triangulated, smooth normals when the file has none, flipped UVs, tangent space).
+// The file is memory-mapped and split into line-aligned chunks parsed in parallel; each
+// material becomes one mesh whose corners are welded into unique vertices. Anything it
+// doesn't understand makes Import return false so the caller can fall back to ASSIMP.
+class ObjImporter
+{
+public:
+    // true for paths ending in .obj (any case)
+    static bool IsObj(const std::string &path)
+    {
+        if (path.size() < 4)
+            return false;
+        std::string extension = path.substr(path.size() - 4);
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".obj";
+    }
+
+    // geometry and texture references (not decoded) of an .obj file
+    static bool Import(const std::string &path, ModelData &data, bool gamma, JobSystem &jobs)
+    {
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::cout << "ERROR::OBJ:: failed to open " << path << std::endl;
+            return false;
+        }
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        // 1. parse line-aligned chunks in parallel
+        std::vector<Chunk> chunks(chunkCount(file.Size(), jobs));
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            chunks[i].begin = file.Data() + alignToLine(file.Data(), file.Size(), file.Size() * i / chunks.size());
+            chunks[i].end = file.Data() + file.Size();
+            if (i > 0)
+                chunks[i - 1].end = chunks[i].begin;
+        }
+        jobs.ParallelFor(0, chunks.size(), 1, [&chunks](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                parseChunk(chunks[i]);
+        });
+
+        // 2. merge attribute arrays and make every index global
+        Attributes attributes;
+        if (!merge(chunks, attributes, jobs)) {
+            std::cout << "ERROR::OBJ:: malformed face or index out of range in " << path << std::endl;
+            return false;
+        }
+
+        // 3. materials, one mesh per material in order of first use
+        std::vector<std::string> materialNames;
+        assignMaterials(chunks, materialNames);
+        std::map<std::string, MtlMaterial> library;
+        for (const Chunk &chunk : chunks)
+            for (const std::string &mtllib : chunk.mtllibs)
+                parseMtl(data.directory + '/' + mtllib, library);
+
+        // 4. weld corners into vertices and build tangent space, one mesh per job; faces and
+        //    indices were validated by merge, this can't fail
+        std::vector<ImportedMesh> meshes(materialNames.size());
+        jobs.ParallelFor(0, meshes.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++)
+                buildMesh(chunks, attributes, static_cast<int>(i), meshes[i]);
+        });
+
+        for (std::size_t i = 0; i < meshes.size(); i++) {
+            if (meshes[i].indices.empty())
+                continue;
+            std::map<std::string, MtlMaterial>::const_iterator material = library.find(materialNames[i]);
+            if (material != library.end())
+                addTextures(material->second, data, meshes[i], gamma);
+            data.meshes.push_back(std::move(meshes[i]));
+        }
+        return !data.meshes.empty();
+    }
+
+private:
+    // a face corner with 0 based indices. Negative OBJ indices are stored relative to the
+    // start of the chunk (flagged in relative) and made global by merge.
+    struct Corner {
+        int position;
+        int texCoord;
+        int normal;
+        unsigned char relative;
+    };
+
+    enum : unsigned char { RELATIVE_POSITION = 1, RELATIVE_TEXCOORD = 2, RELATIVE_NORMAL = 4 };
+
+    static const int MISSING = INT_MIN;
+
+    struct Face {
+        unsigned int firstCorner;
+        unsigned int cornerCount;
+        int material;   // index into the material names, set by assignMaterials
+    };
+
+    struct MaterialSwitch {
+        std::size_t face;   // first face using the material
+        std::string name;
+    };
+
+    struct Chunk {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texCoords;
+        std::vector<Corner> corners;
+        std::vector<Face> faces;
+        std::vector<MaterialSwitch> switches;
+        std::vector<std::string> mtllibs;
+        bool malformed = false;
+    };
+
+    struct Attributes {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> texCoords;
+    };
+
+    // texture file per role, empty if the material has none
+    struct MtlMaterial {
+        std::string maps[TEXTURE_ROLE_COUNT];
+    };
+
+    struct CornerHash {
+        std::size_t operator()(const Corner &corner) const
+        {
+            std::uint64_t h = static_cast<std::uint32_t>(corner.position);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(corner.texCoord);
+            h = h * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint32_t>(corner.normal);
+            return static_cast<std::size_t>(h ^ (h >> 29));
+        }
+    };
+
+    struct CornerEqual {
+        bool operator()(const Corner &a, const Corner &b) const
+        {
+            return a.position == b.position && a.texCoord == b.texCoord && a.normal == b.normal;
+        }
+    };
+
+    // about 1MB per chunk, a few chunks per thread at most
+    static std::size_t chunkCount(std::size_t size, JobSystem &jobs)
+    {
+        std::size_t bySize = size / (1 << 20) + 1;
+        return std::min<std::size_t>(bySize, (jobs.WorkerCount() + 1) * 4);
+    }
+
+    static std::size_t alignToLine(const char *data, std::size_t size, std::size_t offset)
+    {
+        if (offset == 0 || offset >= size)
+            return std::min(offset, size);
+        const char *lineEnd = findLineEnd(data + offset - 1, data + size);
+        return lineEnd == data + size ? size : static_cast<std::size_t>(lineEnd - data) + 1;
+    }
+
+    // first '\n' in [p, end), 16 bytes at a time where SSE2 is available
+    static const char* findLineEnd(const char *p, const char *end)
+    {
+#if defined(__SSE2__)
+        const __m128i newline = _mm_set1_epi8('\n');
+        while (end - p >= 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+            if (mask != 0)
+                return p + __builtin_ctz(static_cast<unsigned int>(mask));
+            p += 16;
+        }
+#endif
+        const void *found = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+        return found ? static_cast<const char*>(found) : end;
+    }
+
+    static const char* skipSpaces(const char *p, const char *end)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        return p;
+    }
+
+    // true if the line starts with the keyword followed by whitespace
+    static bool keyword(const char *p, const char *end, const char *word, std::size_t length)
+    {
+        return static_cast<std::size_t>(end - p) > length && std::memcmp(p, word, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+    }
+
+    static const char* parseInt(const char *p, const char *end, int &value, bool &ok)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+        const char *start = p;
+        long long result = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            result = result * 10 + (*p++ - '0');
+        ok = p != start && result <= INT_MAX;
+        value = static_cast<int>(negative ? -result : result);
+        return p;
+    }
+
+    // decimal float with optional fraction and exponent, as written by exporters
+    static const char* parseFloat(const char *p, const char *end, float &value)
+    {
+        static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        p = skipSpaces(p, end);
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        std::uint64_t mantissa = 0;
+        int exponent = 0;
+        int digits = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits++ < 19)
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            else
+                exponent++;
+        }
+        if (p < end && *p == '.') {
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+                if (digits++ < 19) {
+                    mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                    exponent--;
+                }
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            int power = 0;
+            bool ok;
+            p = parseInt(p + 1, end, power, ok);
+            exponent += power;
+        }
+
+        double result = static_cast<double>(mantissa);
+        if (exponent < 0)
+            result = exponent >= -22 ? result / powers[-exponent] : result * std::pow(10.0, exponent);
+        else if (exponent > 0)
+            result = exponent <= 22 ? result * powers[exponent] : result * std::pow(10.0, exponent);
+        value = static_cast<float>(negative ? -result : result);
+        return p;
+    }
+
+    // OBJ indices are 1 based or negative (relative to the attributes read so far, which
+    // from inside a chunk is only known relative to the chunk's own attributes)
+    static int resolveIndex(int index, std::size_t localCount, unsigned char flag, unsigned char &relative, bool &ok)
+    {
+        if (index > 0)
+            return index - 1;
+        if (index < 0) {
+            relative |= flag;
+            return static_cast<int>(localCount) + index;
+        }
+        ok = false;
+        return MISSING;
+    }
+
+    static void parseFace(const char *p, const char *end, Chunk &chunk)
+    {
+        Face face;
+        face.firstCorner = static_cast<unsigned int>(chunk.corners.size());
+        face.cornerCount = 0;
+        face.material = 0;
+        bool ok = true;
+        while ((p = skipSpaces(p, end)) < end && ok) {
+            Corner corner = { MISSING, MISSING, MISSING, 0 };
+            int index;
+            p = parseInt(p, end, index, ok);
+            if (!ok)
+                break;
+            corner.position = resolveIndex(index, chunk.positions.size(), RELATIVE_POSITION, corner.relative, ok);
+            if (p < end && *p == '/') {
+                p++;
+                if (p < end && *p != '/') {
+                    p = parseInt(p, end, index, ok);
+                    corner.texCoord = ok ? resolveIndex(index, chunk.texCoords.size(), RELATIVE_TEXCOORD, corner.relative, ok) : MISSING;
+                }
+                if (p < end && *p == '/') {
+                    p = parseInt(p + 1, end, index, ok);
+                    corner.normal = ok ? resolveIndex(index, chunk.normals.size(), RELATIVE_NORMAL, corner.relative, ok) : MISSING;
+                }
+            }
+            chunk.corners.push_back(corner);
+            face.cornerCount++;
+        }
+        if (!ok || face.cornerCount < 3) {
+            // points and lines are skipped like triangulation would, broken faces fail the import
+            if (!ok)
+                chunk.malformed = true;
+            chunk.corners.resize(face.firstCorner);
+            return;
+        }
+        chunk.faces.push_back(face);
+    }
+
+    static std::string restOfLine(const char *p, const char *end)
+    {
+        p = skipSpaces(p, end);
+        while (end > p && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+            end--;
+        return std::string(p, end);
+    }
+
+    static void parseChunk(Chunk &chunk)
+    {
+        const char *p = chunk.begin;
+        while (p < chunk.end) {
+            const char *lineEnd = findLineEnd(p, chunk.end);
+            const char *line = skipSpaces(p, lineEnd);
+            const char *end = lineEnd;
+            if (end > line && end[-1] == '\r')
+                end--;
+
+            if (line < end) {
+                if (keyword(line, end, "v", 1)) {
+                    glm::vec3 position;
+                    const char *q = parseFloat(line + 2, end, position.x);
+                    q = parseFloat(q, end, position.y);
+                    parseFloat(q, end, position.z);
+                    chunk.positions.push_back(position);
+                } else if (keyword(line, end, "vt", 2)) {
+                    glm::vec2 texCoord;
+                    const char *q = parseFloat(line + 3, end, texCoord.x);
+                    parseFloat(q, end, texCoord.y);
+                    chunk.texCoords.push_back(texCoord);
+                } else if (keyword(line, end, "vn", 2)) {
+                    glm::vec3 normal;
+                    const char *q = parseFloat(line + 3, end, normal.x);
+                    q = parseFloat(q, end, normal.y);
+                    parseFloat(q, end, normal.z);
+                    chunk.normals.push_back(normal);
+                } else if (keyword(line, end, "f", 1)) {
+                    parseFace(line + 2, end, chunk);
+                } else if (keyword(line, end, "usemtl", 6)) {
+                    chunk.switches.push_back({ chunk.faces.size(), restOfLine(line + 7, end) });
+                } else if (keyword(line, end, "mtllib", 6)) {
+                    chunk.mtllibs.push_back(restOfLine(line + 7, end));
+                }
+                // comments, groups, objects, smoothing groups, points and lines are ignored
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    // make a chunk relative index global, false if out of range
+    static bool globalIndex(int &index, bool relative, std::size_t base, std::size_t total)
+    {
+        if (index == MISSING)
+            return true;
+        if (relative)
+            index += static_cast<int>(base);
+        return index >= 0 && static_cast<std::size_t>(index) < total;
+    }
+
+    // false for a malformed face or an index out of range
+    static bool merge(std::vector<Chunk> &chunks, Attributes &attributes, JobSystem &jobs)
+    {
+        std::vector<std::size_t> positionBase(chunks.size()), texCoordBase(chunks.size()), normalBase(chunks.size());
+        std::size_t positions = 0, texCoords = 0, normals = 0;
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            if (chunks[i].malformed)
+                return false;
+            positionBase[i] = positions;
+            texCoordBase[i] = texCoords;
+            normalBase[i] = normals;
+            positions += chunks[i].positions.size();
+            texCoords += chunks[i].texCoords.size();
+            normals += chunks[i].normals.size();
+        }
+        attributes.positions.resize(positions);
+        attributes.texCoords.resize(texCoords);
+        attributes.normals.resize(normals);
+
+        std::atomic<bool> valid(true);
+        jobs.ParallelFor(0, chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                Chunk &chunk = chunks[i];
+                std::copy(chunk.positions.begin(), chunk.positions.end(), attributes.positions.begin() + positionBase[i]);
+                std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), attributes.texCoords.begin() + texCoordBase[i]);
+                std::copy(chunk.normals.begin(), chunk.normals.end(), attributes.normals.begin() + normalBase[i]);
+                std::vector<glm::vec3>().swap(chunk.positions);
+                std::vector<glm::vec2>().swap(chunk.texCoords);
+                std::vector<glm::vec3>().swap(chunk.normals);
+
+                for (Corner &corner : chunk.corners) {
+                    if (corner.position == MISSING ||
+                            !globalIndex(corner.position, corner.relative & RELATIVE_POSITION, positionBase[i], positions) ||
+                            !globalIndex(corner.texCoord, corner.relative & RELATIVE_TEXCOORD, texCoordBase[i], texCoords) ||
+                            !globalIndex(corner.normal, corner.relative & RELATIVE_NORMAL, normalBase[i], normals))
+                        valid = false;
+                    corner.relative = 0;
+                }
+            }
+        });
+        return valid;
+    }
+
+    // material index of every face; usemtl carries over chunk boundaries
+    static void assignMaterials(std::vector<Chunk> &chunks, std::vector<std::string> &names)
+    {
+        std::map<std::string, int> indices;
+        std::string current;
+        names.clear();
+        for (Chunk &chunk : chunks) {
+            std::size_t nextSwitch = 0;
+            for (std::size_t f = 0; f < chunk.faces.size(); f++) {
+                while (nextSwitch < chunk.switches.size() && chunk.switches[nextSwitch].face <= f)
+                    current = chunk.switches[nextSwitch++].name;
+                std::map<std::string, int>::iterator it = indices.find(current);
+                if (it == indices.end()) {
+                    it = indices.emplace(current, static_cast<int>(names.size())).first;
+                    names.push_back(current);
+                }
+                chunk.faces[f].material = it->second;
+            }
+            // switches after the last face still apply to the next chunk
+            if (!chunk.switches.empty())
+                current = chunk.switches.back().name;
+        }
+    }
+
+    // welds the faces of one material into indexed triangles in the Vertex layout
+    static void buildMesh(const std::vector<Chunk> &chunks, const Attributes &attributes, int material, ImportedMesh &mesh)
+    {
+        std::unordered_map<Corner, unsigned int, CornerHash, CornerEqual> welded;
+        std::vector<int> positionOf;       // attribute position index of each vertex
+        std::vector<bool> generateNormal;  // vertices without a normal in the file
+        bool missingNormals = false;
+        bool hasTexCoords = false;
+
+        for (const Chunk &chunk : chunks) {
+            for (const Face &face : chunk.faces) {
+                if (face.material != material)
+                    continue;
+                unsigned int first = 0, previous = 0;
+                for (unsigned int c = 0; c < face.cornerCount; c++) {
+                    const Corner &corner = chunk.corners[face.firstCorner + c];
+                    std::pair<std::unordered_map<Corner, unsigned int, CornerHash, CornerEqual>::iterator, bool> slot =
+                        welded.emplace(corner, static_cast<unsigned int>(mesh.vertices.size()));
+                    if (slot.second) {
+                        Vertex vertex = {};
+                        vertex.Position = attributes.positions[corner.position];
+                        if (corner.texCoord != MISSING) {
+                            // aiProcess_FlipUVs equivalent
+                            glm::vec2 texCoord = attributes.texCoords[corner.texCoord];
+                            vertex.TexCoords = glm::vec2(texCoord.x, 1.0f - texCoord.y);
+                            hasTexCoords = true;
+                        }
+                        if (corner.normal != MISSING)
+                            vertex.Normal = attributes.normals[corner.normal];
+                        else
+                            missingNormals = true;
+                        mesh.vertices.push_back(vertex);
+                        positionOf.push_back(corner.position);
+                        generateNormal.push_back(corner.normal == MISSING);
+                    }
+                    unsigned int index = slot.first->second;
+
+                    // triangulate polygons as a fan around the first corner
+                    if (c == 0)
+                        first = index;
+                    else if (c >= 2) {
+                        mesh.indices.push_back(first);
+                        mesh.indices.push_back(previous);
+                        mesh.indices.push_back(index);
+                    }
+                    previous = index;
+                }
+            }
+        }
+
+        if (missingNormals)
+            smoothNormals(mesh, positionOf, generateNormal);
+        if (hasTexCoords)
+            tangentSpace(mesh);
+    }
+
+    // area weighted face normals accumulated per position (aiProcess_GenSmoothNormals)
+    static void smoothNormals(ImportedMesh &mesh, const std::vector<int> &positionOf, const std::vector<bool> &generateNormal)
+    {
+        std::unordered_map<int, glm::vec3> sums;
+        for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const glm::vec3 &a = mesh.vertices[mesh.indices[i]].Position;
+            const glm::vec3 &b = mesh.vertices[mesh.indices[i + 1]].Position;
+            const glm::vec3 &c = mesh.vertices[mesh.indices[i + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, c - a);
+            for (std::size_t k = 0; k < 3; k++) {
+                glm::vec3 &sum = sums[positionOf[mesh.indices[i + k]]];
+                sum += normal;
+            }
+        }
+        for (std::size_t v = 0; v < mesh.vertices.size(); v++) {
+            if (!generateNormal[v])
+                continue;
+            glm::vec3 sum = sums[positionOf[v]];
+            float length = glm::length(sum);
+            mesh.vertices[v].Normal = length > 0.0f ? sum / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // per vertex tangent and bitangent from the UV gradients (aiProcess_CalcTangentSpace)
+    static void tangentSpace(ImportedMesh &mesh)
+    {
+        for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            Vertex &v0 = mesh.vertices[mesh.indices[i]];
+            Vertex &v1 = mesh.vertices[mesh.indices[i + 1]];
+            Vertex &v2 = mesh.vertices[mesh.indices[i + 2]];
+            glm::vec3 edge1 = v1.Position - v0.Position;
+            glm::vec3 edge2 = v2.Position - v0.Position;
+            glm::vec2 deltaUV1 = v1.TexCoords - v0.TexCoords;
+            glm::vec2 deltaUV2 = v2.TexCoords - v0.TexCoords;
+            float determinant = deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y;
+            if (std::fabs(determinant) < 1e-12f)
+                continue;
+            float f = 1.0f / determinant;
+            glm::vec3 tangent = f * (deltaUV2.y * edge1 - deltaUV1.y * edge2);
+            glm::vec3 bitangent = f * (-deltaUV2.x * edge1 + deltaUV1.x * edge2);
+            v0.Tangent += tangent;   v1.Tangent += tangent;   v2.Tangent += tangent;
+            v0.Bitangent += bitangent; v1.Bitangent += bitangent; v2.Bitangent += bitangent;
+        }
+        for (Vertex &vertex : mesh.vertices) {
+            // orthogonalize against the normal
+            glm::vec3 tangent = vertex.Tangent - vertex.Normal * glm::dot(vertex.Normal, vertex.Tangent);
+            float length = glm::length(tangent);
+            vertex.Tangent = length > 0.0f ? tangent / length : glm::vec3(0.0f);
+            length = glm::length(vertex.Bitangent);
+            vertex.Bitangent = length > 0.0f ? vertex.Bitangent / length : glm::vec3(0.0f);
+        }
+    }
+
+    // texture maps of every material in an .mtl file; a missing library only loses textures
+    static void parseMtl(const std::string &path, std::map<std::string, MtlMaterial> &library)
+    {
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::cout << "WARNING::OBJ:: material library not found: " << path << std::endl;
+            return;
+        }
+        MtlMaterial *material = nullptr;
+        const char *p = file.Data();
+        const char *fileEnd = p + file.Size();
+        while (p < fileEnd) {
+            const char *lineEnd = findLineEnd(p, fileEnd);
+            const char *line = skipSpaces(p, lineEnd);
+            if (keyword(line, lineEnd, "newmtl", 6)) {
+                material = &library[restOfLine(line + 7, lineEnd)];
+            } else if (material) {
+                // same map to role assignment as the ASSIMP path: bump is aiTextureType_HEIGHT
+                // (bound as texture_normal), map_Ka is aiTextureType_AMBIENT (texture_height)
+                int role = -1;
+                std::size_t length = 0;
+                if (keyword(line, lineEnd, "map_Kd", 6))        { role = static_cast<int>(TextureRole::DIFFUSE);  length = 6; }
+                else if (keyword(line, lineEnd, "map_Ks", 6))   { role = static_cast<int>(TextureRole::SPECULAR); length = 6; }
+                else if (keyword(line, lineEnd, "map_Bump", 8)) { role = static_cast<int>(TextureRole::NORMAL);   length = 8; }
+                else if (keyword(line, lineEnd, "map_bump", 8)) { role = static_cast<int>(TextureRole::NORMAL);   length = 8; }
+                else if (keyword(line, lineEnd, "bump", 4))     { role = static_cast<int>(TextureRole::NORMAL);   length = 4; }
+                else if (keyword(line, lineEnd, "map_Ka", 6))   { role = static_cast<int>(TextureRole::HEIGHT);   length = 6; }
+                else if (keyword(line, lineEnd, "map_Ke", 6))   { role = static_cast<int>(TextureRole::EMISSIVE); length = 6; }
+                if (role >= 0)
+                    material->maps[role] = lastToken(restOfLine(line + length + 1, lineEnd));
+            }
+            p = lineEnd + 1;
+        }
+    }
+
+    // texture statements may carry options ("-bm 1.0 normal.png"), the file name comes last
+    static std::string lastToken(const std::string &text)
+    {
+        std::size_t start = text.find_last_of(" \t");
+        return start == std::string::npos ? text : text.substr(start + 1);
+    }
+
+    // same order as Model::collectTextures
+    static void addTextures(const MtlMaterial &material, ModelData &data, ImportedMesh &mesh, bool gamma)
+    {
+        static const TextureRole order[] = {
+            TextureRole::DIFFUSE, TextureRole::SPECULAR, TextureRole::NORMAL, TextureRole::HEIGHT, TextureRole::EMISSIVE
+        };
+        for (TextureRole role : order) {
+            const std::string &map = material.maps[static_cast<int>(role)];
+            if (map.empty())
+                continue;
+            unsigned int index = data.TextureIndex(map, role, gamma && role == TextureRole::DIFFUSE);
+            mesh.textures.push_back(std::make_pair(index, role));
+        }
+    }
+};
+#endif
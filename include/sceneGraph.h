@@ -0,0 +1,159 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include "glm/glm.hpp"
+
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// index of a node in a SceneGraph
+typedef unsigned int SceneNode;
+const SceneNode NO_PARENT = ~0u;
+
+// Transform hierarchy stored as arrays (local matrices, world matrices, parent indices,
+// dirty flags) indexed by node. Nodes are also kept in depth-first order, where every subtree
+// is a contiguous range (a node followed by its descendants): a node's range starts at its
+// position and spans subtreeSize entries, and parents always come before their children.
+//
+// SetLocal only flags the node and remembers it. Update then recomputes the world matrices of
+// the flagged nodes' ranges, nothing else, so a frame costs what changed rather than the
+// whole graph. World matrices are valid after Update. Add inserts into the order, which moves
+// the nodes after the parent's subtree (linear in the graph size, meant for building the
+// scene rather than every frame); nodes can't be removed or re-parented.
+class SceneGraph
+{
+public:
+    // nodes recomputed by the last Update
+    unsigned int Updated = 0;
+
+    SceneGraph()
+    {
+        append(NO_PARENT, glm::mat4(1.0f));
+    }
+
+    SceneNode Root() const { return 0; }
+    std::size_t Size() const { return parent.size(); }
+
+    // a new node placed by local relative to its parent
+    SceneNode Add(SceneNode parentNode, const glm::mat4 &localTransform = glm::mat4(1.0f))
+    {
+        return append(parentNode, localTransform);
+    }
+
+    void SetLocal(SceneNode node, const glm::mat4 &localTransform)
+    {
+        local[node] = localTransform;
+        markDirty(node);
+    }
+
+    const glm::mat4& Local(SceneNode node) const { return local[node]; }
+    // model matrix of the node as of the last Update
+    const glm::mat4& World(SceneNode node) const { return world[node]; }
+    SceneNode Parent(SceneNode node) const { return parent[node]; }
+
+    // recomputes the world matrices of changed subtrees. Flagged nodes inside another flagged
+    // node's subtree are covered by it; the remaining subtrees are disjoint and spread over
+    // the job system. One subtree too large for a single thread (a moved root, say) is split:
+    // its root is computed first, then its children's subtrees are tasks of their own.
+    void Update(JobSystem &jobs = JobSystem::Global())
+    {
+        Updated = 0;
+        if (dirtyNodes.empty())
+            return;
+        // outermost subtrees first, then drop the ones nested in an earlier range
+        std::sort(dirtyNodes.begin(), dirtyNodes.end(), [this](SceneNode a, SceneNode b) {
+            return position[a] < position[b];
+        });
+        roots.clear();
+        std::size_t coveredEnd = 0;
+        for (SceneNode node : dirtyNodes) {
+            dirty[node] = 0;
+            if (position[node] < coveredEnd)
+                continue;
+            roots.push_back(node);
+            coveredEnd = position[node] + subtreeSize[node];
+            Updated += subtreeSize[node];
+        }
+        dirtyNodes.clear();
+
+        // a few tasks per thread at most; roots grows while it's walked
+        std::size_t target = std::max<std::size_t>(SPLIT_SIZE, Updated / ((jobs.WorkerCount() + 1) * 4));
+        tasks.clear();
+        for (std::size_t i = 0; i < roots.size(); i++) {
+            SceneNode root = roots[i];
+            if (subtreeSize[root] <= target) {
+                tasks.push_back(root);
+                continue;
+            }
+            computeWorld(root);
+            std::size_t last = position[root] + subtreeSize[root];
+            for (std::size_t at = position[root] + 1; at < last; at += subtreeSize[order[at]])
+                roots.push_back(order[at]);
+        }
+
+        jobs.ParallelFor(0, tasks.size(), 16, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                std::size_t first = position[tasks[i]];
+                std::size_t last = first + subtreeSize[tasks[i]];
+                // parents come first in the order, already final for this update
+                for (std::size_t at = first; at < last; at++)
+                    computeWorld(order[at]);
+            }
+        });
+    }
+
+private:
+    // subtrees at most this large are never split
+    static const std::size_t SPLIT_SIZE = 256;
+
+    std::vector<glm::mat4> local;
+    std::vector<glm::mat4> world;
+    std::vector<SceneNode> parent;
+    std::vector<unsigned char> dirty;       // local changed since the last Update
+    std::vector<SceneNode> order;           // depth-first, every subtree contiguous
+    std::vector<std::size_t> position;      // of each node in order
+    std::vector<std::size_t> subtreeSize;   // the node and all its descendants
+    std::vector<SceneNode> dirtyNodes;      // flagged since the last Update
+    std::vector<SceneNode> roots;           // disjoint subtrees of the running Update
+    std::vector<SceneNode> tasks;           // the ones small enough for one job
+
+    void computeWorld(SceneNode node)
+    {
+        SceneNode up = parent[node];
+        world[node] = up == NO_PARENT ? local[node] : world[up] * local[node];
+    }
+
+    void markDirty(SceneNode node)
+    {
+        if (!dirty[node]) {
+            dirty[node] = 1;
+            dirtyNodes.push_back(node);
+        }
+    }
+
+    SceneNode append(SceneNode parentNode, const glm::mat4 &localTransform)
+    {
+        SceneNode node = static_cast<SceneNode>(parent.size());
+        local.push_back(localTransform);
+        world.push_back(localTransform);
+        parent.push_back(parentNode);
+        dirty.push_back(0);
+        subtreeSize.push_back(1);
+
+        // last in the parent's range, the nodes after it move one place
+        std::size_t at = parentNode == NO_PARENT ? order.size() : position[parentNode] + subtreeSize[parentNode];
+        order.insert(order.begin() + at, node);
+        position.push_back(at);
+        for (std::size_t i = at + 1; i < order.size(); i++)
+            position[order[i]] = i;
+        for (SceneNode up = parentNode; up != NO_PARENT; up = parent[up])
+            subtreeSize[up]++;
+
+        markDirty(node);
+        return node;
+    }
+};
+#endif
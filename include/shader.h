@@ -2,201 +2,169 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
 
+#include "gpuResource.h"
+#include "glExtensions.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
-class Shader
+// Compile-time features of a shader variant, e.g. ShaderDefines().Set("SHADOWS").Set("NR_POINT_LIGHTS", 4).
+// Kept sorted by name, so the same features give the same Key() in whatever order they're set.
+class ShaderDefines
 {
-    public:
-        // program ID
-        unsigned int ID;
+public:
+    // a flag, #define name; Set(name, false) leaves it out
+    ShaderDefines& Set(const std::string &name, bool enabled = true)
+    {
+        if (enabled)
+            values[name] = "";
+        else
+            values.erase(name);
+        return *this;
+    }
+    // a value, #define name value
+    ShaderDefines& Set(const std::string &name, int value)
+    {
+        values[name] = std::to_string(value);
+        return *this;
+    }
 
-        // Shader(vertex, fragment)
-        Shader(const char* vertexPath, const char* fragmentPath){
-            // 1. retrieve the vertex/fragment source code from filePath
-            std::string vertexCode;
-            std::string fragmentCode;
-            std::ifstream vShaderFile;
-            std::ifstream fShaderFile;
-            // ensure ifstream objects can throw exceptions:
-            vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-            fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-            try
-            {
-                // open files
-                vShaderFile.open(vertexPath);
-                fShaderFile.open(fragmentPath);
-                std::stringstream vShaderStream, fShaderStream;
-                // read file's buffer contents into streams
-                vShaderStream << vShaderFile.rdbuf();
-                fShaderStream << fShaderFile.rdbuf();
-                // close file handlers
-                vShaderFile.close();
-                fShaderFile.close();
-                // convert stream into string
-                vertexCode = vShaderStream.str();
-                fragmentCode = fShaderStream.str();
-            }
-            catch (std::ifstream::failure e) 
-            {
-                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-            }
-            const char* vShaderCode = vertexCode.c_str();
-            const char* fShaderCode = fragmentCode.c_str();
+    // identifies the variant, "NAME" or "NAME=VALUE" per define
+    std::string Key() const
+    {
+        std::string key;
+        for (const std::pair<const std::string, std::string> &define : values) {
+            if (!key.empty())
+                key += ' ';
+            key += define.second.empty() ? define.first : define.first + "=" + define.second;
+        }
+        return key;
+    }
 
-            // 2. compile shaders
-            unsigned int vertex, fragment;
-            int success;
-            char infoLog[512];
-
-            // vertex Shader
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vShaderCode, NULL);
-            glCompileShader(vertex);
-            // print compile errors
-            glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-            }
+    // the #define lines Shader injects after #version
+    std::string Source() const
+    {
+        std::string source;
+        for (const std::pair<const std::string, std::string> &define : values)
+            source += "#define " + define.first + (define.second.empty() ? "" : " " + define.second) + "\n";
+        return source;
+    }
 
-            // fragment Shader
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fShaderCode, NULL);
-            glCompileShader(fragment);
-            // print compile errors
-            glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-            }
+private:
+    std::map<std::string, std::string> values;
+};
 
-            // shader Program
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, fragment);
-            glLinkProgram(ID);
-            // print linking errors
-            glGetProgramiv(ID, GL_LINK_STATUS, &success);
-            if (!success)
-            {
-                glGetProgramInfoLog(ID, 512, NULL, infoLog);
-                std:: cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-            }
+class ShaderBatch;
 
-            // delete shaders after linking
-            glDeleteShader(vertex);
-            glDeleteShader(fragment);
-        };
-        
-        // Shader(vertex, geometry, fragment)
-        Shader(const char* vertexPath, const char*geometryPath, const char* fragmentPath){
-            // 1. retrieve the vertex/fragment source code from filePath
-            std::string vertexCode;
-            std::string geometryCode;
-            std::string fragmentCode;
-            std::ifstream vShaderFile;
-            std::ifstream gShaderFile;
-            std::ifstream fShaderFile;
-            // ensure ifstream objects can throw exceptions:
-            vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-            gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-            fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-            try
-            {
-                // open files
-                vShaderFile.open(vertexPath);
-                gShaderFile.open(geometryPath);
-                fShaderFile.open(fragmentPath);
-                std::stringstream vShaderStream, gShaderStream, fShaderStream;
-                // read file's buffer contents into streams
-                vShaderStream << vShaderFile.rdbuf();
-                gShaderStream << gShaderFile.rdbuf();
-                fShaderStream << fShaderFile.rdbuf();
-                // close file handlers
-                vShaderFile.close();
-                gShaderFile.close();
-                fShaderFile.close();
-                // convert stream into string
-                vertexCode = vShaderStream.str();
-                geometryCode = gShaderStream.str();
-                fragmentCode = fShaderStream.str();
-            }
-            catch (std::ifstream::failure e) 
-            {
-                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-            }
-            const char* vShaderCode = vertexCode.c_str();
-            const char* gShaderCode = geometryCode.c_str();
-            const char* fShaderCode = fragmentCode.c_str();
+// KHR_parallel_shader_compile and its ARB twin share their enum and entry point signature
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
-            // 2. compile shaders
-            unsigned int vertex, geometry, fragment;
-            int success;
-            char infoLog[512];
-
-            // vertex Shader
-            vertex = glCreateShader(GL_VERTEX_SHADER);
-            glShaderSource(vertex, 1, &vShaderCode, NULL);
-            glCompileShader(vertex);
-            // print compile errors
-            glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-            }
+// Background compilation by the driver. Neither extension is in the core 3.3 glad: support is
+// read from the extension strings and the entry point loaded through GLFW, once, on the GL
+// thread. Without it compiles still work, the first read of a result just waits for them.
+struct ParallelShaderCompile {
+    typedef void (APIENTRY *MaxThreadsProc)(GLuint count);
 
-            // geometry Shader
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            // print compile errors
-            glGetShaderiv(geometry, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(geometry, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
-            }
+    bool available = false;
+    MaxThreadsProc maxThreads = nullptr;
 
-            // fragment Shader
-            fragment = glCreateShader(GL_FRAGMENT_SHADER);
-            glShaderSource(fragment, 1, &fShaderCode, NULL);
-            glCompileShader(fragment);
-            // print compile errors
-            glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-            if (!success)
-            {
-                glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-                std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-            }
+    static const ParallelShaderCompile& Get()
+    {
+        static ParallelShaderCompile support = detect();
+        return support;
+    }
 
-            // shader Program
-            ID = glCreateProgram();
-            glAttachShader(ID, vertex);
-            glAttachShader(ID, geometry);
-            glAttachShader(ID, fragment);
-            glLinkProgram(ID);
-            // print linking errors
-            glGetProgramiv(ID, GL_LINK_STATUS, &success);
-            if (!success)
-            {
-                glGetProgramInfoLog(ID, 512, NULL, infoLog);
-                std:: cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-            }
+private:
+    static ParallelShaderCompile detect()
+    {
+        ParallelShaderCompile support;
+        if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+            support.maxThreads = reinterpret_cast<MaxThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+        else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+            support.maxThreads = reinterpret_cast<MaxThreadsProc>(glfwGetProcAddress("glMaxShaderCompilerThreadsARB"));
+        support.available = support.maxThreads != nullptr;
+        return support;
+    }
+};
 
-            // delete shaders after linking
-            glDeleteShader(vertex);
-            glDeleteShader(geometry);
-            glDeleteShader(fragment);
+// a program handed to the driver whose compile and link results haven't been read yet
+struct PendingProgram {
+    unsigned int program = 0;
+    unsigned int stages[3] = { 0, 0, 0 };      // vertex, geometry (0 if none), fragment
+    std::vector<std::string> files[3];          // of each stage, by #line source number
+};
+
+// Program built from GLSL files. Sources are preprocessed before compiling: an
+// #include "file" line (path relative to the including file) is replaced by that file, each
+// file at most once per stage, and the defines are injected after #version. Compile errors
+// name the files by their #line source number, listed after the log. Constructed with a
+// ShaderBatch the compile is only queued, see there.
+class Shader
+{
+    public:
+        // program ID, deleted with the shader (move-only)
+        GpuProgram ID;
+
+        // source files, geometryPath is empty for vertex/fragment programs
+        std::string vertexPath;
+        std::string geometryPath;
+        std::string fragmentPath;
+        // #define lines injected after each stage's #version directive
+        std::string defines;
+        // every file the program was built from, the stage files and what they include
+        std::vector<std::string> sourceFiles;
+
+        // Shader(vertex, fragment)
+        Shader(const char* vertexPath, const char* fragmentPath)
+            : vertexPath(vertexPath), fragmentPath(fragmentPath)
+        {
+            build();
+        };
+        
+        // Shader(vertex, geometry, fragment)
+        Shader(const char* vertexPath, const char*geometryPath, const char* fragmentPath)
+            : vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath)
+        {
+            build();
+        };
+
+        // Shader(vertex, geometry or "", fragment, defines), e.g. defines = "#define INSTANCED\n"
+        Shader(const std::string &vertexPath, const std::string &geometryPath, const std::string &fragmentPath, const std::string &defines)
+            : vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath), defines(defines)
+        {
+            build();
         };
 
+        // queued in batch, returns before the driver has compiled anything
+        Shader(const std::string &vertexPath, const std::string &geometryPath, const std::string &fragmentPath, const std::string &defines, ShaderBatch &batch);
+
+        // compile the same sources again with extra defines
+        Shader Variant(const std::string &extraDefines) const
+        {
+            return Shader(vertexPath, geometryPath, fragmentPath, defines + extraDefines);
+        }
+        Shader Variant(const std::string &extraDefines, ShaderBatch &batch) const
+        {
+            return Shader(vertexPath, geometryPath, fragmentPath, defines + extraDefines, batch);
+        }
+        Shader Variant(const ShaderDefines &extraDefines) const
+        {
+            return Variant(extraDefines.Source());
+        }
+
         // use/activate the shader
         void use()
         {
@@ -259,6 +227,348 @@ class Shader
         {
             glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
         }
+
+        // true once the driver is done with program, without waiting for it when parallel
+        // compilation is available
+        static bool Complete(const PendingProgram &pending)
+        {
+            if (!ParallelShaderCompile::Get().available)
+                return true;
+            int complete = GL_TRUE;
+            // same value for the ARB and KHR extensions
+            glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+            return complete == GL_TRUE;
+        }
+
+        // reads the link status (waiting for the driver if needed), prints the full logs of
+        // whatever failed and frees the stage objects; true if the program linked
+        static bool Report(PendingProgram &pending)
+        {
+            static const char *stageNames[3] = { "VERTEX", "GEOMETRY", "FRAGMENT" };
+            int success = GL_FALSE;
+            glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                // a stage that failed to compile fails the link, its log says why
+                for (int i = 0; i < 3; i++)
+                {
+                    int compiled = GL_TRUE;
+                    if (pending.stages[i])
+                        glGetShaderiv(pending.stages[i], GL_COMPILE_STATUS, &compiled);
+                    if (compiled)
+                        continue;
+                    std::cout << "ERROR::SHADER::" << stageNames[i] << "::COMPILATION_FAILED\n" << infoLog(pending.stages[i], false);
+                    for (std::size_t f = 0; f < pending.files[i].size(); f++)
+                        std::cout << "  source " << f << ": " << pending.files[i][f] << "\n";
+                    std::cout << std::endl;
+                }
+                std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog(pending.program, true) << std::endl;
+            }
+
+            // delete shaders after linking
+            for (unsigned int stage : pending.stages)
+                if (stage)
+                    glDeleteShader(stage);
+            return success == GL_TRUE;
+        }
+
+    private:
+        // 1. retrieve the source code from the file paths, 2. compile and link
+        void build()
+        {
+            PendingProgram pending = submit();
+            Report(pending);
+        }
+
+        // compiles and links without reading any result back, so the driver can work on it
+        // while the caller moves on
+        PendingProgram submit()
+        {
+            bool hasGeometry = !geometryPath.empty();
+            std::vector<std::string> vertexFiles, geometryFiles, fragmentFiles;
+            std::string vertexCode = injectDefines(preprocess(vertexPath, vertexFiles));
+            std::string geometryCode = hasGeometry ? injectDefines(preprocess(geometryPath, geometryFiles)) : "";
+            std::string fragmentCode = injectDefines(preprocess(fragmentPath, fragmentFiles));
+            sourceFiles.clear();
+            for (const std::vector<std::string> *files : { &vertexFiles, &geometryFiles, &fragmentFiles })
+                for (const std::string &file : *files)
+                    if (std::find(sourceFiles.begin(), sourceFiles.end(), file) == sourceFiles.end())
+                        sourceFiles.push_back(file);
+
+            // 2. compile shaders
+            PendingProgram pending;
+            pending.stages[0] = compileStage(GL_VERTEX_SHADER, vertexCode);
+            pending.stages[1] = hasGeometry ? compileStage(GL_GEOMETRY_SHADER, geometryCode) : 0;
+            pending.stages[2] = compileStage(GL_FRAGMENT_SHADER, fragmentCode);
+            pending.files[0] = vertexFiles;
+            pending.files[1] = geometryFiles;
+            pending.files[2] = fragmentFiles;
+
+            // shader Program, linked straight away: a stage that fails shows up in the link status
+            ID = GpuProgram::Create("shader " + vertexPath + " / " + fragmentPath);
+            pending.program = ID;
+            for (unsigned int stage : pending.stages)
+                if (stage)
+                    glAttachShader(ID, stage);
+            glLinkProgram(ID);
+            return pending;
+        }
+
+        // the whole info log of a shader or program object
+        static std::string infoLog(unsigned int object, bool program)
+        {
+            int length = 0;
+            if (program)
+                glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+            else
+                glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+            if (length <= 0)
+                return "";
+            std::string log(length, '\0');
+            int written = 0;
+            if (program)
+                glGetProgramInfoLog(object, length, &written, &log[0]);
+            else
+                glGetShaderInfoLog(object, length, &written, &log[0]);
+            log.resize(written);
+            return log;
+        }
+
+        static std::string readFile(const std::string &path)
+        {
+            std::ifstream file;
+            // ensure ifstream objects can throw exceptions:
+            file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+            file.open(path);
+            std::stringstream stream;
+            // read file's buffer contents into streams
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+
+        // the code of the file at path with its #includes resolved. files receives every file
+        // read for the stage, the #line source number of a file is its index there.
+        static std::string preprocess(const std::string &path, std::vector<std::string> &files)
+        {
+            std::string code;
+            try
+            {
+                code = readFile(path);
+            }
+            catch (std::ifstream::failure &e)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+                return "";
+            }
+            std::size_t source = files.size();
+            files.push_back(path);
+            std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+
+            std::istringstream lines(code);
+            std::string result, line, included;
+            unsigned int number = 0;
+            while (std::getline(lines, line))
+            {
+                number++;
+                if (!parseInclude(line, included))
+                {
+                    result += line + "\n";
+                    continue;
+                }
+                std::string includePath = normalizePath(directory + included);
+                // already included: keep the line count with an empty line
+                if (std::find(files.begin(), files.end(), includePath) != files.end())
+                {
+                    result += "\n";
+                    continue;
+                }
+                result += "#line 1 " + std::to_string(files.size()) + "\n";
+                result += preprocess(includePath, files);
+                // back in this file, on the line after the #include
+                result += "#line " + std::to_string(number + 1) + " " + std::to_string(source) + "\n";
+            }
+            return result;
+        }
+
+        // the file of an #include "file" (or <file>) line
+        static bool parseInclude(const std::string &line, std::string &file)
+        {
+            std::size_t start = line.find_first_not_of(" \t");
+            if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+                return false;
+            std::size_t open = line.find_first_of("\"<", start + 8);
+            if (open == std::string::npos)
+                return false;
+            std::size_t close = line.find(line[open] == '<' ? '>' : '"', open + 1);
+            if (close == std::string::npos)
+                return false;
+            file = line.substr(open + 1, close - open - 1);
+            return true;
+        }
+
+        // path with "." and "dir/.." parts removed, so a file reached through different
+        // directories is recognized as the same
+        static std::string normalizePath(const std::string &path)
+        {
+            std::vector<std::string> parts;
+            std::size_t start = 0;
+            while (start <= path.size())
+            {
+                std::size_t end = path.find_first_of("/\\", start);
+                if (end == std::string::npos)
+                    end = path.size();
+                std::string part = path.substr(start, end - start);
+                if (part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty())
+                    parts.pop_back();
+                else if (part != "." && (!part.empty() || parts.empty()))
+                    parts.push_back(part);
+                start = end + 1;
+            }
+            std::string normalized;
+            for (std::size_t i = 0; i < parts.size(); i++)
+                normalized += (i > 0 ? "/" : "") + parts[i];
+            return normalized;
+        }
+
+        // defines must follow the #version directive, which has to come first
+        std::string injectDefines(const std::string &code) const
+        {
+            if (defines.empty())
+                return code;
+            std::size_t version = code.find("#version");
+            if (version == std::string::npos)
+                return defines + code;
+            std::size_t lineEnd = code.find('\n', version);
+            if (lineEnd == std::string::npos)
+                return code + "\n" + defines;
+            // keep the file's own line numbers after the injected lines
+            std::size_t versionLine = std::count(code.begin(), code.begin() + lineEnd, '\n') + 1;
+            return code.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(versionLine + 1) + " 0\n" + code.substr(lineEnd + 1);
+        }
+
+        static unsigned int compileStage(GLenum type, const std::string &code)
+        {
+            const char* shaderCode = code.c_str();
+
+            unsigned int shader = glCreateShader(type);
+            glShaderSource(shader, 1, &shaderCode, NULL);
+            glCompileShader(shader);
+            return shader;
+        }
+};
+
+// Builds many programs at once. A Shader constructed with the batch compiles and links without
+// reading any result back, so with KHR/ARB_parallel_shader_compile the driver works through
+// the whole batch on its own threads while the application loads other things. Poll reports
+// the programs that finished without blocking; Finish waits for the rest. A program can be
+// used before it's reported (the first use waits for it), but only reporting prints its
+// errors. Finish before the GL context goes away.
+class ShaderBatch
+{
+public:
+    ShaderBatch()
+    {
+        // let the driver pick how many compiler threads to use
+        const ParallelShaderCompile &parallel = ParallelShaderCompile::Get();
+        if (parallel.available)
+            parallel.maxThreads(0xFFFFFFFFu);
+    }
+
+    // reports every finished program; true once nothing is left. Without the extension
+    // this reports (and waits for) everything.
+    bool Poll()
+    {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < pending.size(); i++) {
+            if (glIsProgram(pending[i].program) && !Shader::Complete(pending[i])) {
+                pending[kept++] = pending[i];
+                continue;
+            }
+            report(pending[i]);
+        }
+        pending.resize(kept);
+        return pending.empty();
+    }
+
+    // waits for and reports every program left
+    void Finish()
+    {
+        for (PendingProgram &program : pending)
+            report(program);
+        pending.clear();
+    }
+
+    // programs submitted and not yet reported
+    std::size_t Size() const { return pending.size(); }
+    // true while program is in the batch, i.e. not reported yet
+    bool Waiting(unsigned int program) const
+    {
+        for (const PendingProgram &waiting : pending)
+            if (waiting.program == program)
+                return true;
+        return false;
+    }
+    // programs that failed to build so far
+    unsigned int Failed = 0;
+
+private:
+    friend class Shader;
+    std::vector<PendingProgram> pending;
+
+    void report(PendingProgram &program)
+    {
+        // the Shader was destroyed before being reported, only its stages are left
+        if (!glIsProgram(program.program)) {
+            for (unsigned int stage : program.stages)
+                if (stage)
+                    glDeleteShader(stage);
+            return;
+        }
+        if (!Shader::Report(program))
+            Failed++;
+    }
+};
+
+inline Shader::Shader(const std::string &vertexPath, const std::string &geometryPath, const std::string &fragmentPath, const std::string &defines, ShaderBatch &batch)
+    : vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath), defines(defines)
+{
+    batch.pending.push_back(submit());
+}
+
+// Every variant of one set of shader sources, each compiled the first time its defines are
+// asked for and kept for later frames. Features that would be uniform bools become defines,
+// so the compiler drops the branches a variant doesn't take. Call on the GL thread; references
+// returned stay valid as long as the ShaderVariants.
+class ShaderVariants
+{
+public:
+    // geometryPath may be empty; defines are added to every variant's
+    ShaderVariants(const std::string &vertexPath, const std::string &geometryPath, const std::string &fragmentPath, const std::string &defines = "")
+        : vertexPath(vertexPath), geometryPath(geometryPath), fragmentPath(fragmentPath), defines(defines)
+    {
+    }
+
+    // the variant compiled with features, queued in batch if given and not compiled yet
+    Shader& Get(const ShaderDefines &features, ShaderBatch *batch = nullptr)
+    {
+        std::unique_ptr<Shader> &variant = variants[features.Key()];
+        if (!variant && batch)
+            variant.reset(new Shader(vertexPath, geometryPath, fragmentPath, defines + features.Source(), *batch));
+        else if (!variant)
+            variant.reset(new Shader(vertexPath, geometryPath, fragmentPath, defines + features.Source()));
+        return *variant;
+    }
+
+    // variants compiled so far
+    std::size_t Size() const { return variants.size(); }
+
+private:
+    std::string vertexPath;
+    std::string geometryPath;
+    std::string fragmentPath;
+    std::string defines;
+    std::unordered_map<std::string, std::unique_ptr<Shader>> variants;
 };
 
 #endif
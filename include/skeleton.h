@@ -0,0 +1,289 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include "glm/glm.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+// rotation matrix of a unit quaternion stored as (x, y, z, w)
+inline glm::mat3 QuaternionMatrix(const glm::vec4 &q)
+{
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    glm::mat3 result;
+    result[0] = glm::vec3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+    result[1] = glm::vec3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+    result[2] = glm::vec3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+    return result;
+}
+
+// unit quaternion (x, y, z, w) of a rotation matrix (Shepperd's method)
+inline glm::vec4 MatrixQuaternion(const glm::mat3 &m)
+{
+    float trace = m[0][0] + m[1][1] + m[2][2];
+    glm::vec4 q;
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        q = glm::vec4((m[1][2] - m[2][1]) / s, (m[2][0] - m[0][2]) / s, (m[0][1] - m[1][0]) / s, 0.25f * s);
+    } else if (m[0][0] > m[1][1] && m[0][0] > m[2][2]) {
+        float s = std::sqrt(1.0f + m[0][0] - m[1][1] - m[2][2]) * 2.0f;
+        q = glm::vec4(0.25f * s, (m[1][0] + m[0][1]) / s, (m[2][0] + m[0][2]) / s, (m[1][2] - m[2][1]) / s);
+    } else if (m[1][1] > m[2][2]) {
+        float s = std::sqrt(1.0f + m[1][1] - m[0][0] - m[2][2]) * 2.0f;
+        q = glm::vec4((m[1][0] + m[0][1]) / s, 0.25f * s, (m[2][1] + m[1][2]) / s, (m[2][0] - m[0][2]) / s);
+    } else {
+        float s = std::sqrt(1.0f + m[2][2] - m[0][0] - m[1][1]) * 2.0f;
+        q = glm::vec4((m[2][0] + m[0][2]) / s, (m[2][1] + m[1][2]) / s, 0.25f * s, (m[0][1] - m[1][0]) / s);
+    }
+    return q / glm::length(q);
+}
+
+// Keyframes of one joint in one clip, times in ticks and sorted. Every channel has at least
+// one key: channels the file doesn't animate hold the joint's bind pose.
+struct JointTrack {
+    std::vector<float> positionTimes;
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotationTimes;
+    std::vector<glm::vec4> rotations;   // quaternions (x, y, z, w)
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+
+    // a constant track holding the translation, rotation and scale of a (shear free) matrix
+    static JointTrack FromMatrix(const glm::mat4 &local)
+    {
+        JointTrack track;
+        glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+        glm::mat3 rotation;
+        for (int i = 0; i < 3; i++)
+            rotation[i] = glm::vec3(local[i]) / scale[i];
+        track.positionTimes.push_back(0.0f);
+        track.positions.push_back(glm::vec3(local[3]));
+        track.rotationTimes.push_back(0.0f);
+        track.rotations.push_back(MatrixQuaternion(rotation));
+        track.scaleTimes.push_back(0.0f);
+        track.scales.push_back(scale);
+        return track;
+    }
+};
+
+// a skeletal animation: one track per joint of its skeleton, in joint order
+struct AnimationClip {
+    std::string name;
+    float duration = 0.0f;          // ticks
+    float ticksPerSecond = 25.0f;
+    std::vector<JointTrack> tracks;
+
+    // the clip's tick at time seconds into playback, looping
+    float Ticks(float seconds) const
+    {
+        if (duration <= 0.0f)
+            return 0.0f;
+        float ticks = std::fmod(seconds * ticksPerSecond, duration);
+        return ticks < 0.0f ? ticks + duration : ticks;
+    }
+};
+
+// Local transforms of every joint as a structure of arrays (one array per component), so
+// interpolation runs four joints per SIMD instruction. Arrays are padded to a multiple of 4.
+struct JointPose {
+    std::vector<float> translation[3];
+    std::vector<float> rotation[4];     // quaternion x, y, z, w
+    std::vector<float> scale[3];
+
+    void Resize(std::size_t joints)
+    {
+        std::size_t padded = (joints + 3) / 4 * 4;
+        for (std::vector<float> &component : translation) component.assign(padded, 0.0f);
+        for (std::vector<float> &component : rotation) component.assign(padded, 0.0f);
+        for (std::vector<float> &component : scale) component.assign(padded, 1.0f);
+        for (std::size_t i = 0; i < padded; i++)
+            rotation[3][i] = 1.0f;
+    }
+
+    glm::mat4 Local(std::size_t joint) const
+    {
+        glm::mat3 rotate = QuaternionMatrix(glm::vec4(rotation[0][joint], rotation[1][joint], rotation[2][joint], rotation[3][joint]));
+        glm::mat4 local(1.0f);
+        local[0] = glm::vec4(rotate[0] * scale[0][joint], 0.0f);
+        local[1] = glm::vec4(rotate[1] * scale[1][joint], 0.0f);
+        local[2] = glm::vec4(rotate[2] * scale[2][joint], 0.0f);
+        local[3] = glm::vec4(translation[0][joint], translation[1][joint], translation[2][joint], 1.0f);
+        return local;
+    }
+};
+
+// The joint hierarchy of a skinned model and the animations moving it. Joints are the model's
+// nodes listed parents first; bones are the joints meshes are skinned to, vertex bone ids
+// index them. Read only once imported, so any number of threads can pose it at once.
+//
+// A bone palette holds PaletteStride() matrices per instance: slot 0 is the instance's model
+// matrix (for vertices without weights), bone N is slot N + 1 and maps bind pose mesh space to
+// the posed bone in world space.
+struct Skeleton {
+    std::vector<std::string> jointNames;
+    std::vector<int> parents;                   // -1 for roots
+    std::vector<unsigned int> boneJoints;       // joint of each bone
+    std::vector<glm::mat4> boneOffsets;         // mesh space to bone space in the bind pose
+    // node transforms of the file, played when no animation is
+    AnimationClip bindPose;
+    std::vector<AnimationClip> animations;
+
+    std::size_t JointCount() const { return parents.size(); }
+    std::size_t BoneCount() const { return boneJoints.size(); }
+    std::size_t PaletteStride() const { return BoneCount() + 1; }
+
+    // joint index of a node name, -1 if it isn't part of the skeleton
+    int FindJoint(const std::string &name) const
+    {
+        for (std::size_t i = 0; i < jointNames.size(); i++)
+            if (jointNames[i] == name)
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    // the animation named name, the bind pose if there is none
+    const AnimationClip& FindAnimation(const std::string &name) const
+    {
+        for (const AnimationClip &clip : animations)
+            if (clip.name == name)
+                return clip;
+        return bindPose;
+    }
+
+    // keyframe pairs gathered by SamplePose, kept between calls to avoid reallocating
+    struct SampleScratch {
+        std::vector<float> from[10], to[10];
+        std::vector<float> translationT, rotationT, scaleT;
+    };
+
+    // local transforms of every joint at time seconds into clip (looping). Keys are found by
+    // binary search per joint, then every component is blended four joints at a time:
+    // translations and scales linearly, rotations by normalized lerp along the shorter arc.
+    void SamplePose(const AnimationClip &clip, float seconds, JointPose &pose, SampleScratch &scratch) const
+    {
+        std::size_t joints = JointCount();
+        if (pose.translation[0].size() < joints)
+            pose.Resize(joints);
+        std::size_t padded = pose.translation[0].size();
+        // joints without keys (and the padding) stay at the identity: rotation w and scale are 1
+        for (int c = 0; c < 10; c++) {
+            scratch.from[c].assign(padded, c < 6 ? 0.0f : 1.0f);
+            scratch.to[c].assign(padded, c < 6 ? 0.0f : 1.0f);
+        }
+        scratch.translationT.assign(padded, 0.0f);
+        scratch.rotationT.assign(padded, 0.0f);
+        scratch.scaleT.assign(padded, 0.0f);
+
+        float ticks = clip.Ticks(seconds);
+        for (std::size_t joint = 0; joint < joints && joint < clip.tracks.size(); joint++) {
+            const JointTrack &track = clip.tracks[joint];
+            std::size_t a, b;
+            scratch.translationT[joint] = keyPair(track.positionTimes, ticks, a, b);
+            gather(&track.positions[a].x, &track.positions[b].x, 3, scratch, 0, joint);
+            scratch.rotationT[joint] = keyPair(track.rotationTimes, ticks, a, b);
+            gather(&track.rotations[a].x, &track.rotations[b].x, 4, scratch, 3, joint);
+            scratch.scaleT[joint] = keyPair(track.scaleTimes, ticks, a, b);
+            gather(&track.scales[a].x, &track.scales[b].x, 3, scratch, 7, joint);
+        }
+
+        for (int c = 0; c < 3; c++) {
+            lerp(scratch.from[c].data(), scratch.to[c].data(), scratch.translationT.data(), pose.translation[c].data(), padded);
+            lerp(scratch.from[7 + c].data(), scratch.to[7 + c].data(), scratch.scaleT.data(), pose.scale[c].data(), padded);
+        }
+        nlerp(scratch, pose, padded);
+    }
+
+    // writes the PaletteStride() matrices of one instance placed with transform into palette;
+    // model receives every joint's model space matrix (JointCount() of them)
+    void ComposePalette(const JointPose &pose, const glm::mat4 &transform, glm::mat4 *palette, glm::mat4 *model) const
+    {
+        for (std::size_t joint = 0; joint < JointCount(); joint++)
+            model[joint] = parents[joint] < 0 ? pose.Local(joint) : model[parents[joint]] * pose.Local(joint);
+        palette[0] = transform;
+        for (std::size_t bone = 0; bone < BoneCount(); bone++)
+            palette[bone + 1] = transform * model[boneJoints[bone]] * boneOffsets[bone];
+    }
+
+private:
+    // the keys around ticks and the blend factor between them
+    static float keyPair(const std::vector<float> &times, float ticks, std::size_t &a, std::size_t &b)
+    {
+        std::size_t next = std::upper_bound(times.begin(), times.end(), ticks) - times.begin();
+        if (next == 0 || next == times.size()) {
+            a = b = next == 0 ? 0 : times.size() - 1;
+            return 0.0f;
+        }
+        a = next - 1;
+        b = next;
+        float span = times[b] - times[a];
+        return span > 0.0f ? (ticks - times[a]) / span : 0.0f;
+    }
+
+    static void gather(const float *from, const float *to, int components, SampleScratch &scratch, int first, std::size_t joint)
+    {
+        for (int c = 0; c < components; c++) {
+            scratch.from[first + c][joint] = from[c];
+            scratch.to[first + c][joint] = to[c];
+        }
+    }
+
+    static void lerp(const float *from, const float *to, const float *t, float *out, std::size_t count)
+    {
+        std::size_t i = 0;
+#if defined(__SSE__)
+        for (; i < count; i += 4) {
+            __m128 a = _mm_loadu_ps(from + i);
+            _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(to + i), a), _mm_loadu_ps(t + i))));
+        }
+#endif
+        for (; i < count; i++)
+            out[i] = from[i] + (to[i] - from[i]) * t[i];
+    }
+
+    static void nlerp(const SampleScratch &scratch, JointPose &pose, std::size_t count)
+    {
+        std::size_t i = 0;
+#if defined(__SSE__)
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        for (; i < count; i += 4) {
+            __m128 a[4], b[4];
+            for (int c = 0; c < 4; c++) {
+                a[c] = _mm_loadu_ps(scratch.from[3 + c].data() + i);
+                b[c] = _mm_loadu_ps(scratch.to[3 + c].data() + i);
+            }
+            // flip b where the quaternions are more than half a turn apart
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+                                    _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+            __m128 flip = _mm_and_ps(dot, signBit);
+            __m128 t = _mm_loadu_ps(scratch.rotationT.data() + i);
+            __m128 q[4];
+            for (int c = 0; c < 4; c++)
+                q[c] = _mm_add_ps(a[c], _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b[c], flip), a[c]), t));
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], q[0]), _mm_mul_ps(q[1], q[1])),
+                                                   _mm_add_ps(_mm_mul_ps(q[2], q[2]), _mm_mul_ps(q[3], q[3]))));
+            for (int c = 0; c < 4; c++)
+                _mm_storeu_ps(pose.rotation[c].data() + i, _mm_div_ps(q[c], length));
+        }
+#endif
+        for (; i < count; i++) {
+            glm::vec4 a(scratch.from[3][i], scratch.from[4][i], scratch.from[5][i], scratch.from[6][i]);
+            glm::vec4 b(scratch.to[3][i], scratch.to[4][i], scratch.to[5][i], scratch.to[6][i]);
+            if (glm::dot(a, b) < 0.0f)
+                b = -b;
+            glm::vec4 q = a + (b - a) * scratch.rotationT[i];
+            q /= glm::length(q);
+            for (int c = 0; c < 4; c++)
+                pose.rotation[c][i] = q[c];
+        }
+    }
+};
+#endif
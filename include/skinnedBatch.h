@@ -0,0 +1,168 @@
+#ifndef SKINNED_BATCH_H
+#define SKINNED_BATCH_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "model.h"
+#include "material.h"
+#include "skeleton.h"
+#include "gpuResource.h"
+#include "jobSystem.h"
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// texture unit of the bone palette, the first one past the material units
+const unsigned int BONE_PALETTE_UNIT = MAX_MATERIAL_UNITS;
+
+// cost of each stage of the last frame of a SkinnedBatch
+struct SkinningStats {
+    unsigned int instances = 0;
+    unsigned int matrices = 0;      // palette matrices uploaded, PaletteStride() per instance
+    double sampleMs = 0.0;          // keyframe search and interpolation
+    double paletteMs = 0.0;         // joint hierarchy and skinning matrices
+    double uploadMs = 0.0;          // palette copy into the texture buffer
+    double drawMs = 0.0;            // draw call submission
+};
+
+// one animated copy of a skinned model
+struct AnimatedInstance {
+    const AnimationClip *clip = nullptr;    // of the model's skeleton, its bind pose if null
+    float time = 0.0f;                      // seconds into the clip
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
+// Draws any number of animated copies of one skinned model, one instanced draw per mesh.
+// Each frame Animate samples every instance's pose and builds its bone palette, spread over
+// the job system; Upload streams the palettes into a texture buffer; Draw binds it and draws
+// with a shader compiled with SKINNED defined (see 3.3.lighting_maps.vs), which blends the
+// palette matrices of each vertex's bones. A model without a skeleton is drawn unanimated at
+// the instance transforms. The model's meshes must live in its arena, like Model::Draw expects.
+class SkinnedBatch
+{
+public:
+    std::vector<AnimatedInstance> Instances;
+    SkinningStats Stats;
+
+    explicit SkinnedBatch(const Model &model) : model(&model)
+    {
+    }
+
+    // poses every instance and fills the palettes, timing both stages
+    void Animate(JobSystem &jobs = JobSystem::Global())
+    {
+        const Skeleton *skeleton = model->skeleton.get();
+        std::size_t stride = Stride();
+        std::size_t count = Instances.size();
+        palettes.resize(count * stride);
+        Stats.instances = static_cast<unsigned int>(count);
+        Stats.matrices = static_cast<unsigned int>(palettes.size());
+        Stats.sampleMs = Stats.paletteMs = 0.0;
+        if (!skeleton) {
+            for (std::size_t i = 0; i < count; i++)
+                palettes[i] = Instances[i].transform;
+            return;
+        }
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        poses.resize(count);
+        jobs.ParallelFor(0, count, 16, [&](std::size_t begin, std::size_t end) {
+            Skeleton::SampleScratch scratch;
+            for (std::size_t i = begin; i < end; i++) {
+                const AnimatedInstance &instance = Instances[i];
+                skeleton->SamplePose(instance.clip ? *instance.clip : skeleton->bindPose, instance.time, poses[i], scratch);
+            }
+        });
+        std::chrono::high_resolution_clock::time_point sampled = std::chrono::high_resolution_clock::now();
+        jobs.ParallelFor(0, count, 16, [&](std::size_t begin, std::size_t end) {
+            std::vector<glm::mat4> joints(skeleton->JointCount());
+            for (std::size_t i = begin; i < end; i++)
+                skeleton->ComposePalette(poses[i], Instances[i].transform, &palettes[i * stride], joints.data());
+        });
+        Stats.sampleMs = std::chrono::duration<double, std::milli>(sampled - start).count();
+        Stats.paletteMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sampled).count();
+    }
+
+    // copies the palettes built by Animate to the GPU. Call on the GL thread.
+    void Upload()
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        if (!buffer) {
+            buffer = GpuBuffer::Create("skinned batch palettes");
+            texture = GpuTexture::Create("skinned batch palettes");
+            glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, texture);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        }
+        // a matrix is four texels, one per column
+        if (palettes.size() * 4 > static_cast<std::size_t>(maxTexels) && !warned) {
+            std::cout << "WARNING::SKINNED_BATCH:: " << palettes.size() << " palette matrices exceed GL_MAX_TEXTURE_BUFFER_SIZE ("
+                      << maxTexels << " texels), instances past it are drawn wrong" << std::endl;
+            warned = true;
+        }
+        std::size_t bytes = palettes.size() * sizeof(glm::mat4);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        // orphan last frame's storage so the copy doesn't wait for draws still reading it
+        glBufferData(GL_TEXTURE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, palettes.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        buffer.SetBytes(bytes);
+        Stats.uploadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // draws every instance with the uploaded palettes; shader must be in use
+    void Draw(const Shader &shader)
+    {
+        Stats.drawMs = 0.0;
+        if (Instances.empty() || !buffer)
+            return;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        glActiveTexture(GL_TEXTURE0 + BONE_PALETTE_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        shader.setInt("bonePalette", BONE_PALETTE_UNIT);
+        shader.setInt("paletteStride", static_cast<int>(Stride()));
+
+        // bound once for an arena model, per mesh for meshes with their own buffers (see Model::draw)
+        unsigned int boundVAO = 0;
+        const Material *bound = nullptr;
+        unsigned int count = static_cast<unsigned int>(Instances.size());
+        for (unsigned int index : model->drawOrder) {
+            const Mesh &mesh = model->meshes[index];
+            if (mesh.material.get() != bound) {
+                mesh.material->Bind(shader);
+                bound = mesh.material.get();
+            }
+            if (mesh.VAO != boundVAO) {
+                glBindVertexArray(mesh.VAO);
+                boundVAO = mesh.VAO;
+            }
+            mesh.DrawElementsInstanced(count);
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        Stats.drawMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // palette matrices per instance
+    std::size_t Stride() const
+    {
+        return model->skeleton ? model->skeleton->PaletteStride() : 1;
+    }
+
+private:
+    const Model *model;
+    std::vector<JointPose> poses;
+    std::vector<glm::mat4> palettes;
+    GpuBuffer buffer;
+    GpuTexture texture;
+    GLint maxTexels = 0;
+    bool warned = false;
+};
+#endif
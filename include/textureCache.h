@@ -0,0 +1,278 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "stb_image.h"
+
+#include "material.h"
+#include "blockCompression.h"
+#include "mipmaps.h"
+#include "mappedFile.h"
+#include "hash.h"
+#include "jobSystem.h"
+#include "glExtensions.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Block compression of model textures on load. Off by default; enable it once the context
+// is known to support S3TC (see TextureCache::Supported, RGTC is core in 3.0).
+struct TextureCompressionSettings {
+    bool enabled = false;
+    // compressed mip chains of previously loaded images, keyed by their content
+    std::string cacheDirectory = "../resources/.texture-cache";
+    // print the memory of each texture before and after compression
+    bool report = true;
+    // must match stbi_set_flip_vertically_on_load (stb_image can't be asked), part of the cache key
+    bool flipped = true;
+    // totals over every texture compressed or read from the cache, mip chains included
+    std::atomic<std::size_t> uncompressedBytes{0};
+    std::atomic<std::size_t> compressedBytes{0};
+};
+
+// how the mip chain of a texture with this role is filtered: color maps are authored in
+// sRGB whether or not the scene renders gamma correct, normal maps hold unit vectors
+inline MipOptions MipOptionsFor(TextureRole role)
+{
+    MipOptions options;
+    options.srgb = role == TextureRole::DIFFUSE || role == TextureRole::EMISSIVE;
+    options.normalMap = role == TextureRole::NORMAL;
+    return options;
+}
+
+// a compressed mip chain, level N starts at data + levelOffsets[N - 1]
+struct CompressedTexture {
+    BlockFormat format = BlockFormat::NONE;
+    int width = 0;
+    int height = 0;
+    int nrComponents = 0;   // of the source image
+    std::unique_ptr<unsigned char, void(*)(void*)> data{nullptr, std::free};
+    std::size_t size = 0;
+    std::vector<std::size_t> levelOffsets;
+};
+
+// Turns image files into block compressed mip chains, going through an on-disk cache so
+// each image is decoded and encoded once; later loads only hash the file and read the cache.
+class TextureCache
+{
+public:
+    static TextureCompressionSettings& Settings()
+    {
+        static TextureCompressionSettings settings;
+        return settings;
+    }
+
+    // true if the current context can sample the S3TC formats color maps compress to
+    static bool Supported()
+    {
+        return HasGLExtension("GL_EXT_texture_compression_s3tc");
+    }
+
+    // Per role encoding: color maps BC1 (BC3 with alpha), normal maps BC5, specular and
+    // height maps BC4 (sampled through a grey swizzle, see TextureFromCompressed)
+    static BlockFormat FormatFor(TextureRole role, const unsigned char *pixels, int width, int height, int components)
+    {
+        switch (role) {
+        case TextureRole::NORMAL:
+            return BlockFormat::BC5;
+        case TextureRole::SPECULAR:
+        case TextureRole::HEIGHT:
+            return BlockFormat::BC4;
+        default:
+            return hasAlpha(pixels, width, height, components) ? BlockFormat::BC3 : BlockFormat::BC1;
+        }
+    }
+
+    // mip chain of a decoded image compressed for role
+    static CompressedTexture Compress(const unsigned char *pixels, int width, int height, int components, TextureRole role,
+            JobSystem &jobs = JobSystem::Global())
+    {
+        CompressedTexture texture;
+        texture.format = FormatFor(role, pixels, width, height, components);
+        texture.width = width;
+        texture.height = height;
+        texture.nrComponents = components;
+
+        MipChain chain = BuildMipChain(pixels, width, height, components, MipOptionsFor(role), jobs);
+        std::vector<std::vector<unsigned char>> compressed(chain.Levels());
+        for (unsigned int level = 0; level < chain.Levels(); level++) {
+            compressed[level] = CompressImage(chain.Level(level), chain.LevelWidth(level), chain.LevelHeight(level), components, texture.format, jobs);
+            texture.size += compressed[level].size();
+        }
+
+        texture.data.reset(static_cast<unsigned char*>(std::malloc(texture.size)));
+        std::size_t offset = 0;
+        for (std::size_t level = 0; level < compressed.size(); level++) {
+            if (level > 0)
+                texture.levelOffsets.push_back(offset);
+            std::memcpy(texture.data.get() + offset, compressed[level].data(), compressed[level].size());
+            offset += compressed[level].size();
+        }
+        return texture;
+    }
+
+    // compressed mip chain of an image file: from the cache, or decoded, compressed and
+    // cached. False if the file can't be read or decoded.
+    static bool Load(const std::string &filename, TextureRole role, CompressedTexture &texture, JobSystem &jobs = JobSystem::Global())
+    {
+        MappedFile file;
+        if (!file.Open(filename) || file.Size() == 0)
+            return false;
+        // the format follows from role and content, so content, role and flip identify it
+        std::uint32_t keyFields[3] = { CACHE_VERSION, static_cast<std::uint32_t>(role), Settings().flipped ? 1u : 0u };
+        std::uint64_t key = HashBytes(keyFields, sizeof(keyFields), HashBytes(file.Data(), file.Size()));
+        std::string cached = cachePath(key);
+
+        bool hit = read(cached, key, texture);
+        if (!hit) {
+            int width, height, components;
+            unsigned char *pixels = stbi_load_from_memory(reinterpret_cast<const unsigned char*>(file.Data()), static_cast<int>(file.Size()),
+                    &width, &height, &components, 0);
+            if (!pixels)
+                return false;
+            texture = Compress(pixels, width, height, components, role, jobs);
+            stbi_image_free(pixels);
+            write(cached, key, texture);
+        }
+
+        TextureCompressionSettings &settings = Settings();
+        std::size_t uncompressed = uncompressedSize(texture);
+        settings.uncompressedBytes += uncompressed;
+        settings.compressedBytes += texture.size;
+        if (settings.report) {
+            // one string per line, textures are loaded from several threads
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(2) << filename << ": " << uncompressed / (1024.0 * 1024.0) << " MB -> "
+                 << texture.size / (1024.0 * 1024.0) << " MB " << BlockFormatName(texture.format) << (hit ? " (cached)" : "") << "\n";
+            std::cout << line.str() << std::flush;
+        }
+        return true;
+    }
+
+private:
+    // 2: mip chains filtered per MipOptionsFor
+    static const std::uint32_t CACHE_VERSION = 2;
+
+    struct CacheHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t components;
+        std::uint32_t levels;
+        std::uint32_t reserved;
+        std::uint64_t size;
+    };
+
+    static bool hasAlpha(const unsigned char *pixels, int width, int height, int components)
+    {
+        if (components != 2 && components != 4)
+            return false;
+        std::size_t count = static_cast<std::size_t>(width) * height;
+        for (std::size_t i = 0; i < count; i++)
+            if (pixels[i * components + components - 1] != 255)
+                return true;
+        return false;
+    }
+
+    // what the uncompressed upload of the same chain takes (RGB is padded to RGBA by drivers)
+    static std::size_t uncompressedSize(const CompressedTexture &texture)
+    {
+        std::size_t bytesPerTexel = texture.nrComponents == 3 ? 4 : static_cast<std::size_t>(texture.nrComponents);
+        std::size_t size = 0;
+        for (std::size_t level = 0; level <= texture.levelOffsets.size(); level++)
+            size += static_cast<std::size_t>(std::max(texture.width >> level, 1)) * std::max(texture.height >> level, 1) * bytesPerTexel;
+        return size;
+    }
+
+    static std::string cachePath(std::uint64_t key)
+    {
+        std::ostringstream name;
+        name << Settings().cacheDirectory << '/' << std::hex << std::setw(16) << std::setfill('0') << key << ".btc";
+        return name.str();
+    }
+
+    static bool read(const std::string &path, std::uint64_t key, CompressedTexture &texture)
+    {
+        std::ifstream file(path, std::ios::binary);
+        CacheHeader header;
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "LBTC", 4) != 0 ||
+                header.version != CACHE_VERSION || header.key != key || header.levels == 0 || header.levels > MAX_MIP_LEVELS)
+            return false;
+
+        texture.format = static_cast<BlockFormat>(header.format);
+        texture.width = static_cast<int>(header.width);
+        texture.height = static_cast<int>(header.height);
+        texture.nrComponents = static_cast<int>(header.components);
+        texture.size = static_cast<std::size_t>(header.size);
+        texture.levelOffsets.clear();
+        std::size_t offset = 0;
+        for (std::uint32_t level = 0; level < header.levels; level++) {
+            if (level > 0)
+                texture.levelOffsets.push_back(offset);
+            offset += CompressedLevelSize(texture.format, std::max(texture.width >> level, 1), std::max(texture.height >> level, 1));
+        }
+        if (offset != texture.size)
+            return false;
+        texture.data.reset(static_cast<unsigned char*>(std::malloc(texture.size)));
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(texture.data.get()), static_cast<std::streamsize>(texture.size)));
+    }
+
+    // written to a temporary name first, so a concurrent reader never sees half a file
+    static void write(const std::string &path, std::uint64_t key, const CompressedTexture &texture)
+    {
+        makeDirectory(Settings().cacheDirectory);
+        CacheHeader header = {};
+        std::memcpy(header.magic, "LBTC", 4);
+        header.version = CACHE_VERSION;
+        header.key = key;
+        header.format = static_cast<std::uint32_t>(texture.format);
+        header.width = static_cast<std::uint32_t>(texture.width);
+        header.height = static_cast<std::uint32_t>(texture.height);
+        header.components = static_cast<std::uint32_t>(texture.nrComponents);
+        header.levels = static_cast<std::uint32_t>(texture.levelOffsets.size() + 1);
+        header.size = texture.size;
+
+        std::ostringstream temporaryName;
+        temporaryName << path << '.' << std::this_thread::get_id() << ".tmp";
+        std::string temporary = temporaryName.str();
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file || !file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+                    !file.write(reinterpret_cast<const char*>(texture.data.get()), static_cast<std::streamsize>(texture.size))) {
+                std::cout << "WARNING::TEXTURE_CACHE:: can't write " << temporary << std::endl;
+                return;
+            }
+        }
+        std::remove(path.c_str());
+        std::rename(temporary.c_str(), path.c_str());
+    }
+
+    static void makeDirectory(const std::string &path)
+    {
+#if defined(_WIN32)
+        _mkdir(path.c_str());
+#else
+        mkdir(path.c_str(), 0755);
+#endif
+    }
+};
+#endif
@@ -0,0 +1,350 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "modelData.h"
+#include "blockCompression.h"
+#include "textureUploader.h"
+#include "gpuResource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// GL formats of an imported texture: internalFormat for glTex(Compressed)Image2D and the
+// client format of uncompressed pixels
+inline void TextureFormats(BlockFormat blockFormat, int nrComponents, bool gamma, GLenum &internalFormat, GLenum &format)
+{
+    format = nrComponents == 3 ? GL_RGB : nrComponents == 4 ? GL_RGBA : GL_RED;
+    if (blockFormat == BlockFormat::BC1)
+        internalFormat = gamma ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    else if (blockFormat == BlockFormat::BC3)
+        internalFormat = gamma ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    else if (blockFormat == BlockFormat::BC4)
+        internalFormat = GL_COMPRESSED_RED_RGTC1;
+    else if (blockFormat == BlockFormat::BC5)
+        internalFormat = GL_COMPRESSED_RG_RGTC2;
+    else if (nrComponents == 3)
+        internalFormat = gamma ? GL_SRGB : GL_RGB;
+    else if (nrComponents == 4)
+        internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
+    else
+        internalFormat = GL_RED;
+}
+
+// residency totals, refreshed by every Update
+struct TextureStreamingStats {
+    std::size_t residentBytes = 0;
+    std::size_t fullBytes = 0;          // if every streamed texture had all its levels resident
+    unsigned int textures = 0;
+    // textures drawn last frame with coarser levels resident than they asked for
+    unsigned int starved = 0;
+    unsigned int missingLevels = 0;     // summed over the starved textures
+    unsigned int worstGap = 0;
+    std::size_t streamedBytes = 0;      // uploaded by the last Update
+    unsigned int evictedLevels = 0;     // over the lifetime of the streamer
+};
+
+// Keeps only the mip levels of model textures that are needed on screen resident. A texture
+// added here goes up with its small levels only (the tail, up to ResidentTailSize texels);
+// finer levels are uploaded once a draw requests them and dropped again, least recently used
+// textures first, whenever the resident levels exceed BudgetBytes. GL_TEXTURE_BASE_LEVEL
+// always points at the finest resident level, so sampling never touches missing levels.
+//
+// Requests come from the projected size of what the texture covers on screen (see
+// ScreenSize and Model::StreamTextures), issued every frame the texture is drawn. The CPU
+// keeps every texture's full mip chain to stream from (for packed models that's the mapped
+// pack, no extra copy). GL thread only.
+class TextureStreamer
+{
+public:
+    // textures are uploaded whole when false
+    bool Enabled = false;
+    // budget for all resident levels of streamed textures
+    std::size_t BudgetBytes = 128 << 20;
+    // levels this size and smaller are always resident
+    int ResidentTailSize = 128;
+    // level uploads per Update stop after this many bytes (one level may overshoot it)
+    std::size_t UploadBytesPerFrame = 8 << 20;
+
+    // creates the GL texture of an imported mip chain with its tail levels only, taking its
+    // pixels over. Returns the texture name.
+    unsigned int Add(ImportedTexture &imported)
+    {
+        StreamedTexture texture;
+        texture.width = imported.width;
+        texture.height = imported.height;
+        texture.nrComponents = imported.nrComponents;
+        texture.blockFormat = imported.format;
+        TextureFormats(imported.format, imported.nrComponents, imported.gamma, texture.internalFormat, texture.format);
+        texture.levels = static_cast<unsigned int>(imported.levelOffsets.size() + 1);
+        texture.levelOffsets.push_back(0);
+        texture.levelOffsets.insert(texture.levelOffsets.end(), imported.levelOffsets.begin(), imported.levelOffsets.end());
+        texture.tail = texture.levels - 1;
+        while (texture.tail > 0 && std::max(texture.levelWidth(texture.tail - 1), texture.levelHeight(texture.tail - 1)) <= ResidentTailSize)
+            texture.tail--;
+        texture.resident = texture.levels;
+        texture.wanted = texture.tail;
+        texture.data = std::move(imported.data);
+
+        texture.handle = GpuTexture::Create("streamed " + imported.path);
+        texture.id = texture.handle;
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(texture.levels - 1));
+        if (texture.blockFormat == BlockFormat::BC4)
+        {
+            GLint swizzle[] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+            glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+        else if (texture.blockFormat == BlockFormat::BC5)
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        while (texture.resident > texture.tail)
+            streamIn(texture);
+
+        unsigned int id = texture.id;
+        stats.fullBytes += texture.fullBytes();
+        textures.emplace(id, std::move(texture));
+        return id;
+    }
+
+    bool Contains(unsigned int id) const { return textures.count(id) != 0; }
+
+    // deletes the GL texture and the CPU copy of its levels; ignores textures not streamed
+    void Remove(unsigned int id)
+    {
+        std::unordered_map<unsigned int, StreamedTexture>::iterator found = textures.find(id);
+        if (found == textures.end())
+            return;
+        stats.residentBytes -= found->second.residentBytes();
+        stats.fullBytes -= found->second.fullBytes();
+        textures.erase(found);
+    }
+
+    // asks for the levels needed to draw texture id over screenPixels pixels (the projected
+    // diameter of the surface it covers); call every frame it's drawn
+    void Request(unsigned int id, float screenPixels)
+    {
+        std::unordered_map<unsigned int, StreamedTexture>::iterator found = textures.find(id);
+        if (found == textures.end())
+            return;
+        StreamedTexture &texture = found->second;
+        float texels = static_cast<float>(std::max(texture.width, texture.height));
+        float level = std::log2(texels / std::max(screenPixels, 1.0f));
+        unsigned int wanted = level <= 0.0f ? 0u : std::min(static_cast<unsigned int>(level), texture.tail);
+        texture.wanted = std::min(texture.wanted, wanted);
+        texture.lastUsed = frame;
+        texture.requested = true;
+    }
+
+    // streams requested levels in and evicts over budget; call once per frame, after the
+    // previous frame's requests
+    void Update()
+    {
+        stats.streamedBytes = 0;
+        stats.starved = stats.missingLevels = stats.worstGap = 0;
+
+        // neediest textures first: the ones furthest from what they asked for
+        std::vector<StreamedTexture*> needy;
+        for (std::pair<const unsigned int, StreamedTexture> &entry : textures)
+            if (entry.second.requested && entry.second.wanted < entry.second.resident)
+                needy.push_back(&entry.second);
+        std::sort(needy.begin(), needy.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+            return a->resident - a->wanted > b->resident - b->wanted;
+        });
+        for (StreamedTexture *texture : needy) {
+            // one level at a time, coarse to fine, making room from other textures
+            while (texture->wanted < texture->resident && stats.streamedBytes < UploadBytesPerFrame) {
+                std::size_t bytes = texture->levelBytes(texture->resident - 1);
+                if (!makeRoom(bytes, texture))
+                    break;
+                stats.streamedBytes += bytes;
+                streamIn(*texture);
+            }
+        }
+
+        for (std::pair<const unsigned int, StreamedTexture> &entry : textures) {
+            StreamedTexture &texture = entry.second;
+            if (texture.requested && texture.wanted < texture.resident) {
+                unsigned int gap = texture.resident - texture.wanted;
+                stats.starved++;
+                stats.missingLevels += gap;
+                stats.worstGap = std::max(stats.worstGap, gap);
+            }
+            // the next frame's draws ask again
+            texture.requested = false;
+            texture.wanted = texture.tail;
+        }
+        stats.textures = static_cast<unsigned int>(textures.size());
+        frame++;
+    }
+
+    const TextureStreamingStats& Stats() const { return stats; }
+
+    static TextureStreamer& Shared()
+    {
+        static TextureStreamer streamer;
+        return streamer;
+    }
+
+    // projected diameter in pixels of a sphere seen from position with a perspective
+    // projection of vertical field of view fovY (radians), viewportHeight pixels tall
+    static float ScreenSize(const glm::vec3 &center, float radius, const glm::vec3 &position, float fovY, float viewportHeight)
+    {
+        float distance = std::max(glm::length(center - position) - radius, 1e-3f);
+        return radius * viewportHeight / (distance * std::tan(fovY * 0.5f));
+    }
+
+private:
+    struct StreamedTexture {
+        GpuTexture handle;
+        unsigned int id = 0;
+        int width = 0;
+        int height = 0;
+        int nrComponents = 0;
+        BlockFormat blockFormat = BlockFormat::NONE;
+        GLenum internalFormat = GL_RGBA;
+        GLenum format = GL_RGBA;
+        std::unique_ptr<unsigned char, void(*)(void*)> data{nullptr, stbi_image_free};
+        std::vector<std::size_t> levelOffsets;    // of every level, [0] is 0
+        unsigned int levels = 0;
+        unsigned int tail = 0;          // levels from here on are always resident
+        unsigned int resident = 0;      // finest resident level (the texture's base level)
+        unsigned int wanted = 0;        // finest level asked for this frame
+        bool requested = false;
+        std::uint64_t lastUsed = 0;     // frame of the last request
+
+        int levelWidth(unsigned int level) const { return std::max(width >> level, 1); }
+        int levelHeight(unsigned int level) const { return std::max(height >> level, 1); }
+        std::size_t levelBytes(unsigned int level) const
+        {
+            if (blockFormat != BlockFormat::NONE)
+                return CompressedLevelSize(blockFormat, levelWidth(level), levelHeight(level));
+            return static_cast<std::size_t>(levelWidth(level)) * levelHeight(level) * nrComponents;
+        }
+        std::size_t residentBytes() const
+        {
+            std::size_t bytes = 0;
+            for (unsigned int level = resident; level < levels; level++)
+                bytes += levelBytes(level);
+            return bytes;
+        }
+        std::size_t fullBytes() const
+        {
+            std::size_t bytes = 0;
+            for (unsigned int level = 0; level < levels; level++)
+                bytes += levelBytes(level);
+            return bytes;
+        }
+    };
+
+    std::unordered_map<unsigned int, StreamedTexture> textures;
+    std::uint64_t frame = 1;
+    TextureStreamingStats stats;
+
+    // uploads the level above the finest resident one and makes it the base level
+    void streamIn(StreamedTexture &texture)
+    {
+        unsigned int level = --texture.resident;
+        int levelWidth = texture.levelWidth(level), levelHeight = texture.levelHeight(level);
+        std::size_t bytes = texture.levelBytes(level);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        if (texture.blockFormat != BlockFormat::NONE)
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), texture.internalFormat, levelWidth, levelHeight, 0,
+                    static_cast<GLsizei>(bytes), nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), texture.internalFormat, levelWidth, levelHeight, 0,
+                    texture.format, GL_UNSIGNED_BYTE, nullptr);
+
+        TextureUploader &uploader = TextureUploader::Shared();
+        TextureUploader::Staging staging = uploader.Stage(texture.data.get() + texture.levelOffsets[level], bytes);
+        if (texture.blockFormat != BlockFormat::NONE)
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levelWidth, levelHeight, texture.internalFormat,
+                    static_cast<GLsizei>(bytes), staging.Pointer(0));
+        else
+        {
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levelWidth, levelHeight, texture.format, GL_UNSIGNED_BYTE,
+                    staging.Pointer(0));
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        }
+        uploader.Submit(staging);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level));
+        stats.residentBytes += bytes;
+        texture.handle.SetBytes(texture.residentBytes());
+    }
+
+    // raises the base level past the finest resident level and frees that level's storage
+    void evict(StreamedTexture &texture)
+    {
+        unsigned int level = texture.resident++;
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(texture.resident));
+        // a zero sized image releases the level, the base level keeps the texture complete
+        if (texture.blockFormat != BlockFormat::NONE)
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), texture.internalFormat, 0, 0, 0, 0, nullptr);
+        else
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), texture.internalFormat, 0, 0, 0, texture.format, GL_UNSIGNED_BYTE, nullptr);
+        stats.residentBytes -= texture.levelBytes(level);
+        stats.evictedLevels++;
+        texture.handle.SetBytes(texture.residentBytes());
+    }
+
+    // coarsest level makeRoom may evict up to (exclusive)
+    static unsigned int evictionFloor(const StreamedTexture &texture)
+    {
+        return texture.requested ? texture.wanted : texture.tail;
+    }
+
+    // evicts until bytes more fit the budget, least recently used textures first: every
+    // level above the tail of textures not drawn last frame, and the levels finer than asked
+    // for of those that were. Levels in use are never dropped; false if that leaves no room.
+    bool makeRoom(std::size_t bytes, const StreamedTexture *keep)
+    {
+        if (stats.residentBytes + bytes <= BudgetBytes)
+            return true;
+        std::vector<StreamedTexture*> candidates;
+        for (std::pair<const unsigned int, StreamedTexture> &entry : textures)
+            if (&entry.second != keep && entry.second.resident < entry.second.tail)
+                candidates.push_back(&entry.second);
+        // don't evict anything if even evicting everything allowed wouldn't make room
+        std::size_t evictable = 0;
+        for (StreamedTexture *texture : candidates)
+            for (unsigned int level = texture->resident; level < evictionFloor(*texture); level++)
+                evictable += texture->levelBytes(level);
+        if (stats.residentBytes - evictable + bytes > BudgetBytes)
+            return false;
+
+        std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+            return a->lastUsed < b->lastUsed;
+        });
+        for (StreamedTexture *texture : candidates) {
+            unsigned int floor = evictionFloor(*texture);
+            while (texture->resident < floor && stats.residentBytes + bytes > BudgetBytes)
+                evict(*texture);
+            if (stats.residentBytes + bytes <= BudgetBytes)
+                return true;
+        }
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,202 @@
+#ifndef TEXTURE_UPLOADER_H
+#define TEXTURE_UPLOADER_H
+
+#include <glad/glad.h>
+
+#include "jobSystem.h"
+#include "gpuResource.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+// upload totals since the last ResetStats
+struct TextureUploadStats {
+    std::size_t bytes = 0;          // staged through the ring
+    unsigned int uploads = 0;
+    unsigned int stalls = 0;        // uploads that had to wait for the GPU to release ring space
+    double stallMs = 0.0;
+    double ms = 0.0;                // GL thread time spent staging and issuing uploads
+    unsigned int fallbacks = 0;     // uploads too large for the ring, passed from client memory
+
+    double MegabytesPerSecond() const { return ms > 0.0 ? bytes / (1024.0 * 1024.0) / (ms / 1000.0) : 0.0; }
+};
+
+// Streams texture data to the GPU through a ring of pixel unpack buffer memory, so
+// glTex(Sub)Image calls return without the driver copying client memory on the spot.
+// Each upload takes a region of the ring: the region is mapped unsynchronized, the pixels
+// are copied in by the job system's threads, and a fence is placed after the GL calls
+// reading from it. A region is only overwritten once its fence has signaled.
+//
+//   TextureUploader::Staging staging = uploader.Stage(pixels, size);
+//   glTexSubImage2D(..., staging.Pointer(levelOffset));
+//   uploader.Submit(staging);
+//
+// Use on the GL thread only. The buffer is created on first use and lives as long as the
+// context.
+class TextureUploader
+{
+public:
+    // one staged upload; Pointer is what the glTex*Image calls take as their data argument
+    struct Staging {
+        const unsigned char *client = nullptr;  // set when the data wasn't staged
+        std::size_t offset = 0;
+        std::size_t size = 0;
+        std::chrono::high_resolution_clock::time_point start;
+
+        const void* Pointer(std::size_t dataOffset) const
+        {
+            return client ? static_cast<const void*>(client + dataOffset) : reinterpret_cast<const void*>(offset + dataOffset);
+        }
+    };
+
+    // uploads bypass the ring when false
+    bool Enabled = true;
+    // the ring lives as long as the GL context, not reported as a leak at exit
+    bool ContextLifetime = false;
+
+    explicit TextureUploader(std::size_t capacity = 32 << 20, JobSystem &jobs = JobSystem::Global()) : capacity(capacity), jobs(jobs)
+    {
+    }
+
+    // copies size bytes of data into the ring and leaves the ring bound to
+    // GL_PIXEL_UNPACK_BUFFER; data is left where it is if the ring can't take it
+    Staging Stage(const unsigned char *data, std::size_t size)
+    {
+        Staging staging;
+        staging.start = std::chrono::high_resolution_clock::now();
+        staging.size = size;
+        if (!Enabled || size > capacity || !createBuffer()) {
+            staging.client = data;
+            stats.fallbacks += Enabled ? 1 : 0;
+            return staging;
+        }
+
+        retire(false);
+        std::size_t start = head + size <= capacity ? head : 0;
+        while (overlapsInFlight(start, size))
+            retire(true);
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(start), static_cast<GLsizeiptr>(size),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (!mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            staging.client = data;
+            stats.fallbacks++;
+            return staging;
+        }
+        // large chains are copied by every thread, the GL thread included
+        const std::size_t chunk = 1 << 20;
+        jobs.ParallelFor(0, (size + chunk - 1) / chunk, 1, [&](std::size_t begin, std::size_t end) {
+            std::size_t first = begin * chunk, last = std::min(end * chunk, size);
+            std::memcpy(static_cast<unsigned char*>(mapped) + first, data + first, last - first);
+        });
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        staging.offset = start;
+        head = (start + size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        return staging;
+    }
+
+    // call once every GL call reading the staged data has been issued
+    void Submit(const Staging &staging)
+    {
+        if (!staging.client) {
+            Region region;
+            region.begin = staging.offset;
+            region.end = staging.offset + staging.size;
+            region.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            inFlight.push_back(region);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            stats.bytes += staging.size;
+        }
+        stats.uploads++;
+        stats.ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - staging.start).count();
+    }
+
+    const TextureUploadStats& Stats() const { return stats; }
+    void ResetStats() { stats = TextureUploadStats(); }
+
+    // uploader used by the texture loading functions
+    static TextureUploader& Shared()
+    {
+        static TextureUploader uploader;
+        uploader.ContextLifetime = true;
+        return uploader;
+    }
+
+private:
+    // region starts keep the copies aligned for the mapped memory
+    static const std::size_t ALIGNMENT = 64;
+
+    struct Region {
+        std::size_t begin;
+        std::size_t end;
+        GLsync fence;
+    };
+
+    std::size_t capacity;
+    JobSystem &jobs;
+    GpuBuffer buffer;
+    std::size_t head = 0;
+    std::deque<Region> inFlight;    // oldest first
+    TextureUploadStats stats;
+
+    bool createBuffer()
+    {
+        if (buffer)
+            return true;
+        buffer = GpuBuffer::Create("texture upload ring");
+        buffer.SetBytes(capacity);
+        if (ContextLifetime)
+            buffer.MarkContextLifetime();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (glGetError() != GL_NO_ERROR) {
+            std::cout << "WARNING::TEXTURE_UPLOADER:: can't allocate a " << (capacity >> 20) << " MB pixel buffer, uploading from client memory" << std::endl;
+            buffer.Reset();
+            Enabled = false;
+            return false;
+        }
+        return true;
+    }
+
+    bool overlapsInFlight(std::size_t begin, std::size_t size) const
+    {
+        for (const Region &region : inFlight)
+            if (region.begin < begin + size && begin < region.end)
+                return true;
+        return false;
+    }
+
+    // releases the oldest region: always when wait is set (blocking until the GPU is done
+    // with it), otherwise every region whose fence has already signaled
+    void retire(bool wait)
+    {
+        while (!inFlight.empty()) {
+            Region &region = inFlight.front();
+            GLenum result = glClientWaitSync(region.fence, 0, 0);
+            if (result == GL_TIMEOUT_EXPIRED) {
+                if (!wait)
+                    return;
+                stats.stalls++;
+                std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+                do
+                    result = glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                while (result == GL_TIMEOUT_EXPIRED);
+                stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            }
+            glDeleteSync(region.fence);
+            inFlight.pop_front();
+            if (wait)
+                return;
+        }
+    }
+};
+#endif
@@ -1,6 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-unsigned int loadTexture(char const *path, bool alpha=false);
+#include "material.h"
+
+// role picks how the mip chain is filtered (see MipOptionsFor)
+unsigned int loadTexture(char const *path, bool alpha=false, TextureRole role=TextureRole::DIFFUSE);
 
 #endif // UTILS_H
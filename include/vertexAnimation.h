@@ -0,0 +1,212 @@
+#ifndef VERTEX_ANIMATION_H
+#define VERTEX_ANIMATION_H
+
+#include <glad/glad.h>
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "model.h"
+#include "material.h"
+#include "skeleton.h"
+#include "commandList.h"
+#include "gpuResource.h"
+#include "jobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// texture units of the baked frames, past the material units
+const unsigned int VAT_POSITION_UNIT = MAX_MATERIAL_UNITS;
+const unsigned int VAT_NORMAL_UNIT = MAX_MATERIAL_UNITS + 1;
+
+// One animation clip of a skinned model baked into textures: the skinned position and normal
+// of every vertex at a fixed rate, so instances play it without a skeleton on the CPU or bone
+// palettes on the GPU. A crowd then draws like static instances (one instanced draw per mesh)
+// with a shader compiled with VERTEX_ANIMATION defined (see instanced-omni-shadows.vs), which
+// fetches the vertex's two nearest frames by gl_VertexID and blends them; every instance plays
+// at its own time offset. Frames can't be blended between clips and take memory per vertex and
+// frame, so this suits many copies of a few looping clips.
+//
+// Frame f of vertex v is texel f * VertexCount + v of the textures, wrapped into rows. Vertices
+// are numbered as in the model's arena (from its first mesh's base vertex), so the model's
+// meshes should be uploaded back to back. Bake needs the vertices on the CPU (the model loaded
+// with CpuGeometry::FULL) and runs anywhere; Upload needs the GL context.
+class VertexAnimation
+{
+public:
+    unsigned int FirstVertex = 0;       // arena index of baked vertex 0
+    unsigned int VertexCount = 0;
+    unsigned int FrameCount = 0;
+    float Duration = 0.0f;              // seconds of one loop
+    double BakeMs = 0.0;
+
+    // skins every vertex of model at framesPerSecond over one loop of clip, a frame per job
+    bool Bake(const Model &model, const AnimationClip &clip, float framesPerSecond = 30.0f, JobSystem &jobs = JobSystem::Global())
+    {
+        const Skeleton *skeleton = model.skeleton.get();
+        if (!skeleton) {
+            std::cout << "ERROR::VERTEX_ANIMATION:: model has no skeleton to bake" << std::endl;
+            return false;
+        }
+        unsigned int first = UINT_MAX, last = 0;
+        for (const Mesh &mesh : model.meshes) {
+            if (!mesh.vertices) {
+                std::cout << "ERROR::VERTEX_ANIMATION:: model doesn't keep its vertices, load it with CpuGeometry::FULL" << std::endl;
+                return false;
+            }
+            first = std::min(first, static_cast<unsigned int>(mesh.range.baseVertex));
+            last = std::max(last, static_cast<unsigned int>(mesh.range.baseVertex) + mesh.range.vertexCount);
+        }
+        if (model.meshes.empty() || clip.ticksPerSecond <= 0.0f)
+            return false;
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        FirstVertex = first;
+        VertexCount = last - first;
+        Duration = clip.duration / clip.ticksPerSecond;
+        // a frame at least, evenly spread so the last one blends back into the first
+        FrameCount = std::max(1u, static_cast<unsigned int>(std::ceil(Duration * framesPerSecond)));
+        std::size_t frameTexels = VertexCount;
+        positions.assign(FrameCount * frameTexels, glm::vec4(0.0f));
+        normals.assign(FrameCount * frameTexels, glm::vec4(0.0f));
+
+        jobs.ParallelFor(0, FrameCount, 1, [&](std::size_t begin, std::size_t end) {
+            Skeleton::SampleScratch scratch;
+            JointPose pose;
+            std::vector<glm::mat4> palette(skeleton->PaletteStride());
+            std::vector<glm::mat4> joints(skeleton->JointCount());
+            for (std::size_t frame = begin; frame < end; frame++) {
+                float seconds = Duration * static_cast<float>(frame) / static_cast<float>(FrameCount);
+                skeleton->SamplePose(clip, seconds, pose, scratch);
+                skeleton->ComposePalette(pose, glm::mat4(1.0f), palette.data(), joints.data());
+                glm::vec4 *framePositions = &positions[frame * frameTexels];
+                glm::vec4 *frameNormals = &normals[frame * frameTexels];
+                for (const Mesh &mesh : model.meshes) {
+                    unsigned int base = mesh.range.baseVertex - FirstVertex;
+                    for (unsigned int i = 0; i < mesh.range.vertexCount; i++)
+                        skin(mesh.vertices[i], palette.data(), framePositions[base + i], frameNormals[base + i]);
+                }
+            }
+        });
+        BakeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return true;
+    }
+
+    // moves the baked frames into the textures and frees them on the CPU. Call on the GL thread.
+    void Upload()
+    {
+        if (positions.empty())
+            return;
+        GLint maxSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        width = std::min(maxSize, 4096);
+        std::size_t rows = (positions.size() + width - 1) / width;
+        if (rows > static_cast<std::size_t>(maxSize)) {
+            // drop the frames that don't fit, the loop gets shorter
+            unsigned int fitting = std::max(1u, static_cast<unsigned int>(static_cast<std::size_t>(maxSize) * width / VertexCount));
+            std::cout << "WARNING::VERTEX_ANIMATION:: " << FrameCount << " frames of " << VertexCount << " vertices exceed GL_MAX_TEXTURE_SIZE ("
+                      << maxSize << "), keeping " << fitting << std::endl;
+            Duration *= static_cast<float>(fitting) / static_cast<float>(FrameCount);
+            FrameCount = fitting;
+            positions.resize(static_cast<std::size_t>(FrameCount) * VertexCount);
+            normals.resize(positions.size());
+            rows = (positions.size() + width - 1) / width;
+        }
+        // the last row is padded
+        positions.resize(rows * width, glm::vec4(0.0f));
+        normals.resize(rows * width, glm::vec4(0.0f));
+
+        positionTexture = GpuTexture::Create("vertex animation positions");
+        normalTexture = GpuTexture::Create("vertex animation normals");
+        uploadTexture(positionTexture, GL_RGBA32F, positions, static_cast<GLsizei>(rows));
+        // normals only need a direction, half floats halve the fetch bandwidth
+        uploadTexture(normalTexture, GL_RGBA16F, normals, static_cast<GLsizei>(rows));
+        positionTexture.SetBytes(positions.size() * sizeof(glm::vec4));
+        normalTexture.SetBytes(normals.size() * sizeof(glm::vec4) / 2);
+        std::vector<glm::vec4>().swap(positions);
+        std::vector<glm::vec4>().swap(normals);
+    }
+
+    bool Ready() const { return positionTexture != 0; }
+
+    // records the textures and the layout uniforms for shader; time (seconds) is added to every
+    // instance's own offset
+    void Record(CommandList &list, const Shader &shader, float time) const
+    {
+        list.BindTexture(VAT_POSITION_UNIT, GL_TEXTURE_2D, positionTexture);
+        list.BindTexture(VAT_NORMAL_UNIT, GL_TEXTURE_2D, normalTexture);
+        list.SetInt(shader, "vatPositions", VAT_POSITION_UNIT);
+        list.SetInt(shader, "vatNormals", VAT_NORMAL_UNIT);
+        list.SetInt(shader, "vatWidth", width);
+        list.SetInt(shader, "vatFirstVertex", static_cast<int>(FirstVertex));
+        list.SetInt(shader, "vatVertices", static_cast<int>(VertexCount));
+        list.SetInt(shader, "vatFrames", static_cast<int>(FrameCount));
+        list.SetFloat(shader, "vatDuration", Duration);
+        list.SetFloat(shader, "vatTime", time);
+    }
+
+    // same as Record, straight away; shader must be in use
+    void Bind(const Shader &shader, float time) const
+    {
+        glActiveTexture(GL_TEXTURE0 + VAT_POSITION_UNIT);
+        glBindTexture(GL_TEXTURE_2D, positionTexture);
+        glActiveTexture(GL_TEXTURE0 + VAT_NORMAL_UNIT);
+        glBindTexture(GL_TEXTURE_2D, normalTexture);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("vatPositions", VAT_POSITION_UNIT);
+        shader.setInt("vatNormals", VAT_NORMAL_UNIT);
+        shader.setInt("vatWidth", width);
+        shader.setInt("vatFirstVertex", static_cast<int>(FirstVertex));
+        shader.setInt("vatVertices", static_cast<int>(VertexCount));
+        shader.setInt("vatFrames", static_cast<int>(FrameCount));
+        shader.setFloat("vatDuration", Duration);
+        shader.setFloat("vatTime", time);
+    }
+
+private:
+    std::vector<glm::vec4> positions;   // FrameCount * VertexCount, until Upload
+    std::vector<glm::vec4> normals;
+    GLint width = 0;                    // texels per row
+    GpuTexture positionTexture;
+    GpuTexture normalTexture;
+
+    // the vertex blended by its bones like 3.3.lighting_maps.vs does, palette slot 0 for
+    // vertices without weights
+    static void skin(const Vertex &vertex, const glm::mat4 *palette, glm::vec4 &position, glm::vec4 &normal)
+    {
+        glm::mat4 blended = palette[0];
+        float total = 0.0f;
+        for (int k = 0; k < MAX_BONE_INFLUENCE; k++)
+            total += vertex.m_Weights[k];
+        if (total > 0.0f) {
+            blended = glm::mat4(0.0f);
+            for (int k = 0; k < MAX_BONE_INFLUENCE; k++)
+                if (vertex.m_Weights[k] > 0.0f)
+                    blended += palette[vertex.m_BoneIDs[k] + 1] * vertex.m_Weights[k];
+        }
+        position = blended * glm::vec4(vertex.Position, 1.0f);
+        glm::vec3 direction = glm::mat3(glm::transpose(glm::inverse(blended))) * vertex.Normal;
+        float length = glm::length(direction);
+        normal = glm::vec4(length > 0.0f ? direction / length : vertex.Normal, 0.0f);
+    }
+
+    static void uploadTexture(GLuint texture, GLenum internalFormat, const std::vector<glm::vec4> &texels, GLsizei rows)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, static_cast<GLsizei>(texels.size() / rows), rows, 0, GL_RGBA, GL_FLOAT, texels.data());
+        // fetched texel by texel, no filtering or mipmaps
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+#endif
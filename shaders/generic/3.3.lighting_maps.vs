@@ -2,17 +2,48 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#if defined(INSTANCED)
+// per-instance model matrix, filled by the InstanceBatcher or read at each IndirectBatch
+// command's baseInstance
+layout (location = 7) in mat4 instanceMatrix;
+#elif defined(SKINNED)
+// up to 4 bones per vertex, unused slots have weight 0
+layout (location = 5) in ivec4 aBoneIds;
+layout (location = 6) in vec4 aBoneWeights;
+// bone palettes of every instance back to back, filled by the SkinnedBatch. A matrix is 4
+// RGBA32F texels (its columns); slot 0 of a palette is the instance's model matrix, bone N
+// is slot N + 1.
+uniform samplerBuffer bonePalette;
+uniform int paletteStride;
+
+mat4 paletteMatrix(int slot)
+{
+    int texel = (gl_InstanceID * paletteStride + slot) * 4;
+    return mat4(texelFetch(bonePalette, texel), texelFetch(bonePalette, texel + 1),
+                texelFetch(bonePalette, texel + 2), texelFetch(bonePalette, texel + 3));
+}
+#else
+uniform mat4 model;
+#endif
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
+#if defined(INSTANCED)
+    mat4 model = instanceMatrix;
+#elif defined(SKINNED)
+    // blend the posed bone matrices, vertices without weights follow the instance
+    mat4 model = paletteMatrix(0);
+    if (dot(aBoneWeights, vec4(1.0)) > 0.0)
+        model = aBoneWeights.x * paletteMatrix(aBoneIds.x + 1) + aBoneWeights.y * paletteMatrix(aBoneIds.y + 1)
+              + aBoneWeights.z * paletteMatrix(aBoneIds.z + 1) + aBoneWeights.w * paletteMatrix(aBoneIds.w + 1);
+#endif
     FragPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(transpose(inverse(model))) * aNormal;  
     TexCoords = aTexCoords;
@@ -0,0 +1,43 @@
+// playback of animations baked into vertex animation textures (see VertexAnimation), included
+// by the instanced shaders. Declares nothing without VERTEX_ANIMATION.
+#ifdef VERTEX_ANIMATION
+// seconds into the baked clip of each instance
+layout (location = 7) in float instanceTime;
+
+// frames of every vertex, texel frame * vatVertices + vertex wrapped into rows of vatWidth
+uniform sampler2D vatPositions;
+uniform sampler2D vatNormals;
+uniform int vatWidth;
+uniform int vatFirstVertex;
+uniform int vatVertices;
+uniform int vatFrames;
+uniform float vatDuration;
+uniform float vatTime;
+
+ivec2 vatTexel(int frame)
+{
+    int texel = frame * vatVertices + gl_VertexID - vatFirstVertex;
+    return ivec2(texel % vatWidth, texel / vatWidth);
+}
+
+// texels of the two baked frames around this instance's time, the last one blending into
+// the first, and how far between them it is
+void vatBlend(out ivec2 a, out ivec2 b, out float blend)
+{
+    float frame = fract((vatTime + instanceTime) / vatDuration) * float(vatFrames);
+    int current = min(int(frame), vatFrames - 1);
+    a = vatTexel(current);
+    b = vatTexel((current + 1) % vatFrames);
+    blend = frame - float(current);
+}
+
+vec3 vatPosition(ivec2 a, ivec2 b, float blend)
+{
+    return mix(texelFetch(vatPositions, a, 0).xyz, texelFetch(vatPositions, b, 0).xyz, blend);
+}
+
+vec3 vatNormal(ivec2 a, ivec2 b, float blend)
+{
+    return normalize(mix(texelFetch(vatNormals, a, 0).xyz, texelFetch(vatNormals, b, 0).xyz, blend));
+}
+#endif
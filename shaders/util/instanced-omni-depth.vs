@@ -1,8 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 3) in mat4 instanceMatrix;
+#include "../include/vertex-animation.glsl"
 
 void main()
 {
-    gl_Position = instanceMatrix * vec4(aPos, 1.0);
+    vec3 position = aPos;
+#ifdef VERTEX_ANIMATION
+    ivec2 a, b;
+    float blend;
+    vatBlend(a, b, blend);
+    position = vatPosition(a, b, blend);
+#endif
+    gl_Position = instanceMatrix * vec4(position, 1.0);
 }
@@ -1,55 +0,0 @@
-#version 330 core
-out vec4 FragColor;
-
-in VS_OUT {
-    vec3 FragPos;
-    vec3 Normal;
-    vec2 TexCoords;
-} fs_in;
-
-uniform sampler2D diffuseTexture;
-uniform samplerCube depthMap;
-
-uniform vec3 lightPos;
-uniform vec3 viewPos;
-
-uniform float far_plane;
-uniform bool shadows;
-uniform bool soft;
-
-float ShadowCalculation(vec3 fragPos)
-{
-    vec3 fragToLight = fragPos - lightPos;
-    float currentDepth = length(fragToLight);
-    float shadow = 0.0;
-    float bias = 0.05;
-        float closestDepth = texture(depthMap, fragToLight).r;
-        closestDepth *= far_plane;
-        shadow = currentDepth -  bias > closestDepth ? 1.0 : 0.0;        
-        // display closestDepth as debug (to visualize depth cubemap)
-        // FragColor = vec4(vec3(closestDepth / far_plane), 1.0);    
-        
-    return shadow;
-}
-
-void main()
-{           
-    vec3 color = texture(diffuseTexture, fs_in.TexCoords).rgb;
-    vec3 normal = normalize(fs_in.Normal);
-    vec3 lightColor = vec3(0.3);
-    vec3 ambient = 0.3 * lightColor;
-    vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * lightColor;
-    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = 0.0;
-    vec3 halfwayDir = normalize(lightDir + viewDir);  
-    spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
-    vec3 specular = spec * lightColor;    
-    float shadow = shadows ? ShadowCalculation(fs_in.FragPos) : 0.0;                      
-    vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
-    
-    FragColor = vec4(lighting, 1.0);
-}
-
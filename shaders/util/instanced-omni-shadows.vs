@@ -3,6 +3,7 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in mat4 instanceMatrix;
+#include "../include/vertex-animation.glsl"
 
 out vec2 TexCoords;
 
@@ -17,9 +18,18 @@ uniform mat4 view;
 
 void main()
 {
-    vs_out.FragPos = vec3(instanceMatrix * vec4(aPos, 1.0));
-    vs_out.Normal = transpose(inverse(mat3(instanceMatrix))) * aNormal;
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+#ifdef VERTEX_ANIMATION
+    ivec2 a, b;
+    float blend;
+    vatBlend(a, b, blend);
+    position = vatPosition(a, b, blend);
+    normal = vatNormal(a, b, blend);
+#endif
+    vs_out.FragPos = vec3(instanceMatrix * vec4(position, 1.0));
+    vs_out.Normal = transpose(inverse(mat3(instanceMatrix))) * normal;
     vs_out.TexCoords = aTexCoords;
-    gl_Position = projection * view * instanceMatrix * vec4(aPos, 1.0);
+    gl_Position = projection * view * instanceMatrix * vec4(position, 1.0);
 }
 
@@ -8,54 +8,12 @@ in VS_OUT {
 } fs_in;
 
 uniform sampler2D diffuseTexture;
-uniform samplerCube depthMap;
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
-uniform float far_plane;
-uniform bool shadows;
-uniform bool soft;
-
-float ShadowCalculation(vec3 fragPos)
-{
-    vec3 fragToLight = fragPos - lightPos;
-    float currentDepth = length(fragToLight);
-    float shadow = 0.0;
-    float bias = 0.05;
-    if (!soft) {
-        float closestDepth = texture(depthMap, fragToLight).r;
-        closestDepth *= far_plane;
-        shadow = currentDepth -  bias > closestDepth ? 1.0 : 0.0;        
-        // display closestDepth as debug (to visualize depth cubemap)
-        // FragColor = vec4(vec3(closestDepth / far_plane), 1.0);    
-    } else {
-        vec3 sampleOffsetDirections[20] = vec3[]
-        (
-           vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-           vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-           vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-           vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-           vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-        );
-        bias   = 0.15;
-        int samples  = 20;
-        float viewDistance = length(viewPos - fragPos);
-        // adjust sharpness based on distance
-        float diskRadius = (1.0 + (viewDistance / far_plane)) / 25.0;
-        for(int i = 0; i < samples; ++i)
-        {
-            float closestDepth = texture(depthMap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
-            closestDepth *= far_plane;   // undo mapping [0;1]
-            if(currentDepth - bias > closestDepth)
-                shadow += 1.0;
-        }
-
-        shadow /= float(samples);  
-    }
-        
-    return shadow;
-}
+// shadows and their filtering are compile-time: define SHADOWS and SOFT_SHADOWS
+#include "../include/omni-shadows.glsl"
 
 void main()
 {           
@@ -67,12 +25,11 @@ void main()
     float diff = max(dot(lightDir, normal), 0.0);
     vec3 diffuse = diff * lightColor;
     vec3 viewDir = normalize(viewPos - fs_in.FragPos);
-    vec3 reflectDir = reflect(-lightDir, normal);
     float spec = 0.0;
     vec3 halfwayDir = normalize(lightDir + viewDir);  
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
-    float shadow = shadows ? ShadowCalculation(fs_in.FragPos) : 0.0;                      
+    float shadow = ShadowCalculation(fs_in.FragPos, lightPos, viewPos);                      
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
     
     FragColor = vec4(lighting, 1.0);
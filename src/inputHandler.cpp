@@ -54,4 +54,10 @@ void processInput(GLFWwindow *window, Camera &camera, InputState &inputState, fl
         inputState.jHeld = false;
         inputState.drawDebugLine = true;
     }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS)
+        inputState.mHeld = true;
+    if (inputState.mHeld && glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
+        inputState.mHeld = false;
+        inputState.dumpMemoryReport = true;
+    }
 }
@@ -4,21 +4,33 @@
 #include "../include/model.h"
 #include "../include/shader.h"
 #include "../include/camera.h"
+#include "../include/asteroidField.h"
+#include "../include/commandList.h"
+#include "../include/jobSystem.h"
+#include "../include/modelStreamer.h"
+#include "../include/textureCache.h"
+#include "../include/vertexAnimation.h"
+#include "../include/hotReload.h"
 
 #include "../include/inputHandler.h"
 #include "../include/utils.h"
 
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
 // callbacks
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 // utility functions
-void renderProofScene(const Shader &shader);
-void renderCube();
-std::vector<glm::mat4> getOmniViews(glm::mat4 &shadowProjection, glm::vec3 &lightPos);
-void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 color);
+void recordProofScene(CommandList &list, const Shader &shader, unsigned int VAO);
+unsigned int getCubeVAO();
+void releaseCubeVAO();
+glm::mat4 getOmniView(const glm::mat4 &shadowProjection, const glm::vec3 &lightPos, unsigned int face);
+void setPointLight(CommandList &list, const Shader &shader, int index, glm::vec3 position, glm::vec3 color);
 
 // settings
 unsigned int SCR_WIDTH = 1600;
@@ -39,7 +51,7 @@ float lastFrame = 0.0f;
 // input
 InputState inputState;
 
-int main()
+int main(int argc, char *argv[])
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -79,86 +91,90 @@ int main()
         return -1;
     }
 
+    // block compress model textures (cached on disk) unless started with --uncompressed;
+    // run both ways to compare texture memory and GPU frame time
+    bool uncompressed = argc > 1 && std::string(argv[1]) == "--uncompressed";
+    TextureCache::Settings().enabled = TextureCache::Supported() && !uncompressed;
+    // model textures keep only the mip levels the camera needs resident, within 128 MB
+    TextureStreamer::Shared().Enabled = true;
+
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
     // build and compile shaders
     // -------------------------
-    Shader planetShader("../shaders/generic/3.3.lighting_maps.vs", "../shaders/generic/instanced-lighting-maps.fs");
-    Shader asteroidsShader("../shaders/generic/instanced-lighting-maps.vs", "../shaders/generic/blinn-phong.fs");
-    Shader lightCubeShader("../shaders/generic/3.3.light_cube.vs", "../shaders/generic/3.3.light_cube_materials.fs");
-    Shader instancedOmniDepthShader("../shaders/util/instanced-omni-depth.vs", "../shaders/util/instanced-omni-depth.gs", "../shaders/util/instanced-omni-depth.fs");
-    Shader instancedOmniShadowShader("../shaders/util/instanced-omni-shadows.vs", "../shaders/util/instanced-omni-shadows.fs");
-    Shader omniDepthShader("../shaders/util/omni-sm-depth.vs", "../shaders/util/omni-sm-depth.gs", "../shaders/util/omni-sm-depth.fs");
-    Shader omniShadowShader("../shaders/util/omni-shadow-map.vs", "../shaders/util/omni-shadow-map.fs");
-
-    unsigned int woodTexture = loadTexture("../resources/textures/wood-floor/wood-floor.jpg");
+    // every program is queued in one batch, the driver compiles them while the models load
+    std::chrono::high_resolution_clock::time_point compileStart = std::chrono::high_resolution_clock::now();
+    ShaderBatch shaders;
+    Shader planetShader("../shaders/generic/3.3.lighting_maps.vs", "", "../shaders/generic/instanced-lighting-maps.fs", "", shaders);
+    Shader asteroidsShader("../shaders/generic/instanced-lighting-maps.vs", "", "../shaders/generic/blinn-phong.fs", "", shaders);
+    Shader lightCubeShader("../shaders/generic/3.3.light_cube.vs", "", "../shaders/generic/3.3.light_cube_materials.fs", "", shaders);
+    ShaderVariants instancedOmniDepthVariants("../shaders/util/instanced-omni-depth.vs", "../shaders/util/instanced-omni-depth.gs", "../shaders/util/instanced-omni-depth.fs");
+    Shader &instancedOmniDepthShader = instancedOmniDepthVariants.Get(ShaderDefines(), &shaders);
+    // hard shadows are compiled into the shadow receivers instead of switched by uniforms;
+    // instanced receivers only swap the vertex shader, the lighting is shared
+    ShaderVariants instancedOmniShadowVariants("../shaders/util/instanced-omni-shadows.vs", "", "../shaders/util/omni-shadow-map.fs");
+    Shader &instancedOmniShadowShader = instancedOmniShadowVariants.Get(ShaderDefines().Set("SHADOWS"), &shaders);
+    Shader omniDepthShader("../shaders/util/omni-sm-depth.vs", "../shaders/util/omni-sm-depth.gs", "../shaders/util/omni-sm-depth.fs", "", shaders);
+    ShaderVariants omniShadowVariants("../shaders/util/omni-shadow-map.vs", "", "../shaders/util/omni-shadow-map.fs");
+    Shader &omniShadowShader = omniShadowVariants.Get(ShaderDefines().Set("SHADOWS"), &shaders);
+    // the crowd plays baked animations through the asteroid shaders
+    Shader &crowdDepthShader = instancedOmniDepthVariants.Get(ShaderDefines().Set("VERTEX_ANIMATION"), &shaders);
+    Shader &crowdShadowShader = instancedOmniShadowVariants.Get(ShaderDefines().Set("SHADOWS").Set("VERTEX_ANIMATION"), &shaders);
+    std::size_t programCount = shaders.Size();
+    double queueMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - compileStart).count();
+
+    const char *woodPath = "../resources/textures/wood-floor/wood-floor.jpg";
+    GpuTexture woodTexture = GpuTexture::Adopt(loadTexture(woodPath), "wood floor");
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
     // load models
     // -----------
-    Model planet = Model("../resources/models/planet/planet.obj");
-    Model rock = Model("../resources/models/rock/rock.obj");
+    // models cooked by asset-cooker load from the pack without parsing or decoding
+    if (AssetPack::Mount("../resources/resources.pack"))
+        std::cout << "Mounted asset pack with " << AssetPack::Mounted()->EntryCount() << " entries" << std::endl;
+    // the planet streams in on the job system, a box stands in for it until it's uploaded
+    // nothing reads the geometry back on the CPU, the models only keep their bounds
+    ModelStreamer streamer;
+    streamer.KeepGeometry = CpuGeometry::NONE;
+    const std::string planetPath = "../resources/models/planet/planet.obj";
+    ModelHandle planet = streamer.Request(planetPath);
+    // rocks get their own arena, its VAO carries the instance matrix attributes
+    MeshArena rockArena;
+    Model rock = Model("../resources/models/rock/rock.obj", false, &rockArena, CpuGeometry::NONE);
+    // so does the crowd; its vertices stay on the CPU to bake the animation from
+    MeshArena crowdArena;
+    Model dancer = Model("../resources/models/vampire/dancing_vampire.dae", false, &crowdArena, CpuGeometry::FULL);
 
     // generate a large list of semi-random model transformation matrices
     // ------------------------------------------------------------------
 
-    unsigned int amount = 100000; // Total number of asteroids
-    unsigned int rings = 7; // Number of rings
-    unsigned int asteroidsPerRing = amount / rings; // Distribute asteroids evenly across the rings
+    AsteroidField field;
+    field.amount = 100000; // Total number of asteroids
+    field.rings = 7; // Number of rings
+    field.seed = static_cast<unsigned int>(glfwGetTime()); // random seed
+    unsigned int amount = field.amount;
 
     glm::mat4* modelMatrices;
     modelMatrices = new glm::mat4[amount];
-    srand(static_cast<unsigned int>(glfwGetTime())); // initialize random seed
-
-    float baseRadius = 150.0; // Base radius for the innermost ring
-    float ringSpacing = 90.0f; // Space between each ring
-    float offset = 25.0f; // Random offset for each asteroid within a ring
-
-    for (unsigned int ring = 0; ring < rings; ring++) {
-        float currentRadius = baseRadius + ringSpacing * ring; // Calculate radius for the current ring
-
-        for (unsigned int i = 0; i < asteroidsPerRing; i++) {
-            unsigned int index = ring * asteroidsPerRing + i; // Calculate the index in the modelMatrices array
-            glm::mat4 model = glm::mat4(1.0f);
-
-            // 1. Translation: displace along circle with 'currentRadius' in range [-offset, offset]
-            float angle = (float)i / (float)asteroidsPerRing * 360.0f;
-            float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float x = sin(glm::radians(angle)) * currentRadius + displacement;
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float y = displacement * 0.4f; // Keep height of asteroid field smaller compared to width of x and z
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float z = cos(glm::radians(angle)) * currentRadius + displacement;
-            model = glm::translate(model, glm::vec3(x, y, z));
-
-            // 2. Scale: Scale between 0.05 and 0.25f
-            float scale = static_cast<float>((rand() % 20) / 100.0 + 0.05);
-            model = glm::scale(model, glm::vec3(scale));
-
-            // 3. Rotation: add random rotation around a (semi)randomly picked rotation axis vector
-            float rotAngle = static_cast<float>((rand() % 360));
-            model = glm::rotate(model, glm::radians(rotAngle), glm::vec3(0.4f, 0.6f, 0.8f));
-
-            // 4. Now add to list of matrices
-            modelMatrices[index] = model;
-        }
-    }
+    // every matrix is independent, generate them on all cores
+    GenerateAsteroidMatrices(field, modelMatrices);
 
     // configure instanced array
     // -------------------------
-    unsigned int buffer;
-    glGenBuffers(1, &buffer);
+    GpuBuffer buffer = GpuBuffer::Create("asteroid matrices");
     glBindBuffer(GL_ARRAY_BUFFER, buffer);
     glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
+    buffer.SetBytes(amount * sizeof(glm::mat4));
 
-    for (unsigned int i = 0; i < rock.meshes.size(); i++)
-    {
-        unsigned int VAO = rock.meshes[i].VAO;
-        glBindVertexArray(VAO);
+    // when the arena grows it points the Vertex attributes, locations 3..6 included, at its new
+    // vertex buffer, so this runs again whenever the rocks are reloaded
+    auto bindRockInstances = [&]() {
+        glBindVertexArray(rockArena.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
         glEnableVertexAttribArray(3);
         glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
         glEnableVertexAttribArray(4);
@@ -174,8 +190,64 @@ int main()
         glVertexAttribDivisor(6, 1);
 
         glBindVertexArray(0);
+    };
+    bindRockInstances();
+
+    // bake the dancer's first animation and scatter copies of it over a grid under the planet,
+    // each at its own point of the clip. Drawn like the rocks: one instanced draw per mesh.
+    // ----------------------------------------------------------------------------------------
+    VertexAnimation crowdAnimation;
+    auto bakeCrowd = [&]() {
+        crowdAnimation = VertexAnimation();
+        if (dancer.skeleton && !dancer.skeleton->animations.empty() && crowdAnimation.Bake(dancer, dancer.skeleton->animations[0])) {
+            crowdAnimation.Upload();
+            std::cout << "Baked " << crowdAnimation.FrameCount << " frames of " << crowdAnimation.VertexCount << " vertices in "
+                      << crowdAnimation.BakeMs << " ms" << std::endl;
+        }
+        else
+            std::cout << "WARNING::MAIN:: the dancer has no animation to bake, the crowd is left out" << std::endl;
+    };
+    bakeCrowd();
+
+    struct CrowdInstance {
+        glm::mat4 transform;
+        float time;
+    };
+    const unsigned int crowdSide = 100;
+    const unsigned int crowdAmount = crowdSide * crowdSide;
+    std::vector<CrowdInstance> crowd(crowdAmount);
+    std::mt19937 crowdRandom(field.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (unsigned int i = 0; i < crowdAmount; i++) {
+        float x = (static_cast<float>(i % crowdSide) - crowdSide * 0.5f) * 2.0f;
+        float z = (static_cast<float>(i / crowdSide) - crowdSide * 0.5f) * 2.0f;
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, -40.0f, z));
+        transform = glm::rotate(transform, unit(crowdRandom) * glm::radians(360.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        crowd[i].transform = glm::scale(transform, glm::vec3(0.5f));
+        crowd[i].time = unit(crowdRandom) * crowdAnimation.Duration;
     }
 
+    GpuBuffer crowdBuffer = GpuBuffer::Create("crowd instances");
+    glBindBuffer(GL_ARRAY_BUFFER, crowdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, crowdAmount * sizeof(CrowdInstance), crowd.data(), GL_STATIC_DRAW);
+    crowdBuffer.SetBytes(crowdAmount * sizeof(CrowdInstance));
+
+    // same instance matrix attributes as the rocks, plus each dancer's time offset
+    auto bindCrowdInstances = [&]() {
+        glBindVertexArray(crowdArena.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, crowdBuffer);
+        for (unsigned int i = 0; i < 4; i++) {
+            glEnableVertexAttribArray(3 + i);
+            glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance), (void*)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(3 + i, 1);
+        }
+        glEnableVertexAttribArray(7);
+        glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(CrowdInstance), (void*)offsetof(CrowdInstance, time));
+        glVertexAttribDivisor(7, 1);
+        glBindVertexArray(0);
+    };
+    bindCrowdInstances();
+
     // light cube vertex data
     float lightCubeVertices[] = {
         -1.0f, -1.0f, -1.0f, 
@@ -216,9 +288,9 @@ int main()
         1.0f, -1.0f,  1.0f
     };
 
-    unsigned int lightCubeVBO, lightCubeVAO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glGenBuffers(1, &lightCubeVBO);
+    GpuVertexArray lightCubeVAO = GpuVertexArray::Create("light cube");
+    GpuBuffer lightCubeVBO = GpuBuffer::Create("light cube");
+    lightCubeVBO.SetBytes(sizeof(lightCubeVertices));
     glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(lightCubeVertices), lightCubeVertices, GL_STATIC_DRAW);
     glBindVertexArray(lightCubeVAO);
@@ -229,9 +301,9 @@ int main()
     camera.Position = glm::vec3(100.0f, 50.0f, camera.Position.y);
 
     // FBO depth map
-    unsigned int depthCubemap, depthMapFBO;
-    glGenTextures(1, &depthCubemap);
+    GpuTexture depthCubemap = GpuTexture::Create("omni shadow map");
     const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT= 1024;
+    depthCubemap.SetBytes(6 * SHADOW_WIDTH * SHADOW_HEIGHT * sizeof(float));
     glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
     for (unsigned int i = 0; i < 6; ++i)
         glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
@@ -242,7 +314,7 @@ int main()
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    glGenFramebuffers(1, &depthMapFBO);
+    GpuFramebuffer depthMapFBO = GpuFramebuffer::Create("omni shadow map");
     glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
     glDrawBuffer(GL_NONE);
@@ -251,17 +323,88 @@ int main()
         std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    instancedOmniShadowShader.use();
-    instancedOmniShadowShader.setInt("depthMap", 1);
-
-    omniShadowShader.use();
-    omniShadowShader.setInt("diffuseTexture", 0);
-    omniShadowShader.setInt("depthMap", 1);
+    // everything below sets uniforms, the programs have to be done
+    std::chrono::high_resolution_clock::time_point finishStart = std::chrono::high_resolution_clock::now();
+    shaders.Finish();
+    std::cout << "Queued " << programCount << " shader programs in " << queueMs << " ms, waited "
+              << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - finishStart).count()
+              << " ms for the rest (" << shaders.Failed << " failed)" << std::endl;
+
+    // samplers are only set once per program, and again on the program hot reload swaps in
+    auto setShadowSamplers = [](Shader &shader) {
+        shader.use();
+        shader.setInt("diffuseTexture", 0);
+        shader.setInt("depthMap", 1);
+    };
+    setShadowSamplers(instancedOmniShadowShader);
+    setShadowSamplers(crowdShadowShader);
+    setShadowSamplers(omniShadowShader);
+
+    // no specular map on the planet: sample the diffuse unit (see Material::Bind)
+    auto setPlanetSamplers = [](Shader &shader) {
+        shader.use();
+        shader.setInt("texture_diffuse1", 0);
+        shader.setInt("texture_specular1", 0);
+    };
+    setPlanetSamplers(planetShader);
+
+    // saving a shader, texture or model reloads it in place while the program runs
+    HotReload reload;
+    reload.Watch(planetShader, setPlanetSamplers);
+    reload.Watch(asteroidsShader);
+    reload.Watch(lightCubeShader);
+    reload.Watch(instancedOmniDepthShader);
+    reload.Watch(instancedOmniShadowShader, setShadowSamplers);
+    reload.Watch(omniDepthShader);
+    reload.Watch(omniShadowShader, setShadowSamplers);
+    reload.Watch(crowdDepthShader);
+    reload.Watch(crowdShadowShader, setShadowSamplers);
+    reload.Watch(planet, planetPath);
+    // loaded before stb_image was told to flip, so it reloads unflipped too
+    reload.Watch(woodPath, [&]() {
+        stbi_set_flip_vertically_on_load_thread(false);
+        woodTexture = GpuTexture::Adopt(loadTexture(woodPath), "wood floor");
+        stbi_set_flip_vertically_on_load_thread(true);
+    });
+    reload.Watch(rock, "../resources/models/rock/rock.obj", [&](Model&) { bindRockInstances(); });
+    // the crowd's frames are baked from the dancer's vertices, bake them again
+    reload.Watch(dancer, "../resources/models/vampire/dancing_vampire.dae", [&](Model&) {
+        bakeCrowd();
+        bindCrowdInstances();
+    });
+
+    // per frame command recording: one list per shadow cube face plus one per pass.
+    // Worker threads fill them without a GL context, the GL thread only replays them.
+    JobSystem &jobs = JobSystem::Global();
+    CommandReplayer replayer;
+    CommandList faceLists[6];
+    CommandList shadowList, mainList, postList;
+    std::vector<const CommandList*> frameLists;
+    for (unsigned int i = 0; i < 6; ++i)
+        frameLists.push_back(&faceLists[i]);
+    frameLists.push_back(&shadowList);
+    frameLists.push_back(&mainList);
+    frameLists.push_back(&postList);
+
+    // the proof cube is created up front, recording can't allocate GL objects
+    unsigned int proofCubeVAO = getCubeVAO();
+
+    // GL thread time per frame, averaged over a few seconds
+    double glThreadTime = 0.0;
+    double replayTime = 0.0;
+    unsigned int timedFrames = 0;
+    float lastReport = 0.0f;
+    // GPU time of the replayed frame; two queries so reading last frame's never stalls
+    unsigned int gpuTimers[2];
+    glGenQueries(2, gpuTimers);
+    double gpuTime = 0.0;
+    unsigned int frameIndex = 0;
 
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
     {
+        std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
@@ -272,152 +415,250 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glm::vec3 dirColor = glm::vec3(1.0f);
-        glm::vec3 pointLightPos = glm::vec3(cos(glfwGetTime()) * 150.0f, 10.0f, sin(glfwGetTime()) * 150.0f);
+        glm::vec3 pointLightPos = glm::vec3(cos(currentFrame) * 150.0f, 10.0f, sin(currentFrame) * 150.0f);
         // glm::vec3 pointLightPos = glm::vec3(150.0f, 10.0f, 50.0f);
 
-        // fill depth cubemap
-        // ------------------
         float shadowAspect = (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT;
         float SHADOW_NEAR = 1.0f;
         float SHADOW_FAR = 100.0f;
         glm::mat4 shadowProjection = glm::perspective(glm::radians(90.0f), shadowAspect, SHADOW_NEAR, SHADOW_FAR);
-        std::vector<glm::mat4> shadowTransforms = getOmniViews(shadowProjection, pointLightPos);
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        instancedOmniDepthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            instancedOmniDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-        instancedOmniDepthShader.setFloat("far_plane", SHADOW_FAR);
-        instancedOmniDepthShader.setVec3("lightPos", pointLightPos);
-        for (unsigned int i = 0; i < rock.meshes.size(); ++i) {
-            glBindVertexArray(rock.meshes[i].VAO); 
-            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rock.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, amount);
-            glBindVertexArray(0);
-        }
-        // proof cube
-        omniDepthShader.use();
-        for (unsigned int i = 0; i < 6; ++i)
-            omniDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-        omniDepthShader.setFloat("far_plane", SHADOW_FAR);
-        omniDepthShader.setVec3("lightPos", pointLightPos);
-        renderProofScene(omniDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // render asteroids
-        // ----------------
+
         float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        instancedOmniShadowShader.use();
-        instancedOmniShadowShader.setMat4("projection", projection);
-        instancedOmniShadowShader.setMat4("view", view);
-        instancedOmniShadowShader.setVec3("lightPos", pointLightPos);
-        instancedOmniShadowShader.setVec3("viewPos", camera.Position);
-        instancedOmniShadowShader.setInt("shadows", true);
-        instancedOmniShadowShader.setInt("soft", false);
-        instancedOmniShadowShader.setFloat("far_plane", SHADOW_FAR);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, rock.textures_loaded[0].id);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-        for (unsigned int i = 0; i < rock.meshes.size(); ++i) {
-            glBindVertexArray(rock.meshes[i].VAO); 
-            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rock.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, amount);
-            glBindVertexArray(0);
-        }
 
-        // render proof cube
+        glm::mat4 planetTransform = glm::mat4(1.0f);
+        planetTransform = glm::translate(planetTransform, glm::vec3(0.0f, -3.0f, 0.0f));
+        planetTransform = glm::scale(planetTransform, glm::vec3(4.0f));
+
+        // upload streamed models within this frame's budget, before anything records them
+        streamer.Update();
+        // swap in reloaded shaders and assets, likewise before recording
+        reload.Update();
+        for (unsigned int program : reload.Retired)
+            replayer.Forget(program);
+
+        // stream texture levels for last frame's requests, then request this frame's: the
+        // planet's from its size on screen, the rocks' from the largest rock at the closest
+        // point of the field (bounded from the rings, scanning every rock would cost more)
+        TextureStreamer::Shared().Update();
+        if (planet.Ready())
+            planet.Get()->StreamTextures(planetTransform, camera.Position, glm::radians(camera.Zoom), (float)SCR_HEIGHT);
+        glm::mat4 nearestRock = glm::translate(glm::mat4(1.0f), AsteroidFieldClosestPoint(field, camera.Position));
+        nearestRock = glm::scale(nearestRock, glm::vec3(ASTEROID_MAX_SCALE));
+        rock.StreamTextures(nearestRock, camera.Position, glm::radians(camera.Zoom), (float)SCR_HEIGHT);
+
+        JobGroup recording;
+
+        // shadow cube faces
         // -----------------
-        omniShadowShader.use();
-        omniShadowShader.setMat4("projection", projection);
-        omniShadowShader.setMat4("view", view);
-        omniShadowShader.setVec3("lightPos", pointLightPos);
-        omniShadowShader.setVec3("viewPos", camera.Position);
-        omniShadowShader.setInt("shadows", true);
-        omniShadowShader.setInt("soft", false);
-        omniShadowShader.setFloat("far_plane", SHADOW_FAR);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-        renderProofScene(omniShadowShader);
-
-        // render planet
-        // -------------
-        planetShader.use();
-        planetShader.setVec3("viewPos", camera.Position);
-        // direction lighting
-        planetShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        planetShader.setVec3("dirLight.ambient", dirColor * 0.0f);
-        planetShader.setVec3("dirLight.diffuse", dirColor * 0.1f);
-        planetShader.setVec3("dirLight.specular", dirColor * 0.5f);
-        planetShader.setFloat("shininess", 16.0f);
-        // point lighting
-        setPointLight(planetShader, 0, pointLightPos, glm::vec3(1.0f));
-        // transform matrices
-        planetShader.setMat4("projection", projection);
-        planetShader.setMat4("view", view);
-        planetShader.setInt("texture_diffuse1", 0);
-        planetShader.setInt("texture_specular1", 0);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(4.0f));
-        planetShader.setMat4("model", model);
-        planet.Draw(planetShader);
+        for (unsigned int face = 0; face < 6; ++face) {
+            jobs.Run(recording, [&, face] {
+                CommandList &list = faceLists[face];
+                list.Reset();
+                glm::mat4 shadowTransform = getOmniView(shadowProjection, pointLightPos, face);
+                std::string name = "shadowMatrices[" + std::to_string(face) + "]";
+                list.SetMat4(instancedOmniDepthShader, name, shadowTransform);
+                list.SetMat4(omniDepthShader, name, shadowTransform);
+                list.SetMat4(crowdDepthShader, name, shadowTransform);
+            });
+        }
+
+        // fill depth cubemap
+        // ------------------
+        jobs.Run(recording, [&] {
+            CommandList &list = shadowList;
+            list.Reset();
+            list.Viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+            list.BindFramebuffer(depthMapFBO);
+            list.Clear(GL_DEPTH_BUFFER_BIT);
+            list.SetFloat(instancedOmniDepthShader, "far_plane", SHADOW_FAR);
+            list.SetVec3(instancedOmniDepthShader, "lightPos", pointLightPos);
+            list.DrawModelInstanced(rock, instancedOmniDepthShader, rockArena.VAO, amount);
+            // crowd
+            if (crowdAnimation.Ready()) {
+                list.SetFloat(crowdDepthShader, "far_plane", SHADOW_FAR);
+                list.SetVec3(crowdDepthShader, "lightPos", pointLightPos);
+                crowdAnimation.Record(list, crowdDepthShader, currentFrame);
+                list.DrawModelInstanced(dancer, crowdDepthShader, crowdArena.VAO, crowdAmount);
+            }
+            // proof cube
+            list.SetFloat(omniDepthShader, "far_plane", SHADOW_FAR);
+            list.SetVec3(omniDepthShader, "lightPos", pointLightPos);
+            recordProofScene(list, omniDepthShader, proofCubeVAO);
+            list.BindFramebuffer(0);
+        });
+
+        // main pass
+        // ---------
+        jobs.Run(recording, [&] {
+            CommandList &list = mainList;
+            list.Reset();
+            list.Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+            // render asteroids
+            list.SetMat4(instancedOmniShadowShader, "projection", projection);
+            list.SetMat4(instancedOmniShadowShader, "view", view);
+            list.SetVec3(instancedOmniShadowShader, "lightPos", pointLightPos);
+            list.SetVec3(instancedOmniShadowShader, "viewPos", camera.Position);
+            list.SetFloat(instancedOmniShadowShader, "far_plane", SHADOW_FAR);
+            list.BindTexture(0, GL_TEXTURE_2D, rock.textures_loaded[0].id);
+            list.BindTexture(1, GL_TEXTURE_CUBE_MAP, depthCubemap);
+            list.DrawModelInstanced(rock, instancedOmniShadowShader, rockArena.VAO, amount);
+
+            // render crowd
+            if (crowdAnimation.Ready()) {
+                list.SetMat4(crowdShadowShader, "projection", projection);
+                list.SetMat4(crowdShadowShader, "view", view);
+                list.SetVec3(crowdShadowShader, "lightPos", pointLightPos);
+                list.SetVec3(crowdShadowShader, "viewPos", camera.Position);
+                list.SetFloat(crowdShadowShader, "far_plane", SHADOW_FAR);
+                list.BindTexture(1, GL_TEXTURE_CUBE_MAP, depthCubemap);
+                crowdAnimation.Record(list, crowdShadowShader, currentFrame);
+                // the dancer has several materials, each part gets its own diffuse map
+                list.DrawModelInstanced(dancer, crowdShadowShader, crowdArena.VAO, crowdAmount, true);
+            }
+
+            // render proof cube
+            list.SetMat4(omniShadowShader, "projection", projection);
+            list.SetMat4(omniShadowShader, "view", view);
+            list.SetVec3(omniShadowShader, "lightPos", pointLightPos);
+            list.SetVec3(omniShadowShader, "viewPos", camera.Position);
+            list.SetFloat(omniShadowShader, "far_plane", SHADOW_FAR);
+            list.BindTexture(0, GL_TEXTURE_2D, woodTexture);
+            list.BindTexture(1, GL_TEXTURE_CUBE_MAP, depthCubemap);
+            recordProofScene(list, omniShadowShader, proofCubeVAO);
+
+            // render planet (once streamed in)
+            if (planet.Ready()) {
+                list.SetVec3(planetShader, "viewPos", camera.Position);
+                // direction lighting
+                list.SetVec3(planetShader, "dirLight.direction", glm::vec3(-0.2f, -1.0f, -0.3f));
+                list.SetVec3(planetShader, "dirLight.ambient", dirColor * 0.0f);
+                list.SetVec3(planetShader, "dirLight.diffuse", dirColor * 0.1f);
+                list.SetVec3(planetShader, "dirLight.specular", dirColor * 0.5f);
+                list.SetFloat(planetShader, "shininess", 16.0f);
+                // point lighting
+                setPointLight(list, planetShader, 0, pointLightPos, glm::vec3(1.0f));
+                // transform matrices
+                list.SetMat4(planetShader, "projection", projection);
+                list.SetMat4(planetShader, "view", view);
+                list.SetMat4(planetShader, "model", planetTransform);
+                list.DrawModel(*planet.Get(), planetShader);
+            }
+        });
 
         // render light cube
         // -----------------
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
-        lightCubeShader.setVec3("LSCol", glm::vec3(1.0f));
-        glBindVertexArray(lightCubeVAO);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(pointLightPos));
-        model = glm::scale(model, glm::vec3(0.2f));
-        lightCubeShader.setMat4("model", model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        jobs.Run(recording, [&] {
+            CommandList &list = postList;
+            list.Reset();
+            list.SetMat4(lightCubeShader, "projection", projection);
+            list.SetMat4(lightCubeShader, "view", view);
+            // planet placeholder while it's still loading
+            if (planet.HasBounds() && !planet.Ready()) {
+                list.SetVec3(lightCubeShader, "LSCol", glm::vec3(0.2f));
+                list.SetMat4(lightCubeShader, "model", planetTransform * planet.PlaceholderTransform());
+                list.DrawArrays(lightCubeShader, lightCubeVAO, GL_TRIANGLES, 0, 36);
+            }
+            list.SetVec3(lightCubeShader, "LSCol", glm::vec3(1.0f));
+            glm::mat4 model = glm::mat4(1.0f);
+            model = glm::translate(model, glm::vec3(pointLightPos));
+            model = glm::scale(model, glm::vec3(0.2f));
+            list.SetMat4(lightCubeShader, "model", model);
+            list.DrawArrays(lightCubeShader, lightCubeVAO, GL_TRIANGLES, 0, 36);
+        });
+
+        // the GL thread helps recording, then replays the lists in pass order
+        jobs.Wait(recording);
+        std::chrono::high_resolution_clock::time_point replayStart = std::chrono::high_resolution_clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, gpuTimers[frameIndex % 2]);
+        replayer.Replay(frameLists);
+        glEndQuery(GL_TIME_ELAPSED);
+        std::chrono::high_resolution_clock::time_point frameEnd = std::chrono::high_resolution_clock::now();
+        if (frameIndex > 0) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(gpuTimers[(frameIndex + 1) % 2], GL_QUERY_RESULT, &elapsed);
+            gpuTime += elapsed / 1e6;
+        }
+        frameIndex++;
+
+        glThreadTime += std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        replayTime += std::chrono::duration<double, std::milli>(frameEnd - replayStart).count();
+        timedFrames++;
+        if (currentFrame - lastReport > 5.0f) {
+            std::cout << "GL thread: " << glThreadTime / timedFrames << " ms/frame (replay " << replayTime / timedFrames
+                      << " ms, " << replayer.PacketsReplayed << " commands, " << jobs.WorkerCount() << " workers), GPU: "
+                      << gpuTime / timedFrames << " ms/frame" << std::endl;
+            TextureCompressionSettings &compression = TextureCache::Settings();
+            if (compression.enabled)
+                std::cout << "Textures: " << compression.compressedBytes / (1024.0 * 1024.0) << " MB block compressed ("
+                          << compression.uncompressedBytes / (1024.0 * 1024.0) << " MB uncompressed)" << std::endl;
+            const TextureStreamingStats &residency = TextureStreamer::Shared().Stats();
+            std::cout << "Texture residency: " << residency.residentBytes / (1024.0 * 1024.0) << " of " << residency.fullBytes / (1024.0 * 1024.0)
+                      << " MB, " << residency.starved << " of " << residency.textures << " textures below the requested level ("
+                      << residency.missingLevels << " levels missing, worst gap " << residency.worstGap << "), "
+                      << residency.evictedLevels << " levels evicted" << std::endl;
+            TextureUploader &uploader = TextureUploader::Shared();
+            if (uploader.Stats().uploads > 0) {
+                const TextureUploadStats &uploads = uploader.Stats();
+                std::cout << "Texture uploads: " << uploads.uploads << " (" << uploads.bytes / (1024.0 * 1024.0) << " MB at "
+                          << uploads.MegabytesPerSecond() << " MB/s, " << uploads.stalls << " stalls / " << uploads.stallMs << " ms, "
+                          << uploads.fallbacks << " unstaged)" << std::endl;
+                uploader.ResetStats();
+            }
+            glThreadTime = replayTime = gpuTime = 0.0;
+            timedFrames = 0;
+            lastReport = currentFrame;
+        }
+
+        // M: dump the GPU memory of every tracked resource
+        if (inputState.dumpMemoryReport) {
+            GpuResources::Get().Report();
+            inputState.dumpMemoryReport = false;
+        }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    // everything still alive is released with the context; whatever outlives main is leaked
+    // models free their textures through GL, while the context is still current
+    rock.Release();
+    dancer.Release();
+    if (planet.Ready())
+        planet.Get()->Release();
+    releaseCubeVAO();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
 
-std::vector<glm::mat4> getOmniViews(glm::mat4 &shadowProjection, glm::vec3 &lightPos) {
-        std::vector<glm::mat4> shadowTransforms;
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)));
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)));
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0)));
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0,-1.0, 0.0), glm::vec3(0.0, 0.0,-1.0)));
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0, 1.0), glm::vec3(0.0,-1.0, 0.0)));
-        shadowTransforms.push_back(shadowProjection * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0,-1.0), glm::vec3(0.0,-1.0, 0.0)));
-
-        return shadowTransforms;
+glm::mat4 getOmniView(const glm::mat4 &shadowProjection, const glm::vec3 &lightPos, unsigned int face) {
+        // look direction and up vector of each cube map face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order
+        static const glm::vec3 directions[6] = {
+                glm::vec3( 1.0, 0.0, 0.0), glm::vec3(-1.0, 0.0, 0.0), glm::vec3( 0.0, 1.0, 0.0),
+                glm::vec3( 0.0,-1.0, 0.0), glm::vec3( 0.0, 0.0, 1.0), glm::vec3( 0.0, 0.0,-1.0)
+        };
+        static const glm::vec3 ups[6] = {
+                glm::vec3( 0.0,-1.0, 0.0), glm::vec3( 0.0,-1.0, 0.0), glm::vec3( 0.0, 0.0, 1.0),
+                glm::vec3( 0.0, 0.0,-1.0), glm::vec3( 0.0,-1.0, 0.0), glm::vec3( 0.0,-1.0, 0.0)
+        };
+        return shadowProjection * glm::lookAt(lightPos, lightPos + directions[face], ups[face]);
 }
 
-void renderProofScene(const Shader &shader) {
+void recordProofScene(CommandList &list, const Shader &shader, unsigned int VAO) {
     // room cube
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(150.0f, 1.0f, 70.0f));
     model = glm::scale(model, glm::vec3(20.0f, 20.0f, 1.0f));
-    shader.setMat4("model", model);
-    renderCube();
+    list.SetMat4(shader, "model", model);
+    list.DrawArrays(shader, VAO, GL_TRIANGLES, 0, 36);
 }
 
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
-void renderCube() {
+GpuVertexArray cubeVAO;
+GpuBuffer cubeVBO;
+unsigned int getCubeVAO() {
     if (cubeVAO == 0) {
         float vertices[] = {
             // back face
@@ -463,8 +704,9 @@ void renderCube() {
             -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
             -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left      
         };
-        glGenVertexArrays(1, &cubeVAO);
-        glGenBuffers(1, &cubeVBO);
+        cubeVAO = GpuVertexArray::Create("proof cube");
+        cubeVBO = GpuBuffer::Create("proof cube");
+        cubeVBO.SetBytes(sizeof(vertices));
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
         glBindVertexArray(cubeVAO);
@@ -477,20 +719,24 @@ void renderCube() {
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    return cubeVAO;
+}
+
+// the cube's handles are globals: destroyed after main, when the leak report has already run
+void releaseCubeVAO() {
+    cubeVAO.Reset();
+    cubeVBO.Reset();
 }
 
-void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 color) { 
+void setPointLight(CommandList &list, const Shader &shader, int index, glm::vec3 position, glm::vec3 color) { 
     std::string uniform = "pointLights[" + std::to_string(index) + "].";
-    shader.setVec3(uniform + "position", position);
-    shader.setVec3(uniform + "ambient", color * glm::vec3(0.005f, 0.005f, 0.005f));
-    shader.setVec3(uniform + "diffuse", color * glm::vec3(0.8f, 0.8f, 0.8f));
-    shader.setVec3(uniform + "specular", color * glm::vec3(1.0f, 1.0f, 1.0f));
-    shader.setFloat(uniform + "constant", 0.5f);
-    shader.setFloat(uniform + "linear", 0.00009f);
-    shader.setFloat(uniform + "quadratic", 0.000032f);
+    list.SetVec3(shader, uniform + "position", position);
+    list.SetVec3(shader, uniform + "ambient", color * glm::vec3(0.005f, 0.005f, 0.005f));
+    list.SetVec3(shader, uniform + "diffuse", color * glm::vec3(0.8f, 0.8f, 0.8f));
+    list.SetVec3(shader, uniform + "specular", color * glm::vec3(1.0f, 1.0f, 1.0f));
+    list.SetFloat(shader, uniform + "constant", 0.5f);
+    list.SetFloat(shader, uniform + "linear", 0.00009f);
+    list.SetFloat(shader, uniform + "quadratic", 0.000032f);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
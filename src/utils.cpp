@@ -1,10 +1,14 @@
 #include "../include/utils.h"
 #include <glad/glad.h>
 #include "../include/stb_image.h"
+#include "../include/mipmaps.h"
+#include "../include/textureCache.h"
+#include "../include/textureUploader.h"
 
+#include <algorithm>
 #include <iostream>
 
-unsigned int loadTexture(char const *path, bool alpha)
+unsigned int loadTexture(char const *path, bool alpha, TextureRole role)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
@@ -21,9 +25,23 @@ unsigned int loadTexture(char const *path, bool alpha)
         else if (nrComponents == 4)
             format = GL_RGBA;
 
+        // mip levels are filtered on the job system instead of glGenerateMipmap, in linear
+        // space for color maps
+        MipChain chain = BuildMipChain(data, width, height, nrComponents, MipOptionsFor(role));
+
+        // allocate the levels, then fill them from the upload ring
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        for (unsigned int level = 0; level < chain.Levels(); level++)
+            glTexImage2D(GL_TEXTURE_2D, level, format, chain.LevelWidth(level), chain.LevelHeight(level), 0, format, GL_UNSIGNED_BYTE, nullptr);
+        TextureUploader &uploader = TextureUploader::Shared();
+        TextureUploader::Staging staging = uploader.Stage(chain.data.get(), chain.size);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (unsigned int level = 0; level < chain.Levels(); level++)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, chain.LevelWidth(level), chain.LevelHeight(level), format, GL_UNSIGNED_BYTE,
+                    staging.Pointer(chain.offsets[level]));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        uploader.Submit(staging);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, chain.Levels() - 1);
 
         if (alpha) {
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -0,0 +1,126 @@
+// Cooks models and their textures into a single asset pack (see include/assetPack.h) that
+// the scenes mount at startup: meshes already converted to the Vertex layout, textures
+// decoded with their whole mip chain. Needs no window or GL context.
+//
+// usage: asset-cooker [-o pack] [-t threads] [-c] [model ...]
+//
+// -c stores textures block compressed (per role, as TextureCache does at runtime); only
+// use such packs on GL implementations with S3TC.
+//
+// Model paths are stored exactly as given and looked up with the path the scenes pass to
+// Model, so cook from the directory the scenes run in. Re-run after changing a resource.
+
+#include "../include/assetPack.h"
+#include "../include/modelLoader.h"
+#include "../include/jobSystem.h"
+#include "../include/textureCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    std::string output = "../resources/resources.pack";
+    unsigned int threads = JobSystem::AUTO_WORKERS;
+    bool compress = false;
+    std::vector<ModelRequest> requests;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (argument == "-t" && i + 1 < argc)
+            threads = static_cast<unsigned int>(std::max(std::atoi(argv[++i]) - 1, 0));
+        else if (argument == "-c")
+            compress = true;
+        else
+            requests.push_back({ argument });
+    }
+    // the models the scenes load
+    if (requests.empty()) {
+        requests = {
+            { "../resources/models/planet/planet.obj" },
+            { "../resources/models/rock/rock.obj" },
+            { "../resources/models/backpack/backpack.obj" },
+            { "../resources/models/japanese-lamp/JapaneseLamp.obj" },
+            { "../resources/models/tile-floor/tile-floor.obj" },
+            { "../resources/models/tile-ball/tile-ball.obj" }
+        };
+    }
+
+    // same flip as the scenes, the pixels are stored as they will be uploaded
+    stbi_set_flip_vertically_on_load(true);
+    JobSystem jobs(threads);
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    std::vector<ModelData> imported = ImportModels(requests, jobs);
+
+    AssetPackWriter writer;
+    std::size_t textureCount = 0;
+    for (std::size_t i = 0; i < requests.size(); i++) {
+        const ModelData &data = imported[i];
+        if (!data.valid) {
+            std::cout << "ERROR::ASSET_COOKER:: skipping " << requests[i].path << std::endl;
+            continue;
+        }
+        // packs hold no skeletons, skinned models keep loading through their source file
+        if (data.skeleton) {
+            std::cout << "WARNING::ASSET_COOKER:: " << requests[i].path << " is skinned, not cooked" << std::endl;
+            continue;
+        }
+        writer.AddModel(requests[i].path, data);
+
+        // textures shared between models are stored once
+        std::vector<const ImportedTexture*> pending;
+        for (const ImportedTexture &texture : data.textures)
+            if (texture.data && !writer.Contains(data.directory + '/' + texture.path))
+                pending.push_back(&texture);
+        std::vector<std::vector<std::vector<unsigned char>>> chains(pending.size());
+        std::vector<BlockFormat> formats(pending.size(), BlockFormat::NONE);
+        jobs.ParallelFor(0, pending.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t = begin; t < end; t++) {
+                const ImportedTexture &texture = *pending[t];
+                if (!compress) {
+                    // the import already built the mip chain, split it into levels
+                    for (std::size_t level = 0; level <= texture.levelOffsets.size(); level++) {
+                        std::size_t levelBegin = level == 0 ? 0 : texture.levelOffsets[level - 1];
+                        std::size_t size = static_cast<std::size_t>(std::max(texture.width >> level, 1)) *
+                                std::max(texture.height >> level, 1) * texture.nrComponents;
+                        chains[t].emplace_back(texture.data.get() + levelBegin, texture.data.get() + levelBegin + size);
+                    }
+                    continue;
+                }
+                // split the compressed chain back into levels
+                CompressedTexture compressed = TextureCache::Compress(texture.data.get(), texture.width, texture.height,
+                        texture.nrComponents, texture.role, jobs);
+                formats[t] = compressed.format;
+                std::vector<std::size_t> offsets(1, 0);
+                offsets.insert(offsets.end(), compressed.levelOffsets.begin(), compressed.levelOffsets.end());
+                offsets.push_back(compressed.size);
+                for (std::size_t level = 0; level + 1 < offsets.size(); level++)
+                    chains[t].emplace_back(compressed.data.get() + offsets[level], compressed.data.get() + offsets[level + 1]);
+            }
+        });
+        for (std::size_t t = 0; t < pending.size(); t++) {
+            writer.AddTexture(data.directory + '/' + pending[t]->path, pending[t]->width, pending[t]->height,
+                    pending[t]->nrComponents, chains[t], formats[t]);
+            textureCount++;
+        }
+        std::cout << "  " << requests[i].path << ": " << data.meshes.size() << " meshes, " << data.textures.size() << " textures" << std::endl;
+    }
+
+    if (!writer.Write(output))
+        return 1;
+
+    // read it back the way the scenes will
+    AssetPack pack;
+    if (!pack.Open(output) || !pack.Verify())
+        return 1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "wrote " << output << ": " << pack.EntryCount() << " entries (" << textureCount << " textures), "
+              << std::fixed << std::setprecision(1) << pack.Size() / (1024.0 * 1024.0) << " MB in " << ms << " ms" << std::endl;
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include "../include/model.h"
 #include "../include/shader.h"
 #include "../include/camera.h"
+#include "../include/asteroidField.h"
 
 #include "../include/inputHandler.h"
 
@@ -90,53 +91,25 @@ int main()
 
     // load models
     // -----------
-    Model planet = Model("../resources/models/planet/planet.obj");
-    Model rock = Model("../resources/models/rock/rock.obj");
+    // nothing reads the geometry back on the CPU, the models only keep their bounds
+    Model planet = Model("../resources/models/planet/planet.obj", false, &MeshArena::Shared(), CpuGeometry::NONE);
+    // rocks get their own arena, its VAO carries the instance matrix attributes
+    MeshArena rockArena;
+    Model rock = Model("../resources/models/rock/rock.obj", false, &rockArena, CpuGeometry::NONE);
 
     // generate a large list of semi-random model transformation matrices
     // ------------------------------------------------------------------
 
-    unsigned int amount = 300000; // Total number of asteroids
-    unsigned int rings = 7; // Number of rings
-    unsigned int asteroidsPerRing = amount / rings; // Distribute asteroids evenly across the rings
+    AsteroidField field;
+    field.amount = 300000; // Total number of asteroids
+    field.rings = 7; // Number of rings
+    field.seed = static_cast<unsigned int>(glfwGetTime()); // random seed
+    unsigned int amount = field.amount;
 
     glm::mat4* modelMatrices;
     modelMatrices = new glm::mat4[amount];
-    srand(static_cast<unsigned int>(glfwGetTime())); // initialize random seed
-
-    float baseRadius = 150.0; // Base radius for the innermost ring
-    float ringSpacing = 90.0f; // Space between each ring
-    float offset = 25.0f; // Random offset for each asteroid within a ring
-
-    for (unsigned int ring = 0; ring < rings; ring++) {
-        float currentRadius = baseRadius + ringSpacing * ring; // Calculate radius for the current ring
-
-        for (unsigned int i = 0; i < asteroidsPerRing; i++) {
-            unsigned int index = ring * asteroidsPerRing + i; // Calculate the index in the modelMatrices array
-            glm::mat4 model = glm::mat4(1.0f);
-
-            // 1. Translation: displace along circle with 'currentRadius' in range [-offset, offset]
-            float angle = (float)i / (float)asteroidsPerRing * 360.0f;
-            float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float x = sin(glm::radians(angle)) * currentRadius + displacement;
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float y = displacement * 0.4f; // Keep height of asteroid field smaller compared to width of x and z
-            displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-            float z = cos(glm::radians(angle)) * currentRadius + displacement;
-            model = glm::translate(model, glm::vec3(x, y, z));
-
-            // 2. Scale: Scale between 0.05 and 0.25f
-            float scale = static_cast<float>((rand() % 20) / 100.0 + 0.05);
-            model = glm::scale(model, glm::vec3(scale));
-
-            // 3. Rotation: add random rotation around a (semi)randomly picked rotation axis vector
-            float rotAngle = static_cast<float>((rand() % 360));
-            model = glm::rotate(model, glm::radians(rotAngle), glm::vec3(0.4f, 0.6f, 0.8f));
-
-            // 4. Now add to list of matrices
-            modelMatrices[index] = model;
-        }
-    }
+    // every matrix is independent, generate them on all cores
+    GenerateAsteroidMatrices(field, modelMatrices);
 
     // configure instanced array
     // -------------------------
@@ -146,30 +119,26 @@ int main()
     glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
 
     // set transformation matrices as an instance vertex attribute (with divisor 1)
-    // note: we're cheating a little by taking the, now publicly declared, VAO of the model's mesh(es) and adding new vertexAttribPointers
+    // note: we're cheating a little by taking the, publicly declared, VAO of the rock's arena and adding new vertexAttribPointers
     // normally you'd want to do this in a more organized fashion, but for learning purposes this will do.
     // -----------------------------------------------------------------------------------------------------------------------------------
-    for (unsigned int i = 0; i < rock.meshes.size(); i++)
-    {
-        unsigned int VAO = rock.meshes[i].VAO;
-        glBindVertexArray(VAO);
-        // set attribute pointers for matrix (4 times vec4)
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
-
-        glBindVertexArray(0);
-    }
+    glBindVertexArray(rockArena.VAO);
+    // set attribute pointers for matrix (4 times vec4)
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
+    glEnableVertexAttribArray(5);
+    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
+
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+    glVertexAttribDivisor(5, 1);
+    glVertexAttribDivisor(6, 1);
+
+    glBindVertexArray(0);
 
     // light cube vertex data
     float lightCubeVertices[] = {
@@ -222,6 +191,11 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    // no specular map on the planet: sample the diffuse unit (see Material::Bind)
+    planetShader.use();
+    planetShader.setInt("texture_diffuse1", 0);
+    planetShader.setInt("texture_specular1", 0);
+
     // camera properties
     camera.Position = glm::vec3(100.0f, 50.0f, camera.Position.y);
 
@@ -269,8 +243,6 @@ int main()
         // transform matrices
         planetShader.setMat4("projection", projection);
         planetShader.setMat4("view", view);
-        planetShader.setInt("texture_diffuse1", 0);
-        planetShader.setInt("texture_specular1", 0);
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
         model = glm::scale(model, glm::vec3(4.0f));
@@ -296,11 +268,10 @@ int main()
         asteroidsShader.setInt("texture_specular1", 0);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, rock.textures_loaded[0].id);
-        for (unsigned int i = 0; i < rock.meshes.size(); ++i) {
-            glBindVertexArray(rock.meshes[i].VAO); 
-            glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(rock.meshes[i].indices.size()), GL_UNSIGNED_INT, 0, amount);
-            glBindVertexArray(0);
-        }
+        glBindVertexArray(rockArena.VAO);
+        for (unsigned int i = 0; i < rock.meshes.size(); ++i)
+            rock.meshes[i].DrawElementsInstanced(amount);
+        glBindVertexArray(0);
 
         // render light cube
         // -----------------
@@ -323,6 +294,10 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    planet.Release();
+    rock.Release();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -130,6 +130,7 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -98,6 +98,7 @@ int main()
         glfwPollEvents();
     }
 
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -8,6 +8,7 @@
 #include "../include/shader.h"
 #include "../include/camera.h"
 #include "../include/model.h"
+#include "../include/indirectDraw.h"
 
 #include <iostream>
 
@@ -78,7 +79,8 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader mainShader("../shaders/3.3.lighting_maps.vs", "../shaders/3.3.models.fs");
+    // opaque models are submitted through an IndirectBatch, the model matrix is a per-draw attribute
+    Shader mainShader("../shaders/generic/3.3.lighting_maps.vs", "", "../shaders/3.3.models.fs", "#define INSTANCED\n");
     Shader skyboxShader("../shaders/skybox.vs", "../shaders/skybox.fs");
     Shader reflectionShader("../shaders/skybox-reflect.vs", "../shaders/skybox-reflect.fs");
 
@@ -117,6 +119,12 @@ int main()
 
     unsigned int skyboxID = loadCubemap(skybox_faces);
 
+    // static opaque geometry, rebuilt every frame and drawn in one call per material
+    IndirectBatch opaqueBatch;
+    // meshes tested against the view frustum this frame, reported every few seconds
+    CullStats cullStats;
+    float lastReport = 0.0f;
+
     // assign skybox vertex data
     // -------------------------
         float skyboxVertices[] = {
@@ -205,6 +213,8 @@ int main()
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
         glm::mat4 view = camera.GetViewMatrix();
+        Frustum frustum = camera.GetFrustum(projection);
+        cullStats.Reset();
 
         // light properties
         glm::vec3 dirColor = glm::vec3(1.0f, 0.7f, 0.2f);
@@ -279,48 +289,47 @@ int main()
         mainShader.setMat4("projection", projection);
         mainShader.setMat4("view", view);
 
-        // render the loaded model (backpack)
+        // queue the loaded model (backpack)
+        opaqueBatch.Clear();
         glm::mat4 model = glm::mat4(1.0f);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setMat4("model", model);
-        ourModel.Draw(mainShader);
+        opaqueBatch.Add(ourModel, model, frustum, &cullStats);
 
-        // render the loaded model (lantern)
+        // queue the loaded model (lantern)
         model = glm::mat4(1.0f);
         float angle = glfwGetTime() * glm::radians(45.0f);
         model = glm::translate(model, pointLightPositions[0]);
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
         model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-        mainShader.setMat4("model", model);
-        lantern.Draw(mainShader);
+        opaqueBatch.Add(lantern, model, frustum, &cullStats);
 
-        // render lantern to trace floors
+        // queue lantern to trace floors
         model = glm::mat4(1.0f);
         model = glm::translate(model, pointLightPositions[1]);
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setMat4("model", model);
-        lantern.Draw(mainShader);
+        opaqueBatch.Add(lantern, model, frustum, &cullStats);
 
-        // render the loaded model (floor)
+        // queue the loaded model (floor)
         glm::vec3 floorPos = glm::vec3(0.0f, -3.0f, 0.0f);
-        glm::vec3 floorDims = floor.Get0MeshDimensions();
+        glm::vec3 floorDims = floor.GetDimensions();
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, floorPos);
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setMat4("model", model);
-        floor.Draw(mainShader);
+        opaqueBatch.Add(floor, model, frustum, &cullStats);
 
-        // render multiple floors
+        // queue multiple floors
         for (unsigned int i = 0; i < floorMult; ++i) {
             model = glm::mat4(1.0f);
             model = glm::translate(model, floorPos - (glm::vec3((float)i) * glm::vec3(0.0f, 0.0f, floorDims.z)));
             model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-            mainShader.setMat4("model", model);
-            floor.Draw(mainShader);
+            opaqueBatch.Add(floor, model, frustum, &cullStats);
         }
 
+        // render the opaque pass
+        opaqueBatch.Submit(mainShader);
+
         // draw reflective sphere
         reflectionShader.use();
         model = glm::mat4(1.0f);
@@ -330,7 +339,12 @@ int main()
         reflectionShader.setMat4("view", view);
         reflectionShader.setMat4("projection", projection);
         reflectionShader.setVec3("cameraPos", camera.Position);
-        sphere.Draw(reflectionShader);
+        sphere.Draw(reflectionShader, model, frustum, &cullStats);
+
+        if (currentFrame - lastReport > 5.0f) {
+            std::cout << "Meshes visible: " << cullStats.visible << " of " << cullStats.total << " (" << cullStats.Culled() << " culled)" << std::endl;
+            lastReport = currentFrame;
+        }
 
         // draw skybox
         glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
@@ -359,6 +373,12 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    ourModel.Release();
+    lantern.Release();
+    floor.Release();
+    sphere.Release();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -419,26 +439,41 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-// loads a cubemap's textures and returns its ID
+// loads a cubemap's textures and returns its ID; the faces are decoded in parallel and
+// uploaded through the texture upload ring
 unsigned int loadCubemap(vector<std::string> faces)
 {
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrChannels;
+    struct Face {
+        unsigned char *data = nullptr;
+        int width = 0, height = 0, nrChannels = 0;
+    };
+    vector<Face> decoded(faces.size());
+    JobSystem::Global().ParallelFor(0, faces.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++)
+            decoded[i].data = stbi_load(faces[i].c_str(), &decoded[i].width, &decoded[i].height, &decoded[i].nrChannels, 3);
+    });
+
+    TextureUploader &uploader = TextureUploader::Shared();
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
+        Face &face = decoded[i];
+        if (face.data)
         {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, face.width, face.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+            TextureUploader::Staging staging = uploader.Stage(face.data, static_cast<size_t>(face.width) * face.height * 3);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, face.width, face.height, GL_RGB, GL_UNSIGNED_BYTE, staging.Pointer(0));
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            uploader.Submit(staging);
+            stbi_image_free(face.data);
         }
         else
         {
             std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
         }
     }
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -84,14 +84,18 @@ int main()
     // build and compile shaders
     // -------------------------
     Shader shader("../shaders/framebuffer.vs", "../shaders/framebuffer.fs");
-    vector<Shader> screenShader = {
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen.fs"),
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen-invert.fs"),
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen-grayscale.fs"),
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen-sharpen.fs"),
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen-blur.fs"),
-        Shader("../shaders/framebuffer-screen.vs", "../shaders/framebuffer-screen-edge.fs"),
+    // shaders own their program and can't be copied out of an initializer list
+    const char* screenFragments[] = {
+        "../shaders/framebuffer-screen.fs",
+        "../shaders/framebuffer-screen-invert.fs",
+        "../shaders/framebuffer-screen-grayscale.fs",
+        "../shaders/framebuffer-screen-sharpen.fs",
+        "../shaders/framebuffer-screen-blur.fs",
+        "../shaders/framebuffer-screen-edge.fs",
     };
+    vector<Shader> screenShader;
+    for (const char *fragment : screenFragments)
+        screenShader.emplace_back("../shaders/framebuffer-screen.vs", fragment);
     numScreenShaders = screenShader.size() - 1;
 
     // draw in wireframe
@@ -336,6 +340,7 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,45 @@
+// Wall time of importing the scene models (parsing, vertex conversion and texture decoding,
+// no GL uploads) as the number of threads grows. Needs no window or GL context.
+//
+// usage: import-bench [max threads]
+
+#include "../include/modelLoader.h"
+#include "../include/jobSystem.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    unsigned int maxThreads = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : std::max(std::thread::hardware_concurrency(), 1u);
+
+    // same files and flip setting as the scenes
+    stbi_set_flip_vertically_on_load(true);
+    std::vector<ModelRequest> requests = {
+        { "../resources/models/planet/planet.obj" },
+        { "../resources/models/rock/rock.obj" },
+        { "../resources/models/backpack/backpack.obj" },
+        { "../resources/models/japanese-lamp/JapaneseLamp.obj" },
+        { "../resources/models/tile-floor/tile-floor.obj" },
+        { "../resources/models/tile-ball/tile-ball.obj" }
+    };
+
+    std::cout << "importing " << requests.size() << " models" << std::endl;
+    double single = 0.0;
+    for (unsigned int threads = 1; threads <= maxThreads; threads++) {
+        // the calling thread works too, so one worker less than threads
+        JobSystem jobs(threads - 1);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        std::vector<ModelData> imported = ImportModels(requests, jobs);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        if (threads == 1)
+            single = ms;
+        std::cout << "  threads " << std::setw(2) << threads << ": " << std::setw(9) << std::fixed << std::setprecision(1)
+                  << ms << " ms  speedup " << std::setprecision(2) << single / ms << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Microbenchmarks for the job system: task spawn overhead and scaling of the asteroid
+// matrix generation kernel from 1 to N cores. Needs no window or GL context.
+//
+// usage: job-system-bench [asteroids] [max threads]
+
+#include "../include/jobSystem.h"
+#include "../include/asteroidField.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+double elapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// best of a few runs, the first one warms caches and wakes the workers
+template <typename Function>
+double bestOf(unsigned int runs, Function function)
+{
+    double best = 0.0;
+    for (unsigned int run = 0; run < runs; run++) {
+        Clock::time_point start = Clock::now();
+        function();
+        double ms = elapsedMs(start);
+        if (run == 0 || ms < best)
+            best = ms;
+    }
+    return best;
+}
+
+void benchSpawnOverhead(JobSystem &jobs)
+{
+    const unsigned int jobCount = 100000;
+    std::cout << "spawn overhead (" << jobs.WorkerCount() << " workers)" << std::endl;
+
+    // many empty jobs joined on one group
+    double ms = bestOf(5, [&jobs] {
+        JobGroup group;
+        for (unsigned int i = 0; i < jobCount; i++)
+            jobs.Run(group, [] {});
+        jobs.Wait(group);
+    });
+    std::cout << "  Run + Wait(group):   " << std::setw(8) << ms * 1e6 / jobCount << " ns/job" << std::endl;
+
+    // fork/join round trips, one handle per job
+    const unsigned int handleCount = 10000;
+    ms = bestOf(5, [&jobs] {
+        for (unsigned int i = 0; i < handleCount; i++)
+            jobs.Wait(jobs.Spawn([] {}));
+    });
+    std::cout << "  Spawn + Wait(handle): " << std::setw(7) << ms * 1e6 / handleCount << " ns/job" << std::endl;
+
+    // empty parallel_for, i.e. the fixed cost of splitting a range
+    ms = bestOf(5, [&jobs] {
+        for (unsigned int i = 0; i < 1000; i++)
+            jobs.ParallelFor(0, 1 << 16, 256, [](std::size_t, std::size_t) {});
+    });
+    std::cout << "  empty ParallelFor:   " << std::setw(8) << ms * 1e3 / 1000 << " us/call" << std::endl;
+}
+
+void benchMatrixScaling(unsigned int amount, unsigned int maxThreads)
+{
+    AsteroidField field;
+    field.amount = amount;
+    std::vector<glm::mat4> matrices(amount);
+
+    std::cout << "asteroid matrices (" << amount << ")" << std::endl;
+    // single core baseline without any job system involvement
+    double serial = bestOf(3, [&] {
+        for (unsigned int i = 0; i < amount; i++)
+            matrices[i] = AsteroidMatrix(field, i);
+    });
+    std::cout << "  threads  1: " << std::setw(8) << std::fixed << std::setprecision(2) << serial << " ms  speedup 1.00" << std::endl;
+
+    for (unsigned int threads = 2; threads <= maxThreads; threads++) {
+        // the calling thread works too, so one worker less than threads
+        JobSystem jobs(threads - 1);
+        double ms = bestOf(3, [&] { GenerateAsteroidMatrices(field, &matrices[0], jobs); });
+        std::cout << "  threads " << std::setw(2) << threads << ": " << std::setw(8) << ms << " ms  speedup " << serial / ms << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int amount = argc > 1 ? static_cast<unsigned int>(std::atoi(argv[1])) : 1000000;
+    unsigned int maxThreads = argc > 2 ? static_cast<unsigned int>(std::atoi(argv[2])) : std::max(std::thread::hardware_concurrency(), 1u);
+
+    benchSpawnOverhead(JobSystem::Global());
+    benchMatrixScaling(amount, maxThreads);
+    return 0;
+}
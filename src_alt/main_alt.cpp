@@ -12,11 +12,18 @@
 #include "../include/shader.h"
 #include "../include/camera.h"
 #include "../include/model.h"
+#include "../include/modelLoader.h"
+#include "../include/indirectDraw.h"
+#include "../include/instanceBatcher.h"
+#include "../include/sceneGraph.h"
+#include "../include/entityStore.h"
 
 #include "../include/inputHandler.h"
 #include "../include/utils.h"
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 
 // shaders hoisted
 bool stenBorder = false;
@@ -34,8 +41,8 @@ void renderLines(
         glm::mat4 &model);
 void updateLineVector(vector<float> &lineVertices, const unsigned int LINE_BUFFER_LIM, glm::vec3 lineBegin, glm::vec3 lineEnd, bool &lineUpdated);
 void updateLineState(vector<float> &lineVertices, vector<float> &altLineVertices, unsigned int LINE_BUFFER_LIM, bool &lineUpdated, bool &altLineUpdated);
-void handleMouseEvents(GLFWwindow *window, glm::mat4 &projection, glm::mat4 &view); 
-void iterateDetectSpheres(glm::mat4 &view, glm::mat4 &projection);
+void handleMouseEvents(GLFWwindow *window, glm::mat4 &projection, glm::mat4 &view, EntityStore &entities, const SceneGraph &scene); 
+void pickSelectables(EntityStore &entities, const SceneGraph &scene, glm::mat4 &view, glm::mat4 &projection);
 bool testRaySphereIntersect(
         const glm::vec3 &rayOrigin,
         const glm::vec3 &rayDirection,
@@ -55,22 +62,19 @@ void applyStencilBorder(
         bool applyBorder=stenBorder
         );
 void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 color);
+void setPointLights(Shader &shader, EntityStore &entities, const SceneGraph &scene);
+Entity spawnEntity(EntityStore &entities, SceneGraph &scene, SceneNode parent, const glm::mat4 &local, Model *model, unsigned int texture = 0);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
-// type defs
-struct Sphere {
-    glm::vec3 position;
-    glm::vec3 dimensions;
-    bool selected = false;
-};
-
 // settings
 unsigned int SCR_WIDTH = 1600;
 unsigned int SCR_HEIGHT = 900;
 float NEAR_PLANE = 0.1f;
 float FAR_PLANE = 1000.0f;
+// point lights the lighting shaders take (NR_POINT_LIGHTS)
+const unsigned int MAX_POINT_LIGHTS = 2;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -92,12 +96,6 @@ glm::vec3 ray_world(1.0f);
 // shaders
 bool stenReplace = false;
 
-// objects
-vector<Sphere> sphereList = {
-    { glm::vec3( 3.0f, 0.0f, -12.0f ), glm::vec3(1.0f) }, 
-    { glm::vec3( -3.0f, 0.0f, -16.0f ), glm::vec3(1.0f) }
-};
-
 int main()
 {
     // glfw: initialize and configure
@@ -143,11 +141,15 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader mainShader("../shaders/generic/3.3.lighting_maps.vs", "../shaders/3.3.models.fs");
+    ShaderVariants mainVariants("../shaders/generic/3.3.lighting_maps.vs", "", "../shaders/3.3.models.fs");
+    Shader &mainShader = mainVariants.Get(ShaderDefines());
     Shader borderShader("../shaders/utils/stencil-border.vs", "../shaders/utils/stencil-border.fs");
     Shader alphaShader("../shaders/generic/basic.vs", "../shaders/generic/alpha.fs");
     Shader blendingShader("../shaders/generic/basic.vs", "../shaders/generic/blend.fs");
     Shader lineShader("../shaders/generic/very-basic.vs", "../shaders/utils/cast-line.fs");
+    // same lighting as mainShader, model matrices come from the instance attribute: drawn by
+    // the IndirectBatch and by the InstanceBatcher for repeated models
+    Shader &staticShader = mainVariants.Get(ShaderDefines().Set("INSTANCED"));
     
     // shader properties
     // -----------------
@@ -164,10 +166,27 @@ int main()
 
     // load models
     // -----------
-    Model backpack("../resources/models/backpack/backpack.obj");
-    Model lantern("../resources/models/japanese-lamp/JapaneseLamp.obj");
-    Model floor("../resources/models/tile-floor/tile-floor.obj");
-    Model sphere("../resources/models/tile-ball/tile-ball.obj");
+    // models cooked by asset-cooker load from the pack without parsing or decoding
+    if (AssetPack::Mount("../resources/resources.pack"))
+        std::cout << "Mounted asset pack with " << AssetPack::Mounted()->EntryCount() << " entries" << std::endl;
+    // all four files import concurrently, then upload together
+    vector<ModelRequest> modelRequests = {
+        { "../resources/models/backpack/backpack.obj" },
+        { "../resources/models/japanese-lamp/JapaneseLamp.obj" },
+        { "../resources/models/tile-floor/tile-floor.obj" },
+        { "../resources/models/tile-ball/tile-ball.obj" }
+    };
+    // sphere picking is analytic, no model needs its geometry on the CPU after upload
+    for (ModelRequest &request : modelRequests)
+        request.keepGeometry = CpuGeometry::NONE;
+    ModelLoadStats loadStats;
+    vector<Model> models = LoadModels(modelRequests, &loadStats);
+    Model &backpack = models[0];
+    Model &lantern = models[1];
+    Model &floor = models[2];
+    Model &sphere = models[3];
+    std::cout << "Loaded " << models.size() << " models in " << loadStats.importMs + loadStats.uploadMs << " ms (import "
+              << loadStats.importMs << " ms on " << loadStats.threads << " threads, upload " << loadStats.uploadMs << " ms)" << std::endl;
 
     // draw in wireframe
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -226,30 +245,73 @@ int main()
     glEnableVertexAttribArray(1);
     glBindVertexArray(0);
 
-    // position all vegetation
-    // -----------------------
-    vector<glm::vec3> vegetationPositions 
-    {
+    // static floor tiles, drawn in one call per material
+    IndirectBatch floorBatch;
+    // merges repeated model draws (spheres) into instanced draws
+    InstanceBatcher batcher;
+    batcher.UseInstanced(mainShader, staticShader);
+    unsigned int mergedDraws = 0;
+    // meshes tested against the view frustum this frame
+    CullStats cullStats;
+
+    // scene entities: everything placed is a scene graph node with components saying how it
+    // is drawn, lit and picked; only the orbiting lantern moves per frame
+    // -------------------------------------------------------------------------------------
+    const unsigned int floorMult = 20;
+    SceneGraph scene;
+    EntityStore entities;
+
+    // point lights, each carried by a lantern
+    Entity orbitingLantern = spawnEntity(entities, scene, scene.Root(), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 3.5f)), &lantern);
+    entities.lights.Add(orbitingLantern);
+    Entity tracingLantern = spawnEntity(entities, scene, scene.Root(), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 5.0f, -10.0f)), &lantern);
+    entities.lights.Add(tracingLantern);
+
+    // floor tiles hang off the grid node, offset by whole tiles
+    SceneNode floorGrid = scene.Add(scene.Root(), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -3.0f, 0.0f)));
+    glm::vec3 floorDims = floor.GetDimensions();
+    vector<glm::vec3> floorOffsets = { glm::vec3(0.0f) };
+    for (unsigned int i = 0; i < floorMult; ++i) {
+        floorOffsets.push_back(glm::vec3(0.0f, 0.0f, -floorDims.z * (float)i));
+        for (unsigned int j = 1; j < floorMult / 3; ++j) {
+            // first and second lateral
+            floorOffsets.push_back(glm::vec3(floorDims.x * (float)j, 0.0f, -floorDims.z * (float)i));
+            floorOffsets.push_back(glm::vec3(-floorDims.x * (float)j, 0.0f, -floorDims.z * (float)i));
+        }
+    }
+    for (const glm::vec3 &offset : floorOffsets)
+        entities.renderables.Get(spawnEntity(entities, scene, floorGrid, glm::translate(glm::mat4(1.0f), offset), &floor)).isStatic = true;
+
+    // pickable spheres
+    vector<glm::vec3> spherePositions = {
+        glm::vec3( 3.0f, 0.0f, -12.0f ),
+        glm::vec3( -3.0f, 0.0f, -16.0f )
+    };
+    for (const glm::vec3 &position : spherePositions)
+        entities.selectables.Add(spawnEntity(entities, scene, scene.Root(), glm::translate(glm::mat4(1.0f), position), &sphere));
+
+    // vegetation, alpha tested quads
+    vector<glm::vec3> vegetationPositions = {
         glm::vec3(-1.5f, -2.3f, -0.48f),
-            glm::vec3( 1.5f, -2.3f, 0.51f),
-            glm::vec3( 0.0f, -2.3f, 0.7f),
-            glm::vec3(-0.3f, -2.3f, -2.3f),
-            glm::vec3 (0.5f, -2.3f, -0.6f)
+        glm::vec3( 1.5f, -2.3f, 0.51f),
+        glm::vec3( 0.0f, -2.3f, 0.7f),
+        glm::vec3(-0.3f, -2.3f, -2.3f),
+        glm::vec3 (0.5f, -2.3f, -0.6f)
     };
+    for (const glm::vec3 &position : vegetationPositions)
+        spawnEntity(entities, scene, scene.Root(), glm::translate(glm::mat4(1.0f), position), nullptr, grassTexture);
 
-    // position all windows
-    // ------------------------
+    // windows, blended quads
     vector<glm::vec3> windowPositions = {
         glm::vec3( 0.0f, 0.0f, -6.0f),
         glm::vec3( -4.0f, 0.0f, -9.0f),
-    };  
-
-    // position all pointlights
-    // ------------------------
-    glm::vec3 pointLightPositions[] = {
-        glm::vec3( 2.0f, 2.0f, -3.0f),
-        glm::vec3( 0.0f, 2.0f, 0.0f),
-    };  
+    };
+    for (const glm::vec3 &position : windowPositions) {
+        glm::mat4 local = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(3.0f, 5.0f, 3.0f));
+        entities.transparents.Add(spawnEntity(entities, scene, scene.Root(), local, nullptr, windowTexture));
+    }
+    // back to front order of the transparent entities, by slot
+    vector<unsigned int> blendOrder;
 
     // ImGui implementation
     // --------------------
@@ -262,8 +324,6 @@ int main()
 
     // ImGui globals
     float dirColorG[3] = { 1.0f, 1.0f, 1.0f };
-    float plc1[3] = { 1.0f, 1.0f, 1.0f };
-    float plc2[3] = { 1.0f, 1.0f, 1.0f };
 
     // render loop
     // -----------
@@ -293,115 +353,95 @@ int main()
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
+        Frustum frustum = camera.GetFrustum(projection);
+        cullStats.Reset();
 
         // light properties
         // glm::vec3 dirColor = glm::vec3(0.94f, 0.6f, 0.5f);
         glm::vec3 dirColor = glm::vec3(dirColorG[0], dirColorG[1], dirColorG[2]);
         glm::vec3 lampColor = glm::vec3(0.9f, 0.68f, 0.08f);
 
-        pointLightPositions[0].x = sin(glfwGetTime()) * 3.5f;
-        pointLightPositions[0].z = cos(glfwGetTime()) * 3.5f;
-
-        const unsigned int floorMult = 20;
-        pointLightPositions[1] = glm::vec3(0.0f, 5.0f, -10.0f);
+        // move the orbiting lantern, only its node is recomputed
+        glm::vec3 orbitPosition = glm::vec3(sin(glfwGetTime()) * 3.5f, 2.0f, cos(glfwGetTime()) * 3.5f);
+        float angle = glfwGetTime() * glm::radians(45.0f);
+        scene.SetLocal(entities.transforms.Get(orbitingLantern).node, glm::rotate(glm::translate(glm::mat4(1.0f), orbitPosition), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        scene.Update();
+
+        // the programs share the lighting uniforms (the batcher draws repeated spheres with
+        // staticShader), mainShader is left in use
+        for (Shader *shader : { &staticShader, &mainShader }) {
+            // enable shader before setting uniforms
+            shader->use();
+
+            // shader properties
+            shader->setVec3("viewPos", camera.Position);
+
+            // direction light shader
+            shader->setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+            shader->setVec3("dirLight.ambient", dirColor * 0.1f);
+            shader->setVec3("dirLight.diffuse", dirColor * 0.2f);
+            shader->setVec3("dirLight.specular", dirColor * 0.5f);
+            // point light shaders
+            setPointLights(*shader, entities, scene);
+            // spotlight shader
+            shader->setVec3("spotlight.position", camera.Position);
+            shader->setVec3("spotlight.direction", camera.Front);
+            shader->setFloat("spotlight.cutoff", glm::cos(glm::radians(12.5f)));
+            shader->setFloat("spotlight.outerCutoff", glm::cos(glm::radians(17.5f)));
+            if (inputState.flashlightOn) {
+                shader->setVec3("spotlight.ambient", 0.1f, 0.1f, 0.1f);
+                shader->setVec3("spotlight.diffuse", 0.8f, 0.8f, 0.8f);
+                shader->setVec3("spotlight.specular", 1.0f, 1.0f, 1.0f);
+            } else {
+                shader->setVec3("spotlight.ambient", glm::vec3(0.0));
+                shader->setVec3("spotlight.diffuse", glm::vec3(0.0));
+                shader->setVec3("spotlight.specular", glm::vec3(0.0));
+            }
+            shader->setFloat("spotlight.constant", 1.0f);
+            shader->setFloat("spotlight.linear", 0.09f);
+            shader->setFloat("spotlight.quadratic", 0.032f);
 
-        // enable shader before setting uniforms
-        mainShader.use();
+            // material properties
+            shader->setFloat("material.shininess", 32.0f);
+            shader->setVec3("emissiveMult", glm::vec3(0.0f));
 
-        // shader properties
-        mainShader.setVec3("viewPos", camera.Position);
-
-        // direction light shader
-        mainShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        mainShader.setVec3("dirLight.ambient", dirColor * 0.1f);
-        mainShader.setVec3("dirLight.diffuse", dirColor * 0.2f);
-        mainShader.setVec3("dirLight.specular", dirColor * 0.5f);
-        // point light shaders
-        setPointLight(mainShader, 0, pointLightPositions[0], glm::vec3(plc1[0], plc1[1], plc1[2]));
-        setPointLight(mainShader, 1, pointLightPositions[1], glm::vec3(plc2[0], plc2[1], plc2[2]));
-        // spotlight shader
-        mainShader.setVec3("spotlight.position", camera.Position);
-        mainShader.setVec3("spotlight.direction", camera.Front);
-        mainShader.setFloat("spotlight.cutoff", glm::cos(glm::radians(12.5f)));
-        mainShader.setFloat("spotlight.outerCutoff", glm::cos(glm::radians(17.5f)));
-        if (inputState.flashlightOn) {
-            mainShader.setVec3("spotlight.ambient", 0.1f, 0.1f, 0.1f);
-            mainShader.setVec3("spotlight.diffuse", 0.8f, 0.8f, 0.8f);
-            mainShader.setVec3("spotlight.specular", 1.0f, 1.0f, 1.0f);
-        } else {
-            mainShader.setVec3("spotlight.ambient", glm::vec3(0.0));
-            mainShader.setVec3("spotlight.diffuse", glm::vec3(0.0));
-            mainShader.setVec3("spotlight.specular", glm::vec3(0.0));
+            // set projection/view
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
         }
-        mainShader.setFloat("spotlight.constant", 1.0f);
-        mainShader.setFloat("spotlight.linear", 0.09f);
-        mainShader.setFloat("spotlight.quadratic", 0.032f);
-
-        // material properties
-        mainShader.setFloat("material.shininess", 32.0f);
-
-        // set projection/view
-        mainShader.setMat4("projection", projection);
-        mainShader.setMat4("view", view);
 
         // set stencil mask to not write
         glStencilMask(0x00);
 
-        // render the loaded model (lantern)
-        glm::mat4 model = glm::mat4(1.0f);
-        float angle = glfwGetTime() * glm::radians(45.0f);
-        model = glm::translate(model, pointLightPositions[0]);
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
-        mainShader.setMat4("model", model);
-        mainShader.setVec3("emissiveMult", glm::vec3(plc1[0], plc1[1], plc1[2]));
-        lantern.Draw(mainShader);
-
-        // render lantern to trace floors
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, pointLightPositions[1]);
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setMat4("model", model);
-        mainShader.setVec3("emissiveMult", glm::vec3(plc2[0], plc2[1], plc2[2]));
-        lantern.Draw(mainShader);
+        // render the lights' models (lanterns), glowing in their light's color
+        glm::mat4 model;
+        entities.lights.Each([&](Entity entity, const Light &light) {
+            const Renderable *renderable = entities.renderables.Find(entity);
+            if (!renderable || !renderable->model)
+                return;
+            const glm::mat4 &world = scene.World(entities.transforms.Get(entity).node);
+            mainShader.setMat4("model", world);
+            mainShader.setVec3("emissiveMult", light.color);
+            renderable->model->Draw(mainShader, world, frustum, &cullStats);
+        });
+        mainShader.setVec3("emissiveMult", glm::vec3(0.0f));
 
         // enable face culling for floors
         // ------------------------------
         glEnable(GL_CULL_FACE);
         glFrontFace(GL_CCW);
 
-        // render the loaded model (floor)
-        glm::vec3 floorPos = glm::vec3(0.0f, -3.0f, 0.0f);
-        glm::vec3 floorDims = floor.Get0MeshDimensions();
+        // render the static models (floor tiles)
+        const Renderable *renderables = entities.renderables.Data();
+        const Entity *renderableOwners = entities.renderables.Entities();
+        floorBatch.Clear();
+        for (std::size_t i = 0; i < entities.renderables.Size(); ++i)
+            if (renderables[i].isStatic && renderables[i].model)
+                floorBatch.Add(*renderables[i].model, scene.World(entities.transforms.Get(renderableOwners[i]).node), frustum, &cullStats);
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, floorPos);
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-        mainShader.setMat4("model", model);
-        floor.Draw(mainShader);
-
-        // render multiple floors
-        for (unsigned int i = 0; i < floorMult; ++i) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, floorPos + (glm::vec3(0.0f, 0.0f, -floorDims.z * (float)i)));
-            model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-            mainShader.setMat4("model", model);
-            floor.Draw(mainShader);
-            for (unsigned int j = 1; j < floorMult / 3; ++j) {
-                // first lateral
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, floorPos + (glm::vec3(floorDims.x * (float)j, 0.0f, -floorDims.z * (float)i)));
-                model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-                mainShader.setMat4("model", model);
-                floor.Draw(mainShader);
-                // second lateral
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, floorPos + (glm::vec3(-floorDims.x * (float)j, 0.0f, -floorDims.z * (float)i)));
-                model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-                mainShader.setMat4("model", model);
-                floor.Draw(mainShader);
-            }
-        }
+        staticShader.use();
+        floorBatch.Submit(staticShader);
+        mainShader.use();
 
         // cleanup
         glDisable(GL_CULL_FACE);
@@ -412,11 +452,16 @@ int main()
         alphaShader.setMat4("projection", projection);
         alphaShader.setMat4("view", view);
         glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, grassTexture);
-        for (unsigned int i = 0; i < vegetationPositions.size(); ++i) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, vegetationPositions[i]);
-            alphaShader.setMat4("model", model);
+        unsigned int boundTexture = 0;
+        for (std::size_t i = 0; i < entities.renderables.Size(); ++i) {
+            Entity entity = renderableOwners[i];
+            if (renderables[i].model || entities.transparents.Has(entity))
+                continue;
+            if (renderables[i].texture != boundTexture) {
+                boundTexture = renderables[i].texture;
+                glBindTexture(GL_TEXTURE_2D, boundTexture);
+            }
+            alphaShader.setMat4("model", scene.World(entities.transforms.Get(entity).node));
             glDrawArrays(GL_TRIANGLES, 0, 6);
         }
 
@@ -429,14 +474,25 @@ int main()
         model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
         applyStencilBorder(model, projection, view, glm::vec3(0.0f), mainShader, borderShader, backpack);
 
-        // render spheres
-        // --------------
-        for (unsigned int i = 0; i < sphereList.size(); ++i) {
-            model = glm::mat4(1.0f);
-            glm::vec3 scaleMod = glm::vec3(1.0f);
-            model = glm::scale(model, glm::vec3(1.0f));
-            applyStencilBorder(model, projection, view, sphereList[i].position, mainShader, borderShader, sphere, sphereList[i].selected);
+        // render the other lit models (spheres)
+        // ---------------------------------------
+        // selected ones get a border, the rest only differ by their model matrix and can be instanced
+        for (std::size_t i = 0; i < entities.renderables.Size(); ++i) {
+            Entity entity = renderableOwners[i];
+            if (!renderables[i].model || renderables[i].isStatic || entities.lights.Has(entity))
+                continue;
+            const glm::mat4 &world = scene.World(entities.transforms.Get(entity).node);
+            const Selectable *selectable = entities.selectables.Find(entity);
+            if (selectable && selectable->selected) {
+                model = glm::mat4(1.0f);
+                applyStencilBorder(model, projection, view, glm::vec3(world[3]), mainShader, borderShader, *renderables[i].model, true);
+            }
+            else
+                batcher.Draw(*renderables[i].model, mainShader, world, frustum, &cullStats);
         }
+        batcher.Flush();
+        mergedDraws = batcher.DrawsMerged;
+        mainShader.use();
 
         // render lines
         // ------------
@@ -458,26 +514,37 @@ int main()
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        // sort by distance for render ordering 
-        std::map<float, glm::vec3> sorted;
-        for (unsigned int i = 0; i < windowPositions.size(); ++i) {
-            float distance = glm::length(camera.Position - windowPositions[i]);
-            sorted[distance] = windowPositions[i];
-        }
+        // sort by distance for render ordering, the distances are computed across the job system
+        Transparent *transparents = entities.transparents.Data();
+        const Entity *transparentOwners = entities.transparents.Entities();
+        JobSystem::Global().ParallelFor(0, entities.transparents.Size(), 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                glm::vec3 position = glm::vec3(scene.World(entities.transforms.Get(transparentOwners[i]).node)[3]);
+                transparents[i].distance = glm::length(camera.Position - position);
+            }
+        });
+        blendOrder.resize(entities.transparents.Size());
+        std::iota(blendOrder.begin(), blendOrder.end(), 0u);
+        std::sort(blendOrder.begin(), blendOrder.end(), [&](unsigned int a, unsigned int b) {
+            return transparents[a].distance > transparents[b].distance;
+        });
 
         // setup shader props
         blendingShader.use();
         blendingShader.setMat4("projection", projection);
         blendingShader.setMat4("view", view);
         glBindVertexArray(transparentVAO);
-        glBindTexture(GL_TEXTURE_2D, windowTexture);
-
-        // iterate and render windows
-        for (std::map<float, glm::vec3>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, it->second);
-            model = glm::scale(model, glm::vec3(3.0f, 5.0f, 3.0f));
-            blendingShader.setMat4("model", model);
+
+        // iterate and render windows, farthest first
+        boundTexture = 0;
+        for (unsigned int slot : blendOrder) {
+            Entity entity = transparentOwners[slot];
+            const Renderable &renderable = entities.renderables.Get(entity);
+            if (renderable.texture != boundTexture) {
+                boundTexture = renderable.texture;
+                glBindTexture(GL_TEXTURE_2D, boundTexture);
+            }
+            blendingShader.setMat4("model", scene.World(entities.transforms.Get(entity).node));
             glDrawArrays(GL_TRIANGLES, 0, 6);
         }
 
@@ -498,10 +565,14 @@ int main()
         ImGui::ColorEdit3("Color", dirColorG);
         // point lights
         ImGui::Text("Point Light");
-        ImGui::ColorEdit3("Emissive 1", plc1);
-        ImGui::ColorEdit3("Emissive 2", plc2);
+        ImGui::ColorEdit3("Emissive 1", glm::value_ptr(entities.lights.Get(orbitingLantern).color));
+        ImGui::ColorEdit3("Emissive 2", glm::value_ptr(entities.lights.Get(tracingLantern).color));
         // speed mult
         ImGui::SliderFloat("Speed Mult", &inputState.speedMult, 1.0f, 50.0f);
+        // batching
+        ImGui::Text("Instanced draws merged: %u", mergedDraws);
+        ImGui::Text("Entities: %u", (unsigned int)entities.Size());
+        ImGui::Text("Meshes visible: %u of %u (%u culled)", cullStats.visible, cullStats.total, cullStats.Culled());
         if (ImGui::Button("Erase Debug Lines")) {
             lineVertices.clear();
             altLineVertices.clear();
@@ -522,7 +593,7 @@ int main()
 
         // handle mouse events for sphere detection
         // ----------------------------------------
-        handleMouseEvents(window, projection, view);
+        handleMouseEvents(window, projection, view, entities, scene);
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -547,6 +618,9 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    models.clear();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -617,7 +691,7 @@ void updateLineState(vector<float> &lineVertices, vector<float> &altLineVertices
 
 // hacky implementation of ray cast detection, fix and replace!
 // ------------------------------------------------------------
-void handleMouseEvents(GLFWwindow *window, glm::mat4 &projection, glm::mat4 &view) {
+void handleMouseEvents(GLFWwindow *window, glm::mat4 &projection, glm::mat4 &view, EntityStore &entities, const SceneGraph &scene) {
     if (inputState.cursorDisabled && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
     {
         // convert mouse coord to NDC
@@ -637,19 +711,23 @@ void handleMouseEvents(GLFWwindow *window, glm::mat4 &projection, glm::mat4 &vie
         ray_world = glm::vec3(glm::inverse(view) * ray_eye);
         ray_world = glm::normalize(ray_world);
 
-        iterateDetectSpheres(view, projection);
+        pickSelectables(entities, scene, view, projection);
     }
 }
 
-// iterate through spheres to check for ray intersects
-// ---------------------------------------------------
-void iterateDetectSpheres(glm::mat4 &view, glm::mat4 &projection) {
-    for (Sphere &iSphere : sphereList) {
-        float sphereRadius= glm::length(iSphere.dimensions) / 2.0f;
-        if (testRaySphereIntersect(camera.Position, ray_world, iSphere.position, sphereRadius, view, projection))
-            iSphere.selected = true;
-        else 
-            iSphere.selected = false;
+// test the ray against every selectable's bounding sphere
+// ----------------------------------------------------------
+void pickSelectables(EntityStore &entities, const SceneGraph &scene, glm::mat4 &view, glm::mat4 &projection) {
+    Selectable *selectables = entities.selectables.Data();
+    const Entity *owners = entities.selectables.Entities();
+    for (std::size_t i = 0; i < entities.selectables.Size(); ++i) {
+        const Renderable *renderable = entities.renderables.Find(owners[i]);
+        if (!renderable || !renderable->model) {
+            selectables[i].selected = false;
+            continue;
+        }
+        Bounds bounds = renderable->model->bounds.Transformed(scene.World(entities.transforms.Get(owners[i]).node));
+        selectables[i].selected = testRaySphereIntersect(camera.Position, ray_world, bounds.center, bounds.radius, view, projection);
     }
 }
 
@@ -770,6 +848,26 @@ void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 colo
     shader.setFloat(uniform + "quadratic", 0.032f);
 }
 
+// upload the Light entities as point lights
+// ------------------------------------------
+void setPointLights(Shader &shader, EntityStore &entities, const SceneGraph &scene) {
+    const Light *lights = entities.lights.Data();
+    const Entity *owners = entities.lights.Entities();
+    for (unsigned int i = 0; i < entities.lights.Size() && i < MAX_POINT_LIGHTS; ++i)
+        setPointLight(shader, i, glm::vec3(scene.World(entities.transforms.Get(owners[i]).node)[3]), lights[i].color);
+}
+
+// place an entity under parent, drawn as model, or as a quad with texture when model is null
+// -------------------------------------------------------------------------------------------
+Entity spawnEntity(EntityStore &entities, SceneGraph &scene, SceneNode parent, const glm::mat4 &local, Model *model, unsigned int texture) {
+    Entity entity = entities.Create();
+    entities.transforms.Add(entity).node = scene.Add(parent, local);
+    Renderable &renderable = entities.renderables.Add(entity);
+    renderable.model = model;
+    renderable.texture = texture;
+    return entity;
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -223,7 +223,7 @@ int main()
 
         // render the loaded model (floor)
         glm::vec3 floorPos = glm::vec3(0.0f, -3.0f, 0.0f);
-        glm::vec3 floorDims = floor.Get0MeshDimensions();
+        glm::vec3 floorDims = floor.GetDimensions();
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, floorPos);
@@ -248,6 +248,11 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    ourModel.Release();
+    lantern.Release();
+    floor.Release();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -329,6 +329,7 @@ int main()
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,72 @@
+// Parse throughput of the scene's .obj files through ASSIMP and through the dedicated
+// ObjImporter (geometry and texture references only, no texture decoding or GL).
+// Needs no window or GL context.
+//
+// usage: obj-bench [file.obj ...]
+
+#include "../include/model.h"
+#include "../include/objLoader.h"
+#include "../include/jobSystem.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// best of a few runs, the first one also warms the page cache
+template <typename Import>
+static double bestMs(Import import, unsigned int runs, bool &ok)
+{
+    double best = 0.0;
+    for (unsigned int run = 0; run < runs; run++) {
+        ModelData data;
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        ok = import(data);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = run == 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+        files.push_back(argv[i]);
+    if (files.empty()) {
+        files = {
+            "../resources/models/planet/planet.obj",
+            "../resources/models/rock/rock.obj",
+            "../resources/models/backpack/backpack.obj",
+            "../resources/models/japanese-lamp/JapaneseLamp.obj",
+            "../resources/models/tile-floor/tile-floor.obj",
+            "../resources/models/tile-ball/tile-ball.obj"
+        };
+    }
+
+    JobSystem &jobs = JobSystem::Global();
+    std::cout << "threads " << jobs.WorkerCount() + 1 << std::endl;
+    std::cout << std::fixed;
+    for (const std::string &path : files) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            std::cout << "ERROR::OBJ_BENCH:: can't open " << path << std::endl;
+            continue;
+        }
+        double megabytes = static_cast<double>(file.tellg()) / (1024.0 * 1024.0);
+
+        bool assimpOk = false, objOk = false;
+        double assimpMs = bestMs([&](ModelData &data) { return Model::ImportAssimp(path, data, false, jobs); }, 3, assimpOk);
+        double objMs = bestMs([&](ModelData &data) { return ObjImporter::Import(path, data, false, jobs); }, 3, objOk);
+
+        std::cout << path << " (" << std::setprecision(2) << megabytes << " MB)" << std::endl;
+        std::cout << "  assimp " << std::setw(9) << std::setprecision(1) << assimpMs << " ms " << std::setw(8)
+                  << megabytes * 1000.0 / assimpMs << " MB/s" << (assimpOk ? "" : "  FAILED") << std::endl;
+        std::cout << "  obj    " << std::setw(9) << objMs << " ms " << std::setw(8)
+                  << megabytes * 1000.0 / objMs << " MB/s" << (objOk ? "" : "  FAILED")
+                  << "  speedup " << std::setprecision(2) << assimpMs / objMs << std::endl;
+    }
+    return 0;
+}
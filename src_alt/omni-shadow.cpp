@@ -68,7 +68,9 @@ int main()
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
-    Shader shader("../shaders/util/omni-shadow-map.vs", "../shaders/util/omni-shadow-map.fs");
+    // one program per shadow mode, compiled when first picked: 1 no shadows, 2 hard, 3 soft
+    ShaderVariants shadowVariants("../shaders/util/omni-shadow-map.vs", "", "../shaders/util/omni-shadow-map.fs");
+    ShaderDefines shadowMode = ShaderDefines().Set("SHADOWS").Set("SOFT_SHADOWS");
     Shader omniDepthShader("../shaders/util/omni-sm-depth.vs", "../shaders/util/omni-sm-depth.gs", "../shaders/util/omni-sm-depth.fs");
     Shader lightCubeShader("../shaders/generic/3.3.light_cube.vs", "../shaders/generic/3.3.light_cube_materials.fs");
 
@@ -94,10 +96,6 @@ int main()
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    shader.use();
-    shader.setInt("diffuseTexture", 0);
-    shader.setInt("depthMap", 1);
-
     glm::vec3 lightPos(0.0f);
 
     while (!glfwWindowShouldClose(window))
@@ -107,6 +105,12 @@ int main()
         lastFrame = currentFrame;
 
         processInput(window, camera, inputState, deltaTime);
+        if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS)
+            shadowMode = ShaderDefines();
+        if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+            shadowMode = ShaderDefines().Set("SHADOWS");
+        if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
+            shadowMode = ShaderDefines().Set("SHADOWS").Set("SOFT_SHADOWS");
 
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -133,13 +137,14 @@ int main()
         glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), aspect, NEAR_PLANE, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
+        Shader &shader = shadowVariants.Get(shadowMode);
         shader.use();
+        shader.setInt("diffuseTexture", 0);
+        shader.setInt("depthMap", 1);
         shader.setMat4("projection", projection);
         shader.setMat4("view", view);
         shader.setVec3("lightPos", lightPos);
         shader.setVec3("viewPos", camera.Position);
-        shader.setInt("shadows", true);
-        shader.setInt("soft", true);
         shader.setFloat("far_plane", SHADOW_FAR);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
@@ -162,6 +167,7 @@ int main()
         glfwPollEvents();
     }
 
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
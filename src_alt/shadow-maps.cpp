@@ -300,6 +300,9 @@ int main()
     glDeleteBuffers(1, &cubeVBO);
     glDeleteFramebuffers(1, &depthMapFBO);
 
+    // models free their textures through GL, while the context is still current
+    backpack.Release();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }
@@ -0,0 +1,271 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "../include/model.h"
+#include "../include/shader.h"
+#include "../include/camera.h"
+#include "../include/skinnedBatch.h"
+
+#include "../include/inputHandler.h"
+
+#include <iostream>
+
+// callbacks
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void mouse_callback(GLFWwindow* window, double xpos, double ypos);
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+// utility functions
+void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 color);
+
+// settings
+unsigned int SCR_WIDTH = 1600;
+unsigned int SCR_HEIGHT = 900;
+float NEAR_PLANE = 0.1f;
+float FAR_PLANE = 1000.0f;
+
+// camera
+Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+// timing
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+
+// input
+InputState inputState;
+
+int main()
+{
+    // glfw: initialize and configure
+    // ------------------------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    // glfw window creation
+    // --------------------
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    // set callbacks
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetCursorPosCallback(window, mouse_callback);
+    glfwSetScrollCallback(window, scroll_callback);
+
+    // tell GLFW to capture our mouse
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // configure global opengl state
+    // -----------------------------
+    glEnable(GL_DEPTH_TEST);
+
+    // build and compile shaders
+    // -------------------------
+    // bones are blended in the vertex shader, the palettes come from the SkinnedBatch
+    Shader skinnedShader("../shaders/generic/3.3.lighting_maps.vs", "", "../shaders/generic/3.3.models.fs", "#define SKINNED\n");
+
+    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
+    stbi_set_flip_vertically_on_load(true);
+
+    // load models
+    // -----------
+    Model dancer = Model("../resources/models/vampire/dancing_vampire.dae", false, &MeshArena::Shared(), CpuGeometry::NONE);
+    if (!dancer.skeleton)
+        std::cout << "WARNING::SKINNED_CROWD:: model has no skeleton, drawing it in its bind pose" << std::endl;
+    else
+        std::cout << "Skeleton: " << dancer.skeleton->JointCount() << " joints, " << dancer.skeleton->BoneCount() << " bones, "
+                  << dancer.skeleton->animations.size() << " animations" << std::endl;
+
+    // place the crowd on a grid, every dancer a bit further into the clip
+    // ---------------------------------------------------------------------
+    const unsigned int rows = 20;
+    const unsigned int columns = 20;
+    SkinnedBatch crowd(dancer);
+    const AnimationClip *clip = dancer.skeleton && !dancer.skeleton->animations.empty() ? &dancer.skeleton->animations[0] : nullptr;
+    glm::vec3 spacing = glm::max(dancer.GetDimensions(), glm::vec3(1.0f)) * 1.5f;
+    for (unsigned int row = 0; row < rows; ++row) {
+        for (unsigned int column = 0; column < columns; ++column) {
+            AnimatedInstance instance;
+            instance.clip = clip;
+            instance.transform = glm::translate(glm::mat4(1.0f), glm::vec3(((float)column - columns * 0.5f) * spacing.x, -3.0f, -(float)row * spacing.z));
+            crowd.Instances.push_back(instance);
+        }
+    }
+    // per stage timings, averaged and reported every few seconds
+    SkinningStats totals;
+    unsigned int frames = 0;
+    float lastReport = 0.0f;
+
+    // camera properties
+    camera.Position = glm::vec3(0.0f, spacing.y, spacing.z * 2.0f);
+
+    // render loop
+    // -----------
+    while (!glfwWindowShouldClose(window))
+    {
+        // per-frame time logic
+        // --------------------
+        float currentFrame = static_cast<float>(glfwGetTime());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        // input
+        // -----
+        processInput(window, camera, inputState, deltaTime);
+
+        // animate the crowd on the job system
+        // -----------------------------------
+        for (unsigned int i = 0; i < crowd.Instances.size(); ++i)
+            crowd.Instances[i].time = currentFrame + i * 0.37f;
+        crowd.Animate();
+
+        // render
+        // ------
+        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // view/projection transformations
+        // -------------------------------
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
+        glm::mat4 view = camera.GetViewMatrix();
+
+        // lighting properties
+        // -------------------
+        glm::vec3 dirColor = glm::vec3(1.0f);
+        skinnedShader.use();
+        skinnedShader.setVec3("viewPos", camera.Position);
+        // direction light
+        skinnedShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+        skinnedShader.setVec3("dirLight.ambient", dirColor * 0.2f);
+        skinnedShader.setVec3("dirLight.diffuse", dirColor * 0.6f);
+        skinnedShader.setVec3("dirLight.specular", dirColor * 0.5f);
+        // point lights, both above the crowd
+        setPointLight(skinnedShader, 0, glm::vec3(cos(glfwGetTime()) * 20.0f, 10.0f, sin(glfwGetTime()) * 20.0f - 20.0f), glm::vec3(1.0f, 0.7f, 0.4f));
+        setPointLight(skinnedShader, 1, glm::vec3(0.0f, 10.0f, -40.0f), glm::vec3(0.4f, 0.6f, 1.0f));
+        // flashlight off
+        skinnedShader.setVec3("spotlight.position", camera.Position);
+        skinnedShader.setVec3("spotlight.direction", camera.Front);
+        skinnedShader.setFloat("spotlight.cutoff", glm::cos(glm::radians(12.5f)));
+        skinnedShader.setFloat("spotlight.outerCutoff", glm::cos(glm::radians(17.5f)));
+        skinnedShader.setVec3("spotlight.ambient", glm::vec3(0.0f));
+        skinnedShader.setVec3("spotlight.diffuse", glm::vec3(0.0f));
+        skinnedShader.setVec3("spotlight.specular", glm::vec3(0.0f));
+        skinnedShader.setFloat("spotlight.constant", 1.0f);
+        skinnedShader.setFloat("spotlight.linear", 0.09f);
+        skinnedShader.setFloat("spotlight.quadratic", 0.032f);
+        skinnedShader.setVec3("emissiveMult", glm::vec3(0.0f));
+        skinnedShader.setFloat("material.shininess", 32.0f);
+        // transform matrices
+        skinnedShader.setMat4("projection", projection);
+        skinnedShader.setMat4("view", view);
+
+        // render the crowd
+        // ----------------
+        crowd.Upload();
+        crowd.Draw(skinnedShader);
+
+        // report the cost of each stage
+        totals.sampleMs += crowd.Stats.sampleMs;
+        totals.paletteMs += crowd.Stats.paletteMs;
+        totals.uploadMs += crowd.Stats.uploadMs;
+        totals.drawMs += crowd.Stats.drawMs;
+        frames++;
+        if (currentFrame - lastReport > 5.0f) {
+            std::cout << crowd.Stats.instances << " instances, " << crowd.Stats.matrices << " palette matrices, per frame: sample "
+                      << totals.sampleMs / frames << " ms, palettes " << totals.paletteMs / frames << " ms, upload "
+                      << totals.uploadMs / frames << " ms, draw " << totals.drawMs / frames << " ms" << std::endl;
+            totals = SkinningStats();
+            frames = 0;
+            lastReport = currentFrame;
+        }
+
+        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // -------------------------------------------------------------------------------
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    // optional: de-allocate all resources once they've outlived their purpose:
+    // ------------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    dancer.Release();
+    GpuResources::Get().ContextDestroyed();
+    glfwTerminate();
+    return 0;
+}
+
+// render point lights
+// -------------------
+void setPointLight(Shader &shader, int index, glm::vec3 position, glm::vec3 color) { 
+    std::string uniform = "pointLights[" + std::to_string(index) + "].";
+    shader.setVec3(uniform + "position", position);
+    shader.setVec3(uniform + "ambient", color * glm::vec3(0.05f, 0.05f, 0.05f));
+    shader.setVec3(uniform + "diffuse", color * glm::vec3(0.8f, 0.8f, 0.8f));
+    shader.setVec3(uniform + "specular", color * glm::vec3(1.0f, 1.0f, 1.0f));
+    shader.setFloat(uniform + "constant", 1.0f);
+    shader.setFloat(uniform + "linear", 0.022f);
+    shader.setFloat(uniform + "quadratic", 0.0019f);
+}
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+// ---------------------------------------------------------------------------------------------
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    SCR_WIDTH = width;
+    SCR_HEIGHT = height;
+    // make sure the viewport matches the new window dimensions; note that width and 
+    // height will be significantly larger than specified on retina displays.
+    glViewport(0, 0, width, height);
+}
+
+// glfw: whenever the mouse moves, this callback is called
+// -------------------------------------------------------
+void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
+{
+    float xpos = static_cast<float>(xposIn);
+    float ypos = static_cast<float>(yposIn);
+
+    if (firstMouse)
+    {
+        lastX = xpos;
+        lastY = ypos;
+        firstMouse = false;
+    }
+
+    float xoffset = xpos - lastX;
+    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+
+    lastX = xpos;
+    lastY = ypos;
+
+    if (!inputState.cursorDisabled || inputState.firstToggle)
+        camera.ProcessMouseMovement(xoffset, yoffset);
+}
+
+// glfw: whenever the mouse scroll wheel scrolls, this callback is called
+// ----------------------------------------------------------------------
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
+{
+    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
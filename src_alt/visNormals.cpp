@@ -132,6 +132,9 @@ int main()
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    // models free their textures through GL, while the context is still current
+    backpack.Release();
+    GpuResources::Get().ContextDestroyed();
     glfwTerminate();
     return 0;
 }